@@ -7,3 +7,43 @@ gcc rs_encoding_binary.c
 
 gcc rs_decoding_binary.c 
 ./a.out output.txt final.txt
+
+# Concatenated RS + convolutional mode (build with -O2 -mavx2 for the SIMD Viterbi)
+# gcc -O2 rs_encoding_binary.c && ./a.out input.txt output.txt --concat
+# gcc -O2 -mavx2 rs_decoding_binary.c && ./a.out output.txt final.txt --concat
+
+# CCSDS attached sync marker + randomizer (combine with --concat as needed)
+# gcc -O2 rs_encoding_binary.c && ./a.out input.txt output.txt --sync
+# gcc -O2 rs_decoding_binary.c && ./a.out output.txt final.txt --sync
+
+# Decoder regression tests (exit status is the number of failed checks)
+# gcc -O2 -mavx2 test.c && ./a.out
+
+# Shared RS codec service: tools submit blocks over a Unix socket with the
+# codewords in shared memory; requests from all clients are batched per SIMD lane
+# gcc -O2 -mavx2 rs_codec_daemon.c -o rs_codec_daemon
+# ./rs_codec_daemon --serve /tmp/rs_codec.sock
+# ./rs_codec_daemon --bench 8 4000
+
+# Bulk files: overlap disk I/O and coding with io_uring (plain mode)
+# gcc -O2 rs_encoding_binary.c && ./a.out input.txt output.txt --uring
+# gcc -O2 rs_decoding_binary.c && ./a.out output.txt final.txt --uring
+
+# Streaming: decode from a pipe while it is still arriving (messages go to stderr)
+# gcc -O2 rs_decoding_binary.c && cat output.txt | ./a.out - - > final.txt
+
+# Archives: RS(N,K) over GF(2^16) with long codewords (up to 65535 16-bit symbols)
+# gcc -O2 -mavx2 rs_encoding_binary.c && ./a.out input.txt output.txt --gf16 65535 65471
+# gcc -O2 -mavx2 rs_decoding_binary.c && ./a.out output.txt final.txt --gf16
+
+# Sharded archives: a coordinator hands codeword ranges to worker processes
+# (local ones by default; --workers 0 --listen tcp:HOST:PORT for remote ones)
+# gcc -O2 -mavx2 rs_shard.c -o rs_shard
+# ./rs_shard encode input.txt output.txt --gf16 65535 65471 --workers 4
+# ./rs_shard decode output.txt final.txt
+# ./rs_shard --worker tcp:HOST:PORT
+
+# Long runs: checkpoint progress to output.txt.ckpt; rerun the same command after
+# a crash or power loss to resume where the last checkpoint left off
+# gcc -O2 rs_encoding_binary.c && ./a.out input.txt output.txt --concat --checkpoint
+# gcc -O2 rs_decoding_binary.c && ./a.out output.txt final.txt --concat --checkpoint
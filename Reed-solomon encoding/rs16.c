@@ -0,0 +1,729 @@
+/*
+ * Reed-Solomon over GF(2^16) for archive files (included by the encoder and
+ * decoder for --gf16). A codeword holds up to 65535 16-bit symbols, so a
+ * large file is covered by a few long codewords instead of thousands of
+ * 255-byte blocks, and n and k can be chosen freely.
+ *
+ * Multiplication by a constant uses split tables: c*x is the XOR of four
+ * 16-entry tables indexed by the four nibbles of x, each split into a
+ * low-byte and a high-byte half so a single byte shuffle looks up a whole
+ * vector. Lane vectors keep the low and high bytes of their symbols apart,
+ * one codeword per lane, for encoding and for the syndromes.
+ *
+ * With many parity symbols the syndromes, the error locator root search and
+ * the Forney values are computed with an additive FFT (Gao-Mateer), which
+ * evaluates a polynomial at all 65536 field elements in O(n log^2 n)
+ * rather than one O(n) Horner pass per point.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#define GF16_SIZE 65536
+#define GF16_ORDER 65535            // Multiplicative group order
+#define GF16_PRIM_POLY 0x1100B      // x^16 + x^12 + x^3 + x + 1
+#define RS16_FFT_ROOTS 512          // Syndromes use the FFT above this many roots
+#define RS16_FFT_WORK (1L << 17)    // Horner steps above which root search / Forney use the FFT
+#define RS16_HEADER_SIZE 16
+
+static const uint8_t RS16_MAGIC[4] = { 'R', 'S', '1', '6' };
+
+static uint16_t gf16_exp[2 * GF16_ORDER];
+static uint16_t gf16_log[GF16_SIZE];
+static int gf16_ready;
+
+/**
+ * Build the GF(2^16) exponential and logarithm tables (alpha = x)
+ */
+void init_gf16_field(void) {
+    uint32_t temp = 1;
+
+    if (gf16_ready) {
+        return;
+    }
+    for (int i = 0; i < GF16_ORDER; i++) {
+        gf16_exp[i] = gf16_exp[i + GF16_ORDER] = (uint16_t)temp;
+        gf16_log[temp] = i;
+        temp <<= 1;
+        if (temp & 0x10000) {
+            temp ^= GF16_PRIM_POLY;
+        }
+    }
+    gf16_log[0] = 0;    // Never used: callers test for zero first
+    gf16_ready = 1;
+}
+
+static inline uint16_t gf16_mul(uint16_t a, uint16_t b) {
+    return (a == 0 || b == 0) ? 0 : gf16_exp[gf16_log[a] + gf16_log[b]];
+}
+
+static inline uint16_t gf16_div(uint16_t a, uint16_t b) {
+    return (a == 0) ? 0 : gf16_exp[gf16_log[a] + GF16_ORDER - gf16_log[b]];
+}
+
+// alpha^e for any e, including negative powers
+static inline uint16_t gf16_alpha(long e) {
+    e %= GF16_ORDER;
+    return gf16_exp[e < 0 ? e + GF16_ORDER : e];
+}
+
+/* ---------------------------------------------------------------------- */
+/* Split-table multiplication                                               */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * Multiplication by a constant c: tab[2*i] and tab[2*i + 1] hold the low
+ * and high bytes of c * (v << 4i) for each nibble value v.
+ */
+typedef struct {
+    uint8_t tab[8][16] __attribute__((aligned(16)));
+} gf16_split_t;
+
+static void gf16_split_init(gf16_split_t *t, uint16_t c) {
+    for (int nibble = 0; nibble < 4; nibble++) {
+        for (int v = 0; v < 16; v++) {
+            uint16_t product = gf16_mul(c, (uint16_t)(v << (4 * nibble)));
+            t->tab[2 * nibble][v] = product & 0xFF;
+            t->tab[2 * nibble + 1][v] = product >> 8;
+        }
+    }
+}
+
+#if defined(__AVX2__)
+#define RS16_LANES 32
+typedef __m256i gf16_half_t;
+#define half_load(p) _mm256_load_si256((const __m256i *)(p))
+#define half_store(p, v) _mm256_store_si256((__m256i *)(p), v)
+#define half_xor(a, b) _mm256_xor_si256(a, b)
+#define half_zero() _mm256_setzero_si256()
+#define half_nibbles(x, lo, hi) do { \
+        const __m256i mask_ = _mm256_set1_epi8(0x0F); \
+        lo = _mm256_and_si256(x, mask_); \
+        hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), mask_); \
+    } while (0)
+#define half_lookup(t, idx) \
+    _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)(t))), idx)
+#elif defined(__SSSE3__)
+#define RS16_LANES 16
+typedef __m128i gf16_half_t;
+#define half_load(p) _mm_load_si128((const __m128i *)(p))
+#define half_store(p, v) _mm_store_si128((__m128i *)(p), v)
+#define half_xor(a, b) _mm_xor_si128(a, b)
+#define half_zero() _mm_setzero_si128()
+#define half_nibbles(x, lo, hi) do { \
+        const __m128i mask_ = _mm_set1_epi8(0x0F); \
+        lo = _mm_and_si128(x, mask_); \
+        hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask_); \
+    } while (0)
+#define half_lookup(t, idx) _mm_shuffle_epi8(_mm_load_si128((const __m128i *)(t)), idx)
+#endif
+
+#ifdef RS16_LANES
+// RS16_LANES symbols: their low bytes in one register, high bytes in another
+typedef struct {
+    gf16_half_t lo, hi;
+} gf16_vec_t;
+
+static inline gf16_vec_t gf16_vec_load(const uint8_t *lo, const uint8_t *hi) {
+    gf16_vec_t v = { half_load(lo), half_load(hi) };
+    return v;
+}
+
+static inline void gf16_vec_store(uint8_t *lo, uint8_t *hi, gf16_vec_t v) {
+    half_store(lo, v.lo);
+    half_store(hi, v.hi);
+}
+
+static inline gf16_vec_t gf16_vec_xor(gf16_vec_t a, gf16_vec_t b) {
+    gf16_vec_t v = { half_xor(a.lo, b.lo), half_xor(a.hi, b.hi) };
+    return v;
+}
+
+static inline gf16_vec_t gf16_vec_zero(void) {
+    gf16_vec_t v = { half_zero(), half_zero() };
+    return v;
+}
+
+static inline gf16_vec_t gf16_vec_mul(gf16_vec_t x, const gf16_split_t *t) {
+    gf16_half_t n[4];
+    half_nibbles(x.lo, n[0], n[1]);
+    half_nibbles(x.hi, n[2], n[3]);
+
+    gf16_vec_t r = gf16_vec_zero();
+    for (int i = 0; i < 4; i++) {
+        r.lo = half_xor(r.lo, half_lookup(t->tab[2 * i], n[i]));
+        r.hi = half_xor(r.hi, half_lookup(t->tab[2 * i + 1], n[i]));
+    }
+    return r;
+}
+#else
+#define RS16_LANES 16
+typedef struct {
+    uint8_t lo[RS16_LANES], hi[RS16_LANES];
+} gf16_vec_t;
+
+static inline gf16_vec_t gf16_vec_load(const uint8_t *lo, const uint8_t *hi) {
+    gf16_vec_t v;
+    memcpy(v.lo, lo, RS16_LANES);
+    memcpy(v.hi, hi, RS16_LANES);
+    return v;
+}
+
+static inline void gf16_vec_store(uint8_t *lo, uint8_t *hi, gf16_vec_t v) {
+    memcpy(lo, v.lo, RS16_LANES);
+    memcpy(hi, v.hi, RS16_LANES);
+}
+
+static inline gf16_vec_t gf16_vec_xor(gf16_vec_t a, gf16_vec_t b) {
+    for (int i = 0; i < RS16_LANES; i++) {
+        a.lo[i] ^= b.lo[i];
+        a.hi[i] ^= b.hi[i];
+    }
+    return a;
+}
+
+static inline gf16_vec_t gf16_vec_zero(void) {
+    gf16_vec_t v;
+    memset(&v, 0, sizeof(v));
+    return v;
+}
+
+static inline gf16_vec_t gf16_vec_mul(gf16_vec_t x, const gf16_split_t *t) {
+    gf16_vec_t r;
+    for (int i = 0; i < RS16_LANES; i++) {
+        uint8_t n[4] = { x.lo[i] & 15, x.lo[i] >> 4, x.hi[i] & 15, x.hi[i] >> 4 };
+        r.lo[i] = t->tab[0][n[0]] ^ t->tab[2][n[1]] ^ t->tab[4][n[2]] ^ t->tab[6][n[3]];
+        r.hi[i] = t->tab[1][n[0]] ^ t->tab[3][n[1]] ^ t->tab[5][n[2]] ^ t->tab[7][n[3]];
+    }
+    return r;
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Additive FFT                                                             */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Level d of the recursion evaluates over a (16 - d)-dimensional subspace.
+ * Every call at one level shares the same basis, so the scale factor and
+ * the span of the reduced basis are computed once: level d's span has
+ * 2^(15 - d) entries and starts at GF16_SIZE - 2^(16 - d).
+ */
+static uint16_t gf16_fft_span[GF16_SIZE];
+static uint16_t gf16_fft_scale[15];      // log of the basis element divided out
+static uint16_t gf16_fft_last;           // Basis of the one-dimensional level
+static uint16_t gf16_fft_tmp[GF16_SIZE];
+static int gf16_fft_ready;
+
+static void gf16_fft_init(void) {
+    uint16_t basis[16], gamma[16];
+
+    for (int i = 0; i < 16; i++) {
+        basis[i] = (uint16_t)(1 << i);
+    }
+    for (int d = 0; d < 15; d++) {
+        int dim = 16 - d;
+        uint16_t beta = basis[dim - 1];
+        uint16_t *span = gf16_fft_span + GF16_SIZE - (1L << dim);
+
+        gf16_fft_scale[d] = gf16_log[beta];
+        for (int i = 0; i < dim - 1; i++) {
+            gamma[i] = gf16_div(basis[i], beta);
+            basis[i] = gf16_mul(gamma[i], gamma[i]) ^ gamma[i];
+        }
+        span[0] = 0;
+        for (long j = 1; j < (1L << (dim - 1)); j++) {
+            span[j] = span[j & (j - 1)] ^ gamma[__builtin_ctzl(j)];
+        }
+    }
+    gf16_fft_last = basis[0];
+    gf16_fft_ready = 1;
+}
+
+/*
+ * f holds 2^(16 - d) coefficients of which only the first 'len' can be
+ * non-zero; on return f[j] is the value at the j-th point of the subspace.
+ */
+static void gf16_fft_level(uint16_t *f, long len, int d) {
+    long size = 1L << (16 - d), half = size >> 1;
+
+    if (len <= 1) {
+        for (long i = 1; i < size; i++) {
+            f[i] = f[0];
+        }
+        return;
+    }
+    if (d == 15) {
+        f[1] = f[0] ^ gf16_mul(f[1], gf16_fft_last);
+        return;
+    }
+
+    // g(x) = f(beta x), so the last basis element becomes 1
+    long scale = 0;
+    for (long i = 1; i < len; i++) {
+        scale += gf16_fft_scale[d];
+        if (scale >= GF16_ORDER) {
+            scale -= GF16_ORDER;
+        }
+        if (f[i]) {
+            f[i] = gf16_exp[gf16_log[f[i]] + scale];
+        }
+    }
+
+    // Taylor expansion at x^2 + x: with q = s/4, x^2q = (x^2 + x)^q + x^q
+    for (long s = size; s >= 4; s >>= 1) {
+        long q = s >> 2;
+        for (long b = 0; b < len; b += s) {
+            for (long j = 0; j < q; j++) {
+                f[b + 2 * q + j] ^= f[b + 3 * q + j];
+                f[b + q + j] ^= f[b + 2 * q + j];
+            }
+        }
+    }
+
+    // g(x) = g0(x^2 + x) + x g1(x^2 + x): even and odd positions
+    long sub_len = (len + 1) / 2;
+    for (long i = 0; i < half; i++) {
+        gf16_fft_tmp[i] = f[2 * i];
+        gf16_fft_tmp[half + i] = f[2 * i + 1];
+    }
+    memcpy(f, gf16_fft_tmp, size * sizeof(uint16_t));
+    gf16_fft_level(f, sub_len, d + 1);
+    gf16_fft_level(f + half, sub_len, d + 1);
+
+    // At y = G[j] + c: g(y) = g0(D[j]) + (G[j] + c) g1(D[j])
+    const uint16_t *span = gf16_fft_span + GF16_SIZE - size;
+    for (long j = 0; j < half; j++) {
+        uint16_t w = f[j] ^ gf16_mul(span[j], f[half + j]);
+        f[half + j] ^= w;
+        f[j] = w;
+    }
+}
+
+/**
+ * Evaluate a polynomial at every field element in place: f[0..len-1] are
+ * its coefficients (f[i] of x^i); afterwards f[x] = p(x) for all 65536 x.
+ * f must have room for GF16_SIZE symbols.
+ */
+void gf16_fft_eval(uint16_t *f, long len) {
+    if (!gf16_fft_ready) {
+        gf16_fft_init();
+    }
+    memset(f + len, 0, (GF16_SIZE - len) * sizeof(uint16_t));
+    gf16_fft_level(f, len, 0);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Codec                                                                    */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Codewords are stored highest degree first: symbol i of a codeword of
+ * length len is the coefficient of x^(len-1-i). The generator has roots
+ * alpha^1 .. alpha^nroots. A codeword shorter than n is shortened: its
+ * missing leading data symbols are zero.
+ */
+typedef struct {
+    int n, k, nroots;
+    uint16_t *generator;            // nroots + 1 coefficients, generator[j] of x^j
+    gf16_split_t *generator_tab;    // Split tables of generator[0 .. nroots-1]
+    gf16_split_t *alpha_tab;        // Split tables of alpha^1 .. alpha^nroots
+    gf16_vec_t *lanes;              // nroots lane vectors of working state
+} rs16_code_t;
+
+typedef struct {
+    uint8_t lo[RS16_LANES] __attribute__((aligned(32)));
+    uint8_t hi[RS16_LANES] __attribute__((aligned(32)));
+} gf16_column_t;
+
+static void *rs16_alloc(size_t size) {
+    return aligned_alloc(32, (size + 31) & ~(size_t)31);
+}
+
+void rs16_free(rs16_code_t *rs) {
+    free(rs->generator);
+    free(rs->generator_tab);
+    free(rs->alpha_tab);
+    free(rs->lanes);
+    memset(rs, 0, sizeof(*rs));
+}
+
+/**
+ * Set up an RS(n, k) code: generator g(x) = (x - alpha^1)...(x - alpha^nroots)
+ * and the split tables used by the lane kernels.
+ */
+int rs16_init(rs16_code_t *rs, int n, int k) {
+    memset(rs, 0, sizeof(*rs));
+    if (n < 2 || n > GF16_ORDER || k < 1 || k >= n) {
+        printf("Error: GF(2^16) code needs 0 < k < n <= %d\n", GF16_ORDER);
+        return -1;
+    }
+    init_gf16_field();
+
+    rs->n = n;
+    rs->k = k;
+    rs->nroots = n - k;
+    rs->generator = calloc(rs->nroots + 1, sizeof(uint16_t));
+    rs->generator_tab = rs16_alloc(rs->nroots * sizeof(gf16_split_t));
+    rs->alpha_tab = rs16_alloc(rs->nroots * sizeof(gf16_split_t));
+    rs->lanes = rs16_alloc(rs->nroots * sizeof(gf16_vec_t));
+    if (!rs->generator || !rs->generator_tab || !rs->alpha_tab || !rs->lanes) {
+        printf("Error: Out of memory for GF(2^16) code tables\n");
+        rs16_free(rs);
+        return -1;
+    }
+
+    rs->generator[0] = 1;
+    for (int i = 1; i <= rs->nroots; i++) {
+        uint16_t root = gf16_alpha(i);
+        for (int j = i; j > 0; j--) {
+            rs->generator[j] = rs->generator[j - 1] ^ gf16_mul(rs->generator[j], root);
+        }
+        rs->generator[0] = gf16_mul(rs->generator[0], root);
+    }
+    for (int i = 0; i < rs->nroots; i++) {
+        gf16_split_init(&rs->generator_tab[i], rs->generator[i]);
+        gf16_split_init(&rs->alpha_tab[i], gf16_alpha(i + 1));
+    }
+    return 0;
+}
+
+// Symbol 'step' of every lane, with shorter codewords aligned to the end
+static gf16_vec_t rs16_gather(const uint16_t *const *words, const int *len, int count,
+                              int longest, int step) {
+    static gf16_column_t column;
+
+    for (int lane = 0; lane < RS16_LANES; lane++) {
+        int i = (lane < count) ? step - (longest - len[lane]) : -1;
+        uint16_t symbol = (i >= 0) ? words[lane][i] : 0;
+        column.lo[lane] = symbol & 0xFF;
+        column.hi[lane] = symbol >> 8;
+    }
+    return gf16_vec_load(column.lo, column.hi);
+}
+
+static int rs16_longest(const int *len, int count) {
+    int longest = 0;
+    for (int lane = 0; lane < count; lane++) {
+        if (len[lane] > longest) {
+            longest = len[lane];
+        }
+    }
+    return longest;
+}
+
+/**
+ * Encode up to RS16_LANES codewords at once, one per lane. data[lane]
+ * holds len[lane] <= k data symbols; the nroots parity symbols that follow
+ * them in the codeword are written to parity[lane].
+ */
+void rs16_encode_batch(const rs16_code_t *rs, const uint16_t *const *data, const int *len,
+                       int count, uint16_t *const *parity) {
+    static gf16_column_t column;
+    gf16_vec_t *remainder = rs->lanes;
+    int nroots = rs->nroots;
+    int longest = rs16_longest(len, count);
+
+    for (int j = 0; j < nroots; j++) {
+        remainder[j] = gf16_vec_zero();
+    }
+    for (int i = 0; i < longest; i++) {
+        gf16_vec_t feedback = gf16_vec_xor(rs16_gather(data, len, count, longest, i),
+                                           remainder[nroots - 1]);
+        for (int j = nroots - 1; j > 0; j--) {
+            remainder[j] = gf16_vec_xor(remainder[j - 1], gf16_vec_mul(feedback, &rs->generator_tab[j]));
+        }
+        remainder[0] = gf16_vec_mul(feedback, &rs->generator_tab[0]);
+    }
+
+    for (int j = 0; j < nroots; j++) {
+        gf16_vec_store(column.lo, column.hi, remainder[j]);
+        for (int lane = 0; lane < count; lane++) {
+            parity[lane][nroots - 1 - j] = column.lo[lane] | (column.hi[lane] << 8);
+        }
+    }
+}
+
+static void rs16_syndromes_fft(const rs16_code_t *rs, const uint16_t *word, int len, uint16_t *syndromes) {
+    static uint16_t values[GF16_SIZE];
+
+    for (int i = 0; i < len; i++) {
+        values[i] = word[len - 1 - i];
+    }
+    gf16_fft_eval(values, len);
+    for (int j = 0; j < rs->nroots; j++) {
+        syndromes[j] = values[gf16_alpha(j + 1)];
+    }
+}
+
+/**
+ * Syndromes S_1 .. S_nroots of up to RS16_LANES received codewords.
+ * Codes with few roots run Horner's rule in the lanes; beyond
+ * RS16_FFT_ROOTS each codeword is evaluated at every point by the FFT.
+ */
+void rs16_syndromes_batch(const rs16_code_t *rs, const uint16_t *const *words, const int *len,
+                          int count, uint16_t *const *syndromes) {
+    static gf16_column_t column;
+    gf16_vec_t *s = rs->lanes;
+    int nroots = rs->nroots;
+
+    if (nroots > RS16_FFT_ROOTS) {
+        for (int lane = 0; lane < count; lane++) {
+            rs16_syndromes_fft(rs, words[lane], len[lane], syndromes[lane]);
+        }
+        return;
+    }
+
+    int longest = rs16_longest(len, count);
+    for (int j = 0; j < nroots; j++) {
+        s[j] = gf16_vec_zero();
+    }
+    for (int i = 0; i < longest; i++) {
+        gf16_vec_t r = rs16_gather(words, len, count, longest, i);
+        for (int j = 0; j < nroots; j++) {
+            s[j] = gf16_vec_xor(gf16_vec_mul(s[j], &rs->alpha_tab[j]), r);
+        }
+    }
+    for (int j = 0; j < nroots; j++) {
+        gf16_vec_store(column.lo, column.hi, s[j]);
+        for (int lane = 0; lane < count; lane++) {
+            syndromes[lane][j] = column.lo[lane] | (column.hi[lane] << 8);
+        }
+    }
+}
+
+static uint16_t gf16_poly_eval(const uint16_t *p, int degree, uint16_t x) {
+    uint16_t v = 0;
+    for (int i = degree; i >= 0; i--) {
+        v = gf16_mul(v, x) ^ p[i];
+    }
+    return v;
+}
+
+/**
+ * Correct errors and erasures in one codeword of 'len' symbols, given its
+ * syndromes and the positions of known-bad (erased) symbols. Errata
+ * Berlekamp-Massey seeded with the erasure locator, then the root search
+ * and Forney's formula, either point by point or through the FFT when the
+ * codeword and the locator are long. Returns the number of symbols
+ * corrected, or -1 if the codeword is uncorrectable.
+ */
+int rs16_decode(const rs16_code_t *rs, uint16_t *word, int len, const uint16_t *syndromes,
+                const int *erasures, int n_erasures) {
+    static uint16_t values[GF16_SIZE], derivative[GF16_SIZE];
+    int nroots = rs->nroots;
+    int result = -1;
+    int nonzero = 0;
+
+    if (n_erasures > nroots) {
+        return -1;
+    }
+    for (int j = 0; j < nroots; j++) {
+        nonzero |= syndromes[j];
+    }
+    if (!nonzero) {
+        return 0;
+    }
+
+    uint16_t *lambda = calloc(4 * (nroots + 1), sizeof(uint16_t));
+    int *position = malloc(nroots * sizeof(int));
+    if (!lambda || !position) {
+        free(lambda);
+        free(position);
+        return -1;
+    }
+    uint16_t *b = lambda + (nroots + 1);
+    uint16_t *next = b + (nroots + 1);
+    uint16_t *omega = next + (nroots + 1);
+
+    // Erasure locator: product of (1 + X x) over the erased positions
+    lambda[0] = 1;
+    for (int e = 0; e < n_erasures; e++) {
+        uint16_t x = gf16_alpha(len - 1 - erasures[e]);
+        for (int j = e + 1; j > 0; j--) {
+            lambda[j] ^= gf16_mul(x, lambda[j - 1]);
+        }
+    }
+    memcpy(b, lambda, (nroots + 1) * sizeof(uint16_t));
+
+    int el = n_erasures;
+    for (int r = n_erasures + 1; r <= nroots; r++) {
+        uint16_t disc = 0;
+        for (int i = 0; i < r; i++) {
+            disc ^= gf16_mul(lambda[i], syndromes[r - 1 - i]);
+        }
+        if (disc == 0) {
+            memmove(b + 1, b, nroots * sizeof(uint16_t));
+            b[0] = 0;
+            continue;
+        }
+        next[0] = lambda[0];
+        for (int i = 1; i <= nroots; i++) {
+            next[i] = lambda[i] ^ gf16_mul(disc, b[i - 1]);
+        }
+        if (2 * el <= r + n_erasures - 1) {
+            el = r + n_erasures - el;
+            for (int i = 0; i <= nroots; i++) {
+                b[i] = gf16_div(lambda[i], disc);
+            }
+        } else {
+            memmove(b + 1, b, nroots * sizeof(uint16_t));
+            b[0] = 0;
+        }
+        memcpy(lambda, next, (nroots + 1) * sizeof(uint16_t));
+    }
+
+    int degree = nroots;
+    while (degree > 0 && lambda[degree] == 0) {
+        degree--;
+    }
+    if (degree == 0) {
+        goto done;
+    }
+
+    // Roots of lambda are the inverses of the errata locators alpha^(len-1-i)
+    int count = 0;
+    if ((long)len * degree > RS16_FFT_WORK) {
+        memcpy(values, lambda, (degree + 1) * sizeof(uint16_t));
+        gf16_fft_eval(values, degree + 1);
+        for (long x = 1; x < GF16_SIZE && count <= degree; x++) {
+            if (values[x] == 0) {
+                int power = (GF16_ORDER - gf16_log[x]) % GF16_ORDER;
+                if (power >= len || count == degree) {
+                    goto done;
+                }
+                position[count++] = len - 1 - power;
+            }
+        }
+    } else {
+        for (int i = 0; i < len && count <= degree; i++) {
+            if (gf16_poly_eval(lambda, degree, gf16_alpha(-(long)(len - 1 - i))) == 0) {
+                if (count == degree) {
+                    goto done;
+                }
+                position[count++] = i;
+            }
+        }
+    }
+    if (count != degree) {
+        goto done;
+    }
+
+    // Errata evaluator omega = S(x) lambda(x) mod x^nroots
+    for (int i = 0; i < nroots; i++) {
+        uint16_t v = 0;
+        for (int j = 0; j <= degree && j <= i; j++) {
+            v ^= gf16_mul(lambda[j], syndromes[i - j]);
+        }
+        omega[i] = v;
+    }
+
+    // Forney: e = omega(X^-1) / lambda'(X^-1); lambda' keeps the odd terms
+    memset(derivative, 0, degree * sizeof(uint16_t));
+    for (int i = 1; i <= degree; i += 2) {
+        derivative[i - 1] = lambda[i];
+    }
+    int use_fft = (long)count * nroots > RS16_FFT_WORK;
+    if (use_fft) {
+        memcpy(values, omega, nroots * sizeof(uint16_t));
+        gf16_fft_eval(values, nroots);
+        gf16_fft_eval(derivative, degree);
+    }
+    for (int i = 0; i < count; i++) {
+        uint16_t x_inv = gf16_alpha(-(long)(len - 1 - position[i]));
+        uint16_t num, den;
+        if (use_fft) {
+            num = values[x_inv];
+            den = derivative[x_inv];
+        } else {
+            num = gf16_poly_eval(omega, nroots - 1, x_inv);
+            den = gf16_poly_eval(derivative, degree - 1, x_inv);
+        }
+        if (den == 0) {
+            goto done;
+        }
+        word[position[i]] ^= gf16_div(num, den);
+    }
+    result = count;
+
+done:
+    free(lambda);
+    free(position);
+    return result;
+}
+
+/**
+ * Correct up to RS16_LANES codewords in place. words[lane] has len[lane]
+ * symbols, of which only the first present[lane] were received: the rest
+ * (zero-filled by the caller) are decoded as erasures. status[lane] is the
+ * number of symbols corrected, or -1.
+ */
+void rs16_decode_batch(const rs16_code_t *rs, uint16_t *const *words, const int *len,
+                       const int *present, int count, int *status) {
+    int nroots = rs->nroots;
+    uint16_t *syndromes = malloc((size_t)RS16_LANES * nroots * sizeof(uint16_t));
+    int *erasures = malloc((nroots + 1) * sizeof(int));
+    uint16_t *lane_syndromes[RS16_LANES] = { NULL };
+
+    if (!syndromes || !erasures) {
+        for (int lane = 0; lane < count; lane++) {
+            status[lane] = -1;
+        }
+        free(syndromes);
+        free(erasures);
+        return;
+    }
+    for (int lane = 0; lane < count; lane++) {
+        lane_syndromes[lane] = syndromes + (long)lane * nroots;
+    }
+    rs16_syndromes_batch(rs, (const uint16_t *const *)words, len, count, lane_syndromes);
+
+    for (int lane = 0; lane < count; lane++) {
+        int n_erasures = len[lane] - present[lane];
+        for (int i = 0; i < n_erasures && i <= nroots; i++) {
+            erasures[i] = present[lane] + i;
+        }
+        status[lane] = rs16_decode(rs, words[lane], len[lane], lane_syndromes[lane],
+                                   erasures, n_erasures);
+    }
+    free(syndromes);
+    free(erasures);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Archive header                                                           */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Output of --gf16: "RS16", n and k (16-bit) and the input length in bytes
+ * (64-bit), all little-endian, then the codewords. Symbols are pairs of
+ * input bytes, little-endian, and the last codeword is shortened to the
+ * data that is left.
+ */
+void rs16_put_header(uint8_t *header, int n, int k, uint64_t length) {
+    memcpy(header, RS16_MAGIC, 4);
+    header[4] = n & 0xFF;
+    header[5] = n >> 8;
+    header[6] = k & 0xFF;
+    header[7] = k >> 8;
+    for (int i = 0; i < 8; i++) {
+        header[8 + i] = (uint8_t)(length >> (8 * i));
+    }
+}
+
+int rs16_get_header(const uint8_t *header, int *n, int *k, uint64_t *length) {
+    if (memcmp(header, RS16_MAGIC, 4) != 0) {
+        return -1;
+    }
+    *n = header[4] | (header[5] << 8);
+    *k = header[6] | (header[7] << 8);
+    *length = 0;
+    for (int i = 0; i < 8; i++) {
+        *length |= (uint64_t)header[8 + i] << (8 * i);
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Checkpoints for long encode_file / decode_file runs (included by the
+ * encoder and decoder for --checkpoint).
+ *
+ * Every CHECKPOINT_BLOCKS blocks the output is flushed and fsync'ed, and
+ * only then is the checkpoint written: the input offset to continue from,
+ * the output offset that is on disk and the caller's running counters. It
+ * goes to a temporary file that is fsync'ed and renamed over the previous
+ * checkpoint, then the directory is fsync'ed, so a checkpoint never points
+ * past durable output. Rerunning the same command finds it, cuts the output
+ * back to the recorded offset (whatever was written after it is redone)
+ * and carries on from the recorded input offset. The checkpoint is removed
+ * once the run completes.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define CHECKPOINT_MAGIC 0x52534350u    // "RSCP"
+#define CHECKPOINT_BLOCKS 16384         // Blocks between checkpoints (about 4 MB)
+#define CHECKPOINT_COUNTERS 7
+
+typedef struct {
+    uint32_t magic;
+    uint32_t mode;                      // Caller's mode flags, must match to resume
+    uint64_t input_size;                // The input must be unchanged to resume
+    int64_t input_mtime_ns;
+    uint64_t input_offset;              // Next input byte to process
+    uint64_t output_offset;             // Output bytes known to be on disk
+    int64_t counters[CHECKPOINT_COUNTERS];
+} checkpoint_t;
+
+typedef struct {
+    int enabled;
+    int resumed;
+    long since;                         // Blocks since the last checkpoint
+    char path[4096];
+    char tmp_path[4096];
+    char dir[4096];
+    checkpoint_t state;
+} checkpointer_t;
+
+static int fsync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return -1;
+    }
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+/**
+ * Prepare checkpoints for a run writing 'output_file' (kept in
+ * output_file.ckpt) and load a matching checkpoint from an interrupted
+ * run. Streams cannot be resumed, so "-" on either side disables them.
+ */
+void checkpoint_init(checkpointer_t *cp, const char *input_file, const char *output_file, uint32_t mode) {
+    struct stat st;
+
+    memset(cp, 0, sizeof(*cp));
+    if (strcmp(input_file, "-") == 0 || strcmp(output_file, "-") == 0 ||
+        stat(input_file, &st) < 0 || !S_ISREG(st.st_mode)) {
+        printf("Note: checkpoints need a regular input and output file, disabled\n");
+        return;
+    }
+    snprintf(cp->path, sizeof(cp->path), "%s.ckpt", output_file);
+    snprintf(cp->tmp_path, sizeof(cp->tmp_path), "%s.ckpt.tmp", output_file);
+    const char *slash = strrchr(output_file, '/');
+    snprintf(cp->dir, sizeof(cp->dir), "%.*s", slash ? (int)(slash - output_file) + 1 : 1,
+             slash ? output_file : ".");
+    cp->enabled = 1;
+
+    cp->state.magic = CHECKPOINT_MAGIC;
+    cp->state.mode = mode;
+    cp->state.input_size = st.st_size;
+    cp->state.input_mtime_ns = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+    checkpoint_t saved;
+    FILE *fp = fopen(cp->path, "rb");
+    if (!fp) {
+        return;
+    }
+    if (fread(&saved, sizeof(saved), 1, fp) == 1 && saved.magic == CHECKPOINT_MAGIC &&
+        saved.mode == mode && saved.input_size == cp->state.input_size &&
+        saved.input_mtime_ns == cp->state.input_mtime_ns && saved.input_offset <= saved.input_size) {
+        cp->state = saved;
+        cp->resumed = 1;
+    } else {
+        printf("Note: ignoring checkpoint %s from a different run\n", cp->path);
+    }
+    fclose(fp);
+}
+
+/**
+ * Open the output: truncated for a fresh run, or cut back to the
+ * checkpointed offset when resuming
+ */
+FILE *checkpoint_open_output(checkpointer_t *cp, const char *output_file) {
+    if (!cp->resumed) {
+        return fopen(output_file, "wb");
+    }
+    FILE *fp = fopen(output_file, "r+b");
+    if (!fp || ftruncate(fileno(fp), cp->state.output_offset) < 0 ||
+        fseeko(fp, cp->state.output_offset, SEEK_SET) < 0) {
+        if (fp) {
+            fclose(fp);
+        }
+        // Nothing usable to resume into: start over
+        cp->resumed = 0;
+        memset(cp->state.counters, 0, sizeof(cp->state.counters));
+        cp->state.input_offset = cp->state.output_offset = 0;
+        return fopen(output_file, "wb");
+    }
+    return fp;
+}
+
+int checkpoint_seek_input(checkpointer_t *cp, FILE *input_fp) {
+    if (!cp->resumed) {
+        return 0;
+    }
+    printf("Resuming from checkpoint: input offset %llu, output offset %llu\n",
+           (unsigned long long)cp->state.input_offset, (unsigned long long)cp->state.output_offset);
+    return fseeko(input_fp, cp->state.input_offset, SEEK_SET);
+}
+
+// Count 'blocks' more blocks; true when a checkpoint is due
+int checkpoint_due(checkpointer_t *cp, int blocks) {
+    if (!cp->enabled) {
+        return 0;
+    }
+    cp->since += blocks;
+    return cp->since >= CHECKPOINT_BLOCKS;
+}
+
+/**
+ * Make the output durable up to its current position, then record that
+ * position with the input offset and counters. Returns -1 if either step
+ * fails (the previous checkpoint is left in place).
+ */
+int checkpoint_save(checkpointer_t *cp, FILE *output_fp, uint64_t input_offset, const int64_t *counters) {
+    cp->since = 0;
+    if (fflush(output_fp) != 0 || fsync(fileno(output_fp)) < 0) {
+        printf("Error: Cannot sync output for checkpoint (%s)\n", strerror(errno));
+        return -1;
+    }
+    cp->state.input_offset = input_offset;
+    cp->state.output_offset = ftello(output_fp);
+    memcpy(cp->state.counters, counters, sizeof(cp->state.counters));
+
+    int fd = open(cp->tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("Error: Cannot write checkpoint %s (%s)\n", cp->path, strerror(errno));
+        return -1;
+    }
+    // Close and remove the temp file on any failure, so repeated failures leak nothing
+    errno = 0;
+    int failed = write(fd, &cp->state, sizeof(cp->state)) != (ssize_t)sizeof(cp->state) || fsync(fd) < 0;
+    failed |= close(fd) < 0;
+    if (failed || rename(cp->tmp_path, cp->path) < 0) {
+        printf("Error: Cannot write checkpoint %s (%s)\n", cp->path, strerror(errno ? errno : ENOSPC));
+        unlink(cp->tmp_path);
+        return -1;
+    }
+    if (fsync_dir(cp->dir) < 0) {
+        printf("Error: Cannot write checkpoint %s (%s)\n", cp->path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// The run finished: its checkpoint is no longer needed
+void checkpoint_done(checkpointer_t *cp) {
+    if (cp->enabled) {
+        unlink(cp->path);
+        fsync_dir(cp->dir);
+    }
+}
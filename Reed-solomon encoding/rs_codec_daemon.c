@@ -0,0 +1,731 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// Reuse the field tables and the scalar decoder
+#define RS_DECODER_NO_MAIN
+#include "rs_decoding_binary.c"
+
+/*
+ * Reed-Solomon codec service.
+ *
+ * Clients connect to a Unix seqpacket socket and hand over a memfd holding
+ * their codeword slots. Requests name a slot and an operation; the server
+ * gathers requests from every client, runs them through the batch kernels
+ * below (one codeword per SIMD lane) and replies with the request id and
+ * status as each batch completes, so a client can keep many requests in
+ * flight. Encode reads K data bytes from the slot and writes the N-byte
+ * codeword back; decode corrects the N-byte codeword in place.
+ */
+#define RS_SOCKET_PATH "/tmp/rs_codec.sock"
+#define RS_SLOT_SIZE 256
+#define RS_MAX_CLIENTS 64
+#define RS_MAX_PENDING 1024
+#define RS_MAX_REPLIES (3 * RS_MAX_PENDING)   // Per client; see read_requests
+#define RS_MAX_SLOTS 65536    // Per client: 16 MB of slot memory
+
+#if defined(__AVX2__)
+#define RS_LANES 32
+#else
+#define RS_LANES 16
+#endif
+
+enum { RS_OP_ENCODE = 1, RS_OP_DECODE = 2 };
+
+typedef struct {
+    uint32_t op;
+    uint32_t id;
+    uint32_t slot;
+} rs_request_t;
+
+typedef struct {
+    uint32_t id;
+    int32_t status;   // Encode: 0; decode: symbols corrected or -1
+} rs_reply_t;
+
+typedef struct {
+    uint32_t slots;
+} rs_hello_t;
+
+/**
+ * Multiplication by a constant, split into low and high nibble tables:
+ * c*x = lo[x & 15] ^ hi[x >> 4]. Sixteen-entry tables fit one byte-shuffle,
+ * which multiplies every lane at once.
+ */
+typedef struct {
+    uint8_t lo[16] __attribute__((aligned(16)));
+    uint8_t hi[16] __attribute__((aligned(16)));
+} gf_nibble_table_t;
+
+static uint8_t rs_generator[PARITY + 1];
+static gf_nibble_table_t generator_tab[PARITY];
+static gf_nibble_table_t alpha_tab[PARITY];
+
+static void nibble_table(uint8_t c, gf_nibble_table_t *tab) {
+    for (int x = 0; x < 16; x++) {
+        tab->lo[x] = gf_mult(c, x);
+        tab->hi[x] = gf_mult(c, x << 4);
+    }
+}
+
+/**
+ * Generator polynomial g(x) = (x - α^0)...(x - α^31), as in the encoder
+ */
+void init_batch_kernels(void) {
+    memset(rs_generator, 0, sizeof(rs_generator));
+    rs_generator[0] = 1;
+    for (int i = 0; i < PARITY; i++) {
+        uint8_t alpha_i = gf_pow(ALPHA, i);
+        for (int j = i + 1; j > 0; j--) {
+            rs_generator[j] = rs_generator[j - 1] ^ gf_mult(rs_generator[j], alpha_i);
+        }
+        rs_generator[0] = gf_mult(rs_generator[0], alpha_i);
+    }
+    for (int i = 0; i < PARITY; i++) {
+        nibble_table(rs_generator[i], &generator_tab[i]);
+        nibble_table(gf_pow(ALPHA, i), &alpha_tab[i]);
+    }
+}
+
+#if defined(__AVX2__)
+typedef __m256i lane_vec_t;
+#define vec_load(p) _mm256_load_si256((const __m256i *)(p))
+#define vec_store(p, v) _mm256_store_si256((__m256i *)(p), v)
+#define vec_xor(a, b) _mm256_xor_si256(a, b)
+#define vec_zero() _mm256_setzero_si256()
+
+static inline lane_vec_t vec_mul(lane_vec_t x, const gf_nibble_table_t *tab) {
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)tab->lo));
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)tab->hi));
+    __m256i xl = _mm256_and_si256(x, mask);
+    __m256i xh = _mm256_and_si256(_mm256_srli_epi16(x, 4), mask);
+    return _mm256_xor_si256(_mm256_shuffle_epi8(lo, xl), _mm256_shuffle_epi8(hi, xh));
+}
+#elif defined(__SSSE3__)
+typedef __m128i lane_vec_t;
+#define vec_load(p) _mm_load_si128((const __m128i *)(p))
+#define vec_store(p, v) _mm_store_si128((__m128i *)(p), v)
+#define vec_xor(a, b) _mm_xor_si128(a, b)
+#define vec_zero() _mm_setzero_si128()
+
+static inline lane_vec_t vec_mul(lane_vec_t x, const gf_nibble_table_t *tab) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    __m128i lo = _mm_load_si128((const __m128i *)tab->lo);
+    __m128i hi = _mm_load_si128((const __m128i *)tab->hi);
+    __m128i xl = _mm_and_si128(x, mask);
+    __m128i xh = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+    return _mm_xor_si128(_mm_shuffle_epi8(lo, xl), _mm_shuffle_epi8(hi, xh));
+}
+#else
+typedef struct { uint8_t b[RS_LANES]; } lane_vec_t;
+
+static inline lane_vec_t vec_load(const uint8_t *p) {
+    lane_vec_t v;
+    memcpy(v.b, p, RS_LANES);
+    return v;
+}
+#define vec_store(p, v) memcpy((p), (v).b, RS_LANES)
+
+static inline lane_vec_t vec_xor(lane_vec_t a, lane_vec_t b) {
+    for (int i = 0; i < RS_LANES; i++) a.b[i] ^= b.b[i];
+    return a;
+}
+
+static inline lane_vec_t vec_zero(void) {
+    lane_vec_t v;
+    memset(v.b, 0, RS_LANES);
+    return v;
+}
+
+static inline lane_vec_t vec_mul(lane_vec_t x, const gf_nibble_table_t *tab) {
+    for (int i = 0; i < RS_LANES; i++) x.b[i] = tab->lo[x.b[i] & 15] ^ tab->hi[x.b[i] >> 4];
+    return x;
+}
+#endif
+
+/**
+ * Encode up to RS_LANES codewords at once. The data is transposed so that
+ * symbol i of every codeword sits in one vector, then the usual LFSR
+ * division runs with one codeword per lane.
+ */
+void rs_encode_batch(uint8_t *const *codewords, int count) {
+    static uint8_t column[K][RS_LANES] __attribute__((aligned(32)));
+    static uint8_t parity[PARITY][RS_LANES] __attribute__((aligned(32)));
+    lane_vec_t remainder[PARITY];
+
+    memset(column, 0, sizeof(column));
+    for (int lane = 0; lane < count; lane++) {
+        for (int i = 0; i < K; i++) {
+            column[i][lane] = codewords[lane][i];
+        }
+    }
+
+    for (int j = 0; j < PARITY; j++) {
+        remainder[j] = vec_zero();
+    }
+    for (int i = 0; i < K; i++) {
+        lane_vec_t feedback = vec_xor(vec_load(column[i]), remainder[PARITY - 1]);
+        for (int j = PARITY - 1; j > 0; j--) {
+            remainder[j] = vec_xor(remainder[j - 1], vec_mul(feedback, &generator_tab[j]));
+        }
+        remainder[0] = vec_mul(feedback, &generator_tab[0]);
+    }
+
+    for (int j = 0; j < PARITY; j++) {
+        vec_store(parity[j], remainder[j]);
+    }
+    for (int lane = 0; lane < count; lane++) {
+        for (int i = 0; i < PARITY; i++) {
+            codewords[lane][K + i] = parity[PARITY - 1 - i][lane];
+        }
+    }
+}
+
+/**
+ * Decode up to RS_LANES codewords in place. Syndromes for all lanes are
+ * computed together; only codewords with a non-zero syndrome go on to the
+ * scalar Berlekamp-Massey / Chien / Forney stages.
+ */
+void rs_decode_batch(uint8_t *const *codewords, int count, int *status) {
+    static uint8_t column[N][RS_LANES] __attribute__((aligned(32)));
+    static uint8_t syndromes[PARITY][RS_LANES] __attribute__((aligned(32)));
+    lane_vec_t s[PARITY];
+
+    memset(column, 0, sizeof(column));
+    for (int lane = 0; lane < count; lane++) {
+        for (int j = 0; j < N; j++) {
+            column[j][lane] = codewords[lane][j];
+        }
+    }
+
+    for (int i = 0; i < PARITY; i++) {
+        s[i] = vec_zero();
+    }
+    for (int j = 0; j < N; j++) {
+        lane_vec_t r = vec_load(column[j]);
+        for (int i = 0; i < PARITY; i++) {
+            s[i] = vec_xor(vec_mul(s[i], &alpha_tab[i]), r);
+        }
+    }
+    for (int i = 0; i < PARITY; i++) {
+        vec_store(syndromes[i], s[i]);
+    }
+
+    for (int lane = 0; lane < count; lane++) {
+        int clean = 1;
+        for (int i = 0; i < PARITY; i++) {
+            if (syndromes[i][lane]) {
+                clean = 0;
+                break;
+            }
+        }
+        if (clean) {
+            status[lane] = 0;
+            continue;
+        }
+
+        uint8_t corrected[N];
+        status[lane] = rs_decode_block(codewords[lane], corrected);
+        if (status[lane] >= 0) {
+            memcpy(codewords[lane], corrected, N);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Server                                                                   */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    int fd;
+    uint8_t *shm;
+    uint32_t slots;
+    size_t shm_size;
+    rs_reply_t replies[RS_MAX_REPLIES];   // Waiting for room in the socket
+    int reply_head;
+    int reply_count;
+    int failed;                           // Reply queue overflowed; drop it
+} rs_client_conn_t;
+
+typedef struct {
+    int client;
+    rs_request_t request;
+} rs_pending_t;
+
+typedef struct {
+    rs_client_conn_t clients[RS_MAX_CLIENTS];
+    rs_pending_t pending[2][RS_MAX_PENDING];   // Encode and decode queues
+    int pending_count[2];
+    unsigned long requests;
+    unsigned long batches;
+} rs_server_t;
+
+static volatile sig_atomic_t server_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    server_stop = 1;
+}
+
+static int recv_fd(int sock, void *buf, size_t len, int *fd) {
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { buf, len };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(sock, &msg, 0);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (n != (ssize_t)len || !cmsg || cmsg->cmsg_type != SCM_RIGHTS) {
+        return -1;
+    }
+    memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    return 0;
+}
+
+static void drop_client(rs_server_t *server, int c) {
+    rs_client_conn_t *client = &server->clients[c];
+
+    // Forget its queued work; the slots are about to be unmapped
+    for (int q = 0; q < 2; q++) {
+        int kept = 0;
+        for (int i = 0; i < server->pending_count[q]; i++) {
+            if (server->pending[q][i].client != c) {
+                server->pending[q][kept++] = server->pending[q][i];
+            }
+        }
+        server->pending_count[q] = kept;
+    }
+    if (client->shm) {
+        munmap(client->shm, client->shm_size);
+    }
+    close(client->fd);
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+}
+
+static void queue_reply(rs_client_conn_t *client, uint32_t id, int32_t status) {
+    if (client->reply_count == RS_MAX_REPLIES) {
+        client->failed = 1;
+        return;
+    }
+    client->replies[(client->reply_head + client->reply_count++) % RS_MAX_REPLIES] = (rs_reply_t){ id, status };
+}
+
+/**
+ * Send queued replies until the socket is full. Replies never block the
+ * server: a client that stops reading them keeps its queue until it does.
+ * Returns -1 if the client has to be dropped.
+ */
+static int flush_replies(rs_client_conn_t *client) {
+    if (client->failed) {
+        return -1;
+    }
+    while (client->reply_count > 0) {
+        ssize_t n = send(client->fd, &client->replies[client->reply_head], sizeof(rs_reply_t),
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (n != (ssize_t)sizeof(rs_reply_t)) {
+            return -1;
+        }
+        client->reply_head = (client->reply_head + 1) % RS_MAX_REPLIES;
+        client->reply_count--;
+    }
+    return 0;
+}
+
+static void accept_client(rs_server_t *server, int listen_fd) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) return;
+
+    rs_hello_t hello;
+    int memfd = -1;
+    int c;
+    for (c = 0; c < RS_MAX_CLIENTS && server->clients[c].fd >= 0; c++);
+
+    if (c == RS_MAX_CLIENTS || recv_fd(fd, &hello, sizeof(hello), &memfd) < 0 || hello.slots == 0 ||
+        hello.slots > RS_MAX_SLOTS) {
+        if (memfd >= 0) close(memfd);
+        close(fd);
+        return;
+    }
+
+    // Mapping past the end of a short memfd would fault on the first slot access
+    struct stat st;
+    size_t size = (size_t)hello.slots * RS_SLOT_SIZE;
+    if (fstat(memfd, &st) < 0 || st.st_size < (off_t)size) {
+        close(memfd);
+        close(fd);
+        return;
+    }
+    uint8_t *shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    close(memfd);
+    if (shm == MAP_FAILED) {
+        close(fd);
+        return;
+    }
+
+    server->clients[c].fd = fd;
+    server->clients[c].shm = shm;
+    server->clients[c].slots = hello.slots;
+    server->clients[c].shm_size = size;
+}
+
+static void read_requests(rs_server_t *server, int c) {
+    rs_client_conn_t *client = &server->clients[c];
+    rs_request_t request;
+
+    for (;;) {
+        // Leave the rest in the socket until the queues drain. Holding back
+        // a client with RS_MAX_PENDING replies unsent bounds its reply queue
+        // by that plus both request queues.
+        if (server->pending_count[0] == RS_MAX_PENDING || server->pending_count[1] == RS_MAX_PENDING ||
+            client->reply_count >= RS_MAX_PENDING) {
+            return;
+        }
+        ssize_t n = recv(client->fd, &request, sizeof(request), MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (n != (ssize_t)sizeof(request)) {
+            drop_client(server, c);
+            return;
+        }
+
+        int q = (request.op == RS_OP_ENCODE) ? 0 : (request.op == RS_OP_DECODE) ? 1 : -1;
+        if (q < 0 || request.slot >= client->slots) {
+            queue_reply(client, request.id, -1);
+            continue;
+        }
+        server->pending[q][server->pending_count[q]++] = (rs_pending_t){ c, request };
+        server->requests++;
+    }
+}
+
+static void run_batches(rs_server_t *server, int q) {
+    rs_pending_t *pending = server->pending[q];
+
+    for (int start = 0; start < server->pending_count[q]; start += RS_LANES) {
+        int count = server->pending_count[q] - start;
+        if (count > RS_LANES) count = RS_LANES;
+
+        uint8_t *codewords[RS_LANES];
+        int status[RS_LANES] = { 0 };
+        for (int i = 0; i < count; i++) {
+            rs_client_conn_t *client = &server->clients[pending[start + i].client];
+            codewords[i] = client->shm + (size_t)pending[start + i].request.slot * RS_SLOT_SIZE;
+        }
+
+        if (q == 0) {
+            rs_encode_batch(codewords, count);
+        } else {
+            rs_decode_batch(codewords, count, status);
+        }
+        server->batches++;
+
+        for (int i = 0; i < count; i++) {
+            queue_reply(&server->clients[pending[start + i].client], pending[start + i].request.id, status[i]);
+        }
+    }
+    server->pending_count[q] = 0;
+}
+
+int serve(const char *path) {
+    static rs_server_t server;
+    struct pollfd fds[RS_MAX_CLIENTS + 1];
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    for (int c = 0; c < RS_MAX_CLIENTS; c++) {
+        server.clients[c].fd = -1;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, RS_MAX_CLIENTS) < 0) {
+        printf("Error: Cannot listen on %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("RS codec service on %s (%d lanes per batch)\n", path, RS_LANES);
+    fflush(stdout);
+
+    while (!server_stop) {
+        int nfds = 0;
+        int map[RS_MAX_CLIENTS];
+        fds[nfds++] = (struct pollfd){ listen_fd, POLLIN, 0 };
+        for (int c = 0; c < RS_MAX_CLIENTS; c++) {
+            if (server.clients[c].fd >= 0) {
+                map[nfds - 1] = c;
+                short events = server.clients[c].reply_count ? POLLIN | POLLOUT : POLLIN;
+                fds[nfds++] = (struct pollfd){ server.clients[c].fd, events, 0 };
+            }
+        }
+
+        // Block only when nothing is queued; otherwise take whatever else
+        // has arrived and then run the batch
+        int queued = server.pending_count[0] + server.pending_count[1];
+        int ready = poll(fds, nfds, queued ? 0 : 1000);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+
+        if (ready > 0) {
+            if (fds[0].revents & POLLIN) {
+                accept_client(&server, listen_fd);
+            }
+            for (int i = 1; i < nfds; i++) {
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    read_requests(&server, map[i - 1]);
+                }
+            }
+        }
+
+        int full = server.pending_count[0] == RS_MAX_PENDING || server.pending_count[1] == RS_MAX_PENDING;
+        if (ready <= 0 || full) {
+            run_batches(&server, 0);
+            run_batches(&server, 1);
+        }
+
+        for (int c = 0; c < RS_MAX_CLIENTS; c++) {
+            if (server.clients[c].fd >= 0 && flush_replies(&server.clients[c]) < 0) {
+                drop_client(&server, c);
+            }
+        }
+    }
+
+    printf("RS codec service: %lu requests in %lu batches (%.1f per batch)\n",
+           server.requests, server.batches,
+           server.batches ? (double)server.requests / server.batches : 0.0);
+    for (int c = 0; c < RS_MAX_CLIENTS; c++) {
+        if (server.clients[c].fd >= 0) drop_client(&server, c);
+    }
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Client                                                                   */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    int sock;
+    uint8_t *shm;
+    uint32_t slots;
+} rs_client_t;
+
+int rs_client_connect(rs_client_t *client, const char *path, uint32_t slots) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    client->sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (client->sock < 0 || connect(client->sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        if (client->sock >= 0) close(client->sock);
+        return -1;
+    }
+
+    int memfd = syscall(SYS_memfd_create, "rs_codec_slots", 0);
+    size_t size = (size_t)slots * RS_SLOT_SIZE;
+    if (memfd < 0 || ftruncate(memfd, size) < 0) {
+        if (memfd >= 0) close(memfd);
+        close(client->sock);
+        return -1;
+    }
+    client->shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    client->slots = slots;
+
+    // Hand the slot memory to the server along with the hello
+    rs_hello_t hello = { slots };
+    char control[CMSG_SPACE(sizeof(int))] = { 0 };
+    struct iovec iov = { &hello, sizeof(hello) };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+    int sent = sendmsg(client->sock, &msg, 0);
+    close(memfd);
+    if (client->shm == MAP_FAILED || sent < 0) {
+        if (client->shm != MAP_FAILED) munmap(client->shm, size);
+        close(client->sock);
+        return -1;
+    }
+    return 0;
+}
+
+uint8_t *rs_client_slot(rs_client_t *client, uint32_t slot) {
+    return client->shm + (size_t)slot * RS_SLOT_SIZE;
+}
+
+int rs_client_submit(rs_client_t *client, uint32_t op, uint32_t slot, uint32_t id) {
+    rs_request_t request = { op, id, slot };
+    return send(client->sock, &request, sizeof(request), MSG_NOSIGNAL) == sizeof(request) ? 0 : -1;
+}
+
+int rs_client_wait(rs_client_t *client, rs_reply_t *reply) {
+    return recv(client->sock, reply, sizeof(*reply), 0) == sizeof(*reply) ? 0 : -1;
+}
+
+void rs_client_close(rs_client_t *client) {
+    munmap(client->shm, (size_t)client->slots * RS_SLOT_SIZE);
+    close(client->sock);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Benchmark                                                                */
+/* ---------------------------------------------------------------------- */
+
+#define BENCH_WINDOW 64       // Requests each client keeps in flight
+#define BENCH_ERRORS 8        // Symbol errors injected before decoding...
+#define BENCH_ERROR_EVERY 4   // ...into every fourth codeword
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * One client: encode 'blocks' random blocks, corrupt some codewords, decode
+ * them again and check the data comes back. Returns the number of mismatches.
+ */
+static int bench_client(const char *path, int blocks, unsigned seed) {
+    rs_client_t client;
+    uint8_t reference[BENCH_WINDOW][K];
+    int mismatches = 0;
+
+    if (rs_client_connect(&client, path, BENCH_WINDOW) < 0) {
+        printf("Error: Cannot connect to %s\n", path);
+        return -1;
+    }
+    srand(seed);
+
+    for (int done = 0; done < blocks; done += BENCH_WINDOW) {
+        int count = blocks - done < BENCH_WINDOW ? blocks - done : BENCH_WINDOW;
+        rs_reply_t reply;
+
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < K; j++) reference[i][j] = rand();
+            memcpy(rs_client_slot(&client, i), reference[i], K);
+            rs_client_submit(&client, RS_OP_ENCODE, i, i);
+        }
+        for (int i = 0; i < count; i++) {
+            if (rs_client_wait(&client, &reply) < 0) return -1;
+            uint8_t *cw = rs_client_slot(&client, reply.id);
+            if ((done + reply.id) % BENCH_ERROR_EVERY == 0) {
+                for (int e = 0; e < BENCH_ERRORS; e++) cw[rand() % N] ^= 1 + rand() % 255;
+            }
+            rs_client_submit(&client, RS_OP_DECODE, reply.id, reply.id);
+        }
+        for (int i = 0; i < count; i++) {
+            if (rs_client_wait(&client, &reply) < 0) return -1;
+            if (reply.status < 0 || memcmp(rs_client_slot(&client, reply.id), reference[reply.id], K) != 0) {
+                mismatches++;
+            }
+        }
+    }
+
+    rs_client_close(&client);
+    return mismatches;
+}
+
+/**
+ * Scalar baseline: the same work done in-process one block at a time, as a
+ * tool calling rs_encode_block / rs_decode_block itself would
+ */
+static double bench_scalar(int blocks) {
+    uint8_t data[K], codeword[N], corrected[N];
+    double start = now_seconds();
+
+    for (int b = 0; b < blocks; b++) {
+        uint8_t remainder[PARITY] = { 0 };
+        for (int j = 0; j < K; j++) data[j] = rand();
+        memcpy(codeword, data, K);
+        for (int i = 0; i < K; i++) {
+            uint8_t feedback = data[i] ^ remainder[PARITY - 1];
+            for (int j = PARITY - 1; j > 0; j--) {
+                remainder[j] = remainder[j - 1] ^ gf_mult(rs_generator[j], feedback);
+            }
+            remainder[0] = gf_mult(rs_generator[0], feedback);
+        }
+        for (int i = 0; i < PARITY; i++) codeword[K + i] = remainder[PARITY - 1 - i];
+        if (b % BENCH_ERROR_EVERY == 0) {
+            for (int e = 0; e < BENCH_ERRORS; e++) codeword[rand() % N] ^= 1 + rand() % 255;
+        }
+        rs_decode_block(codeword, corrected);
+    }
+    return now_seconds() - start;
+}
+
+int bench(const char *path, int clients, int blocks) {
+    pid_t server = fork();
+    if (server == 0) {
+        freopen("/dev/null", "w", stdout);
+        _exit(serve(path) < 0 ? 1 : 0);
+    }
+    usleep(100000);
+
+    double start = now_seconds();
+    for (int c = 0; c < clients; c++) {
+        if (fork() == 0) {
+            int bad = bench_client(path, blocks, 1234 + c);
+            _exit(bad == 0 ? 0 : 1);
+        }
+    }
+
+    int failed = 0, status;
+    for (int c = 0; c < clients; c++) {
+        wait(&status);
+        failed += !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    double elapsed = now_seconds() - start;
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    double scalar = bench_scalar(blocks);
+    double total = (double)clients * blocks;
+    printf("Service: %d clients x %d blocks encoded + decoded in %.3f s (%.0f blocks/s)\n",
+           clients, blocks, elapsed, total / elapsed);
+    printf("Scalar:  1 process x %d blocks in %.3f s (%.0f blocks/s)\n", blocks, scalar, blocks / scalar);
+    printf("%s\n", failed ? "Some clients saw wrong results" : "All results verified");
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    init_galois_field();
+    init_batch_kernels();
+
+    if (argc >= 2 && strcmp(argv[1], "--serve") == 0) {
+        return serve(argc >= 3 ? argv[2] : RS_SOCKET_PATH) < 0 ? 1 : 0;
+    }
+    if (argc >= 4 && strcmp(argv[1], "--bench") == 0) {
+        return bench(argc >= 5 ? argv[4] : RS_SOCKET_PATH, atoi(argv[2]), atoi(argv[3]));
+    }
+
+    printf("Usage: %s --serve [SOCKET]\n", argv[0]);
+    printf("       %s --bench CLIENTS BLOCKS [SOCKET]\n", argv[0]);
+    return 1;
+}
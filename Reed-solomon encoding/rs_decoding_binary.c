@@ -1,7 +1,18 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // O_DIRECT for the io_uring raw bandwidth pass
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "rs_uring.c"
+#include "rs16.c"
+#include "rs_checkpoint.c"
+#include "rs_sparse.c"
 
 // Reed-Solomon parameters (CCSDS standard)
 #define N 255           // Codeword length
@@ -11,6 +22,24 @@
 #define PRIM_POLY 0x11D // x^8 + x^7 + x^2 + x + 1
 #define ALPHA 0x02      // Primitive element
 
+// Inner convolutional code (must match the encoder)
+#define CONV_K 7                // Constraint length
+#define CONV_POLY1 0x4F         // G1 = 171 (octal)
+#define CONV_POLY2 0x6D         // G2 = 133 (octal), inverted on the channel
+#define CONV_STATES 64          // 2^(CONV_K-1)
+#define INTERLEAVE_DEPTH 4      // RS codewords per interleaved frame
+#define CONV_CODED_BYTES(len) ((len) * 2 + 2) // Coded bytes for len data bytes incl. tail
+#define SOFT_MAX 255            // Soft symbols: 0 = confident 0, 255 = confident 1
+
+// Attached sync marker and pseudo-randomizer (must match the encoder)
+#define ASM_SIZE 4
+#define MAX_CODEBLOCK (INTERLEAVE_DEPTH * N)
+#define SYNC_MAX_ERRORS 3       // Bit errors tolerated per 32 marker bits
+#define SLIP_WINDOW 16          // Units searched either side of the expected marker
+
+static const uint8_t ASM[ASM_SIZE] = { 0x1A, 0xCF, 0xFC, 0x1D };
+uint8_t randomizer_seq[MAX_CODEBLOCK] __attribute__((aligned(32)));
+
 // Galois field lookup tables
 uint8_t gf_exp[512];
 uint8_t gf_log[256];
@@ -45,13 +74,19 @@ uint8_t gf_pow(uint8_t base, int exp) {
     return (base == 0) ? ((exp == 0) ? 1 : 0) : gf_exp[(gf_log[base] * exp) % 255];
 }
 
+/*
+ * Codewords are stored highest degree first: received[j] is the coefficient
+ * of x^(N-1-j), matching the systematic layout written by the encoder.
+ */
 void compute_syndromes(uint8_t *received, uint8_t *syndromes) {
     for (int i = 0; i < PARITY; i++) {
-        syndromes[i] = 0;
+        // Horner evaluation of r(alpha^i)
         uint8_t alpha_i = gf_pow(ALPHA, i);
+        uint8_t s = 0;
         for (int j = 0; j < N; j++) {
-            syndromes[i] ^= gf_mult(received[j], gf_pow(alpha_i, j));
+            s = gf_mult(s, alpha_i) ^ received[j];
         }
+        syndromes[i] = s;
     }
 }
 
@@ -59,9 +94,12 @@ int berlekamp_massey(uint8_t *syndromes, uint8_t *lambda, uint8_t *omega) {
     uint8_t prev_lambda[PARITY + 1] = {0};
     uint8_t temp[PARITY + 1];
     
+    memset(lambda, 0, PARITY + 1);
     lambda[0] = 1;
     prev_lambda[0] = 1;
-    int deg_lambda = 0, deg_prev = 0;
+    int deg_lambda = 0;
+    int shift = 1;          // Power of x applied to prev_lambda
+    uint8_t prev_disc = 1;  // Discrepancy when prev_lambda was saved
     
     for (int k = 0; k < PARITY; k++) {
         uint8_t disc = syndromes[k];
@@ -69,34 +107,31 @@ int berlekamp_massey(uint8_t *syndromes, uint8_t *lambda, uint8_t *omega) {
             disc ^= gf_mult(lambda[i], syndromes[k - i]);
         }
         
-        if (disc != 0) {
-            memcpy(temp, lambda, sizeof(temp));
-            
-            for (int i = 0; i <= deg_prev; i++) {
-                if (prev_lambda[i] != 0) {
-                    int pos = i + (k - deg_prev);
-                    if (pos <= PARITY) {
-                        lambda[pos] ^= gf_mult(disc, prev_lambda[i]);
-                    }
-                }
-            }
-            
-            int new_deg = deg_prev + (k - deg_prev);
-            if (new_deg > deg_lambda) {
-                deg_lambda = new_deg;
-                memcpy(prev_lambda, temp, sizeof(prev_lambda));
-                deg_prev = k - deg_lambda;
-                
-                // Scale previous lambda
-                uint8_t inv_disc = gf_exp[255 - gf_log[disc]];
-                for (int i = 0; i <= PARITY; i++) {
-                    prev_lambda[i] = gf_mult(prev_lambda[i], inv_disc);
-                }
+        if (disc == 0) {
+            shift++;
+            continue;
+        }
+        
+        // lambda(x) -= (disc / prev_disc) * x^shift * prev_lambda(x)
+        uint8_t scale = gf_div(disc, prev_disc);
+        memcpy(temp, lambda, sizeof(temp));
+        for (int i = 0; i + shift <= PARITY; i++) {
+            if (prev_lambda[i] != 0) {
+                lambda[i + shift] ^= gf_mult(scale, prev_lambda[i]);
             }
         }
+        
+        if (2 * deg_lambda <= k) {
+            deg_lambda = k + 1 - deg_lambda;
+            memcpy(prev_lambda, temp, sizeof(prev_lambda));
+            prev_disc = disc;
+            shift = 1;
+        } else {
+            shift++;
+        }
     }
     
-    // Compute error evaluator polynomial
+    // Compute error evaluator polynomial: omega = S(x) * lambda(x) mod x^PARITY
     memset(omega, 0, PARITY);
     for (int i = 0; i < PARITY; i++) {
         for (int j = 0; j <= deg_lambda && j <= i; j++) {
@@ -110,35 +145,35 @@ int berlekamp_massey(uint8_t *syndromes, uint8_t *lambda, uint8_t *omega) {
 int find_and_correct_errors(uint8_t *lambda, uint8_t *omega, int deg_lambda, uint8_t *corrected) {
     int error_count = 0;
     
+    if (deg_lambda > T) {
+        return -1;
+    }
+    
+    // Chien search over every degree i; position in the block is N-1-i
     for (int i = 0; i < N; i++) {
+        uint8_t alpha_inv_i = gf_pow(ALPHA, (255 - i) % 255);
         uint8_t sum = 0;
         
         // Evaluate error locator polynomial at alpha^(-i)
-        for (int j = 0; j <= deg_lambda; j++) {
-            if (lambda[j] != 0) {
-                sum ^= gf_mult(lambda[j], gf_pow(ALPHA, (255 - i * j) % 255));
-            }
+        for (int j = deg_lambda; j >= 0; j--) {
+            sum = gf_mult(sum, alpha_inv_i) ^ lambda[j];
         }
         
         if (sum == 0) {  
             error_count++;
             
             // Check bounds to prevent overflow
-            if (error_count > T) {
+            if (error_count > deg_lambda) {
                 return -1; 
             }
             
-            uint8_t alpha_inv_i = gf_pow(ALPHA, (255 - i) % 255);
-            
             // Compute error evaluator value
             uint8_t omega_val = 0;
-            for (int j = 0; j < PARITY; j++) {
-                if (omega[j] != 0) {
-                    omega_val ^= gf_mult(omega[j], gf_pow(alpha_inv_i, j));
-                }
+            for (int j = PARITY - 1; j >= 0; j--) {
+                omega_val = gf_mult(omega_val, alpha_inv_i) ^ omega[j];
             }
             
-            // Compute error locator derivative
+            // Compute error locator derivative (odd terms only in GF(2^m))
             uint8_t lambda_prime = 0;
             for (int j = 1; j <= deg_lambda; j += 2) {
                 if (lambda[j] != 0) {
@@ -146,10 +181,12 @@ int find_and_correct_errors(uint8_t *lambda, uint8_t *omega, int deg_lambda, uin
                 }
             }
             
-            // Apply correction if derivative is non-zero
-            if (lambda_prime != 0) {
-                corrected[i] ^= gf_div(omega_val, lambda_prime);
+            if (lambda_prime == 0) {
+                return -1;
             }
+            
+            // Forney with first consecutive root alpha^0: e = X * omega / lambda'
+            corrected[N - 1 - i] ^= gf_mult(gf_pow(ALPHA, i), gf_div(omega_val, lambda_prime));
         }
     }
     
@@ -183,79 +220,997 @@ int rs_decode_block(uint8_t *received, uint8_t *corrected) {
     return find_and_correct_errors(lambda, omega, deg_lambda, corrected);
 }
 
-int decode_file(const char *input_file, const char *output_file) {
-    FILE *input_fp = fopen(input_file, "rb");
+/*
+ * Soft-decision Viterbi decoder for the CCSDS K=7 rate 1/2 code.
+ *
+ * State s is the last six input bits, newest in the LSB. Old states i and
+ * i+32 both lead to new states 2i and 2i+1, and because both generators tap
+ * the first and last register bit, the four branches of that butterfly only
+ * use one branch metric m and its complement 2*SOFT_MAX - m. Path metrics
+ * are 16-bit and renormalised against state 0 after every step, so they stay
+ * bounded by the code's metric spread. Each step records one decision bit
+ * per new state (1 = came from old state i+32) for the traceback.
+ */
+static int16_t branch_tab1[CONV_STATES / 2] __attribute__((aligned(32)));
+static int16_t branch_tab2[CONV_STATES / 2] __attribute__((aligned(32)));
+
+static int parity8(uint8_t x) {
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+void init_viterbi(void) {
+    for (int i = 0; i < CONV_STATES / 2; i++) {
+        // Expected symbols for old state i with input 0: 0 or SOFT_MAX
+        branch_tab1[i] = parity8((uint8_t)((i << 1) & CONV_POLY1)) ? SOFT_MAX : 0;
+        branch_tab2[i] = parity8((uint8_t)((i << 1) & CONV_POLY2)) ? 0 : SOFT_MAX;
+    }
+}
+
+#if defined(__AVX2__)
+static void viterbi_step(const int16_t *old_m, int16_t *new_m, uint64_t *decision,
+                         uint8_t sym1, uint8_t sym2) {
+    const __m256i s1 = _mm256_set1_epi16(sym1);
+    const __m256i s2 = _mm256_set1_epi16(sym2);
+    const __m256i max_bm = _mm256_set1_epi16(2 * SOFT_MAX);
+    uint64_t bits = 0;
+    
+    for (int k = 0; k < 2; k++) {
+        __m256i a = _mm256_load_si256((const __m256i *)(old_m + 16 * k));
+        __m256i b = _mm256_load_si256((const __m256i *)(old_m + 16 * k + 32));
+        __m256i m0 = _mm256_add_epi16(
+            _mm256_xor_si256(s1, _mm256_load_si256((const __m256i *)(branch_tab1 + 16 * k))),
+            _mm256_xor_si256(s2, _mm256_load_si256((const __m256i *)(branch_tab2 + 16 * k))));
+        __m256i m1 = _mm256_sub_epi16(max_bm, m0);
+        
+        __m256i e0 = _mm256_add_epi16(a, m0), e1 = _mm256_add_epi16(b, m1);
+        __m256i o0 = _mm256_add_epi16(a, m1), o1 = _mm256_add_epi16(b, m0);
+        __m256i even = _mm256_min_epi16(e0, e1), even_dec = _mm256_cmpgt_epi16(e0, e1);
+        __m256i odd = _mm256_min_epi16(o0, o1), odd_dec = _mm256_cmpgt_epi16(o0, o1);
+        
+        // Unpacks work per 128-bit lane; re-join the lanes in state order
+        __m256i lo = _mm256_unpacklo_epi16(even, odd), hi = _mm256_unpackhi_epi16(even, odd);
+        _mm256_store_si256((__m256i *)(new_m + 32 * k), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_store_si256((__m256i *)(new_m + 32 * k + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+        
+        lo = _mm256_unpacklo_epi16(even_dec, odd_dec);
+        hi = _mm256_unpackhi_epi16(even_dec, odd_dec);
+        __m256i packed = _mm256_packs_epi16(_mm256_permute2x128_si256(lo, hi, 0x20),
+                                            _mm256_permute2x128_si256(lo, hi, 0x31));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(packed) << (32 * k);
+    }
+    *decision = bits;
+    
+    // Renormalise against state 0
+    __m256i base = _mm256_set1_epi16(new_m[0]);
+    for (int k = 0; k < CONV_STATES; k += 16) {
+        __m256i v = _mm256_load_si256((const __m256i *)(new_m + k));
+        _mm256_store_si256((__m256i *)(new_m + k), _mm256_sub_epi16(v, base));
+    }
+}
+#elif defined(__SSE2__)
+static void viterbi_step(const int16_t *old_m, int16_t *new_m, uint64_t *decision,
+                         uint8_t sym1, uint8_t sym2) {
+    const __m128i s1 = _mm_set1_epi16(sym1);
+    const __m128i s2 = _mm_set1_epi16(sym2);
+    const __m128i max_bm = _mm_set1_epi16(2 * SOFT_MAX);
+    uint64_t bits = 0;
+    
+    for (int k = 0; k < 4; k++) {
+        __m128i a = _mm_load_si128((const __m128i *)(old_m + 8 * k));
+        __m128i b = _mm_load_si128((const __m128i *)(old_m + 8 * k + 32));
+        __m128i m0 = _mm_add_epi16(
+            _mm_xor_si128(s1, _mm_load_si128((const __m128i *)(branch_tab1 + 8 * k))),
+            _mm_xor_si128(s2, _mm_load_si128((const __m128i *)(branch_tab2 + 8 * k))));
+        __m128i m1 = _mm_sub_epi16(max_bm, m0);
+        
+        __m128i e0 = _mm_add_epi16(a, m0), e1 = _mm_add_epi16(b, m1);
+        __m128i o0 = _mm_add_epi16(a, m1), o1 = _mm_add_epi16(b, m0);
+        __m128i even = _mm_min_epi16(e0, e1), even_dec = _mm_cmpgt_epi16(e0, e1);
+        __m128i odd = _mm_min_epi16(o0, o1), odd_dec = _mm_cmpgt_epi16(o0, o1);
+        
+        _mm_store_si128((__m128i *)(new_m + 16 * k), _mm_unpacklo_epi16(even, odd));
+        _mm_store_si128((__m128i *)(new_m + 16 * k + 8), _mm_unpackhi_epi16(even, odd));
+        
+        __m128i packed = _mm_packs_epi16(_mm_unpacklo_epi16(even_dec, odd_dec),
+                                         _mm_unpackhi_epi16(even_dec, odd_dec));
+        bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(packed) << (16 * k);
+    }
+    *decision = bits;
+    
+    // Renormalise against state 0
+    __m128i base = _mm_set1_epi16(new_m[0]);
+    for (int k = 0; k < CONV_STATES; k += 8) {
+        __m128i v = _mm_load_si128((const __m128i *)(new_m + k));
+        _mm_store_si128((__m128i *)(new_m + k), _mm_sub_epi16(v, base));
+    }
+}
+#else
+static void viterbi_step(const int16_t *old_m, int16_t *new_m, uint64_t *decision,
+                         uint8_t sym1, uint8_t sym2) {
+    uint64_t bits = 0;
+    
+    for (int i = 0; i < CONV_STATES / 2; i++) {
+        int16_t m0 = (int16_t)((sym1 ^ branch_tab1[i]) + (sym2 ^ branch_tab2[i]));
+        int16_t m1 = (int16_t)(2 * SOFT_MAX - m0);
+        int16_t e0 = old_m[i] + m0, e1 = old_m[i + 32] + m1;
+        int16_t o0 = old_m[i] + m1, o1 = old_m[i + 32] + m0;
+        
+        new_m[2 * i] = (e0 > e1) ? e1 : e0;
+        new_m[2 * i + 1] = (o0 > o1) ? o1 : o0;
+        bits |= (uint64_t)(e0 > e1) << (2 * i);
+        bits |= (uint64_t)(o0 > o1) << (2 * i + 1);
+    }
+    *decision = bits;
+    
+    int16_t base = new_m[0];
+    for (int i = 0; i < CONV_STATES; i++) {
+        new_m[i] -= base;
+    }
+}
+#endif
+
+/*
+ * Decode one terminated frame of soft symbols (two per input bit, tail
+ * included) into data bytes, MSB first. Returns the number of bytes written.
+ */
+int viterbi_decode(const uint8_t *symbols, int data_bytes, uint8_t *data) {
+    int steps = data_bytes * 8 + (CONV_K - 1);
+    int16_t metrics[2][CONV_STATES] __attribute__((aligned(32)));
+    uint64_t *decisions;
+    
+    if (data_bytes <= 0) {
+        return 0;
+    }
+    decisions = malloc(sizeof(uint64_t) * steps);
+    if (!decisions) {
+        return -1;
+    }
+    
+    // Encoder starts in state 0; bias every other state
+    for (int i = 0; i < CONV_STATES; i++) {
+        metrics[0][i] = (i == 0) ? 0 : 8192;
+    }
+    
+    for (int t = 0; t < steps; t++) {
+        viterbi_step(metrics[t & 1], metrics[(t + 1) & 1], &decisions[t],
+                     symbols[2 * t], symbols[2 * t + 1]);
+    }
+    
+    // Tail bits flush the encoder to state 0: trace back from there
+    memset(data, 0, data_bytes);
+    int state = 0;
+    for (int t = steps - 1; t >= 0; t--) {
+        int bit = state & 1;
+        if (t < data_bytes * 8 && bit) {
+            data[t >> 3] |= 0x80 >> (t & 7);
+        }
+        state = (state >> 1) | ((int)((decisions[t] >> state) & 1) << (CONV_K - 2));
+    }
+    
+    free(decisions);
+    return data_bytes;
+}
+
+/*
+ * Expand hard-decision coded bytes into soft symbols (0 or SOFT_MAX)
+ */
+void hard_to_soft(const uint8_t *coded, int nsymbols, uint8_t *symbols) {
+    for (int i = 0; i < nsymbols; i++) {
+        symbols[i] = ((coded[i >> 3] >> (7 - (i & 7))) & 1) ? SOFT_MAX : 0;
+    }
+}
+
+/*
+ * Inverse of the encoder's symbol interleaver
+ */
+void deinterleave_codewords(const uint8_t *frame, int depth, uint8_t codewords[][N]) {
+    for (int j = 0; j < N; j++) {
+        for (int d = 0; d < depth; d++) {
+            codewords[d][j] = frame[j * depth + d];
+        }
+    }
+}
+
+/*
+ * CCSDS pseudo-randomizer, h(x) = x^8 + x^7 + x^5 + x^3 + 1 from all ones
+ */
+void init_randomizer(void) {
+    uint8_t reg = 0xFF;
+    
+    for (int i = 0; i < MAX_CODEBLOCK; i++) {
+        uint8_t byte = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t feedback = (reg ^ (reg >> 3) ^ (reg >> 5) ^ (reg >> 7)) & 1;
+            byte = (uint8_t)((byte << 1) | (reg & 1));
+            reg = (uint8_t)((reg >> 1) | (feedback << 7));
+        }
+        randomizer_seq[i] = byte;
+    }
+}
+
+void randomize(uint8_t *data, int length) {
+    int i = 0;
+    
+#if defined(__AVX2__)
+    for (; i + 32 <= length; i += 32) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i r = _mm256_load_si256((const __m256i *)(randomizer_seq + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_xor_si256(d, r));
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i r = _mm_load_si128((const __m128i *)(randomizer_seq + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(d, r));
+    }
+#endif
+    for (; i < length; i++) {
+        data[i] ^= randomizer_seq[i];
+    }
+}
+
+/*
+ * Length of a full-depth or partial frame in input units: bytes for
+ * hard-decision input, symbols for soft input. In concatenated mode with
+ * sync the ASM is convolutionally encoded together with the codeblock.
+ */
+static long frame_units(int depth, int concatenated, int soft, int sync) {
+    if (!concatenated) {
+        return (long)depth * N;
+    }
+    long data_bytes = (sync ? ASM_SIZE : 0) + (long)depth * N;
+    // Soft input has one symbol per bit of the coded file, padding included
+    return CONV_CODED_BYTES(data_bytes) * (soft ? 8 : 1);
+}
+
+/*
+ * Number of RS codewords carried by a frame of the given length, or 0 if
+ * the length does not match any interleaving depth. With sync the length
+ * only has to be long enough, since slips can add a few stray units.
+ */
+static int frame_depth(long length, int concatenated, int soft, int sync) {
+    if (!concatenated) {
+        return length > 0 ? 1 : 0;
+    }
+    for (int depth = INTERLEAVE_DEPTH; depth >= 1; depth--) {
+        long expected = frame_units(depth, concatenated, soft, sync);
+        if (length == expected || (sync && length > expected)) {
+            return depth;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Buffered frame reader with codeblock synchronisation.
+ *
+ * Without sync it simply hands out consecutive fixed-size frames. With sync
+ * it looks for the marker (the ASM, or in concatenated mode the ASM as it
+ * appears after convolutional encoding) before every frame: first at the
+ * expected position, then at the nearest offsets within SLIP_WINDOW units,
+ * and finally by a sliding popcount search over the rest of the stream.
+ * The window catches inserted or dropped bytes, and the full search
+ * re-acquires after longer losses or on streams of unknown alignment. On
+ * re-acquisition the distance from the expected marker, rounded to whole
+ * frame strides (marker plus frame), gives the number of frames lost in
+ * between, so the caller can keep its output aligned.
+ */
+typedef struct {
+    FILE *fp;
+    sparse_input_t *sparse;     // Optional: read around holes in fp
+    uint8_t *buf;
+    long capacity, start, end;
+    int eof;
+    int sync;
+    int marker_in_frame;    // Concatenated mode: the coded marker starts the frame
+    int unit_bits;          // 8 for bytes, 1 for soft symbols
+    int marker_units;
+    int max_errors;
+    uint64_t marker;
+    uint64_t marker_mask;
+    long frame_size;        // Full-depth frame length in units
+    long min_frame;         // Shortest valid frame, for end-of-stream detection
+    long expected;          // Where the next marker should start
+    int locked;
+    int acquired;           // Set once the first marker has been found
+    long lost;              // Full-depth frames lost just before the one returned
+    long slips, resyncs, lost_frames;
+} frame_reader_t;
+
+static void reader_fill(frame_reader_t *r) {
+    if (r->start > 0) {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->expected -= r->start;
+        r->start = 0;
+    }
+    while (!r->eof && r->end < r->capacity) {
+        size_t got = r->sparse ? sparse_read(r->sparse, r->buf + r->end, r->capacity - r->end, r->fp)
+                               : fread(r->buf + r->end, 1, r->capacity - r->end, r->fp);
+        if (got == 0) {
+            r->eof = 1;
+        }
+        r->end += got;
+    }
+}
+
+static uint64_t marker_word(const frame_reader_t *r, uint64_t word, uint8_t unit) {
+    return (r->unit_bits == 8) ? (word << 8) | unit : (word << 1) | (unit >= 128);
+}
+
+static int marker_at(const frame_reader_t *r, long pos) {
+    uint64_t word = 0;
+    
+    if (pos < r->start || pos + r->marker_units > r->end) {
+        return 0;
+    }
+    for (int i = 0; i < r->marker_units; i++) {
+        word = marker_word(r, word, r->buf[pos + i]);
+    }
+    return __builtin_popcountll((word ^ r->marker) & r->marker_mask) <= r->max_errors;
+}
+
+// Sliding search: one shift and one popcount per unit
+static long find_marker(const frame_reader_t *r, long from) {
+    uint64_t word = 0;
+    
+    for (long i = from; i < r->end; i++) {
+        word = marker_word(r, word, r->buf[i]);
+        if (i - from + 1 >= r->marker_units &&
+            __builtin_popcountll((word ^ r->marker) & r->marker_mask) <= r->max_errors) {
+            return i - r->marker_units + 1;
+        }
+    }
+    return -1;
+}
+
+static int reader_init(frame_reader_t *r, FILE *fp, int concatenated, int soft, int sync) {
+    memset(r, 0, sizeof(*r));
+    r->fp = fp;
+    r->sync = sync;
+    r->marker_in_frame = concatenated;
+    r->unit_bits = soft ? 1 : 8;
+    r->frame_size = frame_units(concatenated ? INTERLEAVE_DEPTH : 1, concatenated, soft, sync);
+    r->min_frame = frame_units(1, concatenated, soft, sync);
+    
+    if (concatenated) {
+        // The coded ASM is fixed: frames start with the encoder in state 0
+        uint8_t sr = 0;
+        for (int i = 0; i < ASM_SIZE * 8; i++) {
+            sr = (uint8_t)(((sr << 1) | ((ASM[i >> 3] >> (7 - (i & 7))) & 1)) & 0x7F);
+            r->marker = (r->marker << 1) | parity8(sr & CONV_POLY1);
+            r->marker = (r->marker << 1) | !parity8(sr & CONV_POLY2);
+        }
+        r->marker_mask = ~0ULL;
+        // Inner-code symbols arrive before any error correction, so allow
+        // a raw channel error rate of several percent on the coded marker
+        r->max_errors = 4 * SYNC_MAX_ERRORS;
+    } else {
+        for (int i = 0; i < ASM_SIZE; i++) {
+            r->marker = (r->marker << 8) | ASM[i];
+        }
+        r->marker_mask = 0xFFFFFFFFULL;
+        r->max_errors = SYNC_MAX_ERRORS;
+    }
+    r->marker_units = (int)(64 - __builtin_clzll(r->marker_mask)) / r->unit_bits;
+    
+    r->capacity = 2 * (r->frame_size + (sync ? r->marker_units + 2 * SLIP_WINDOW : 0));
+    r->buf = malloc(r->capacity);
+    return r->buf ? 0 : -1;
+}
+
+/*
+ * Return the next frame (and whether no further complete frame follows
+ * it), or 0 at end of input. The frame stays valid until the next call.
+ */
+static long read_frame(frame_reader_t *r, const uint8_t **frame, int *is_last) {
+    if (!r->sync) {
+        // The buffer holds two frames, so the one after this is already in
+        // (or known to be missing) when this one is handed out
+        reader_fill(r);
+        long length = r->end - r->start;
+        if (length > r->frame_size) {
+            length = r->frame_size;
+        }
+        *frame = r->buf + r->start;
+        r->start += length;
+        long remaining = r->end - r->start;
+        *is_last = r->eof && (remaining < r->min_frame ||
+                              frame_depth(remaining, r->marker_in_frame, r->unit_bits == 1, 0) == 0);
+        return length;
+    }
+    
+    r->lost = 0;
+    for (;;) {
+        reader_fill(r);
+        
+        long pos = -1;
+        if (r->locked) {
+            for (int d = 0; d <= SLIP_WINDOW && pos < 0; d++) {
+                if (marker_at(r, r->expected - d)) {
+                    pos = r->expected - d;
+                } else if (d > 0 && marker_at(r, r->expected + d)) {
+                    pos = r->expected + d;
+                }
+            }
+            if (pos >= 0 && pos != r->expected) {
+                r->slips++;
+            }
+        }
+        if (pos < 0) {
+            pos = find_marker(r, r->start);
+            if (pos >= 0 && r->acquired) {
+                r->resyncs++;
+                // The expected position is still relative to the buffer
+                long stride = r->frame_size + (r->marker_in_frame ? 0 : r->marker_units);
+                long distance = pos - r->expected;
+                if (distance > stride / 2) {
+                    r->lost += (distance + stride / 2) / stride;
+                    r->lost_frames += (distance + stride / 2) / stride;
+                }
+            }
+        }
+        if (pos < 0) {
+            r->locked = 0;
+            if (r->eof) {
+                return 0;
+            }
+            // Keep a partial marker that may straddle the refill
+            r->start = r->end - r->marker_units + 1;
+            continue;
+        }
+        
+        long body = r->marker_in_frame ? pos : pos + r->marker_units;
+        if (body + r->frame_size > r->end && !r->eof && pos > r->start) {
+            // Marker found late in the buffer: slide it to the front and refill
+            r->start = pos;
+            r->expected = pos;
+            r->locked = 1;
+            continue;
+        }
+        long length = r->end - body;
+        if (length > r->frame_size) {
+            length = r->frame_size;
+        }
+        if (length <= 0) {
+            return 0;
+        }
+        
+        *frame = r->buf + body;
+        r->expected = body + length;
+        r->start = r->expected - SLIP_WINDOW > pos + 1 ? r->expected - SLIP_WINDOW : pos + 1;
+        r->locked = 1;
+        r->acquired = 1;
+        *is_last = r->eof && r->end - r->expected < r->min_frame;
+        return length;
+    }
+}
+
+/*
+ * Input and output may be "-" for stdin and stdout, so a stream can be
+ * decoded while it is still arriving: the reader looks one frame ahead to
+ * find the last block instead of measuring the file. Progress messages move
+ * to stderr when the decoded data goes to stdout.
+ */
+#define STREAM_BUFFER (1 << 20)
+
+static int data_stdout = -1;
+
+// Keep the real stdout for decoded data and send messages to stderr
+static void reserve_stdout(void) {
+    if (data_stdout < 0) {
+        fflush(stdout);
+        data_stdout = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+}
+
+static FILE *open_output(const char *output_file) {
+    if (strcmp(output_file, "-") != 0) {
+        return fopen(output_file, "wb");
+    }
+    reserve_stdout();
+    return data_stdout >= 0 ? fdopen(data_stdout, "wb") : NULL;
+}
+
+/*
+ * With checkpoint set, progress is recorded after whole frames (see
+ * rs_checkpoint.c). The sync reader's lock is saved with it, so a resumed
+ * run searches for the next marker exactly where the interrupted one would.
+ * Zero codewords skip the decoder, holes in the input are not read and zero
+ * runs in the output are left as holes (see rs_sparse.c).
+ */
+int decode_file(const char *input_file, const char *output_file, int concatenated, int soft, int sync,
+                int checkpoint) {
+    checkpointer_t cp = { 0 };
+    sparse_input_t sparse_in;
+    sparse_output_t sparse_out;
+    FILE *input_fp = strcmp(input_file, "-") == 0 ? stdin : fopen(input_file, "rb");
     if (!input_fp) {
         printf("Error: Cannot open input file\n");
         return -1;
     }
+    sparse_input_init(&sparse_in, input_fp);
     
-    FILE *output_fp = fopen(output_file, "wb");
+    if (checkpoint) {
+        checkpoint_init(&cp, input_file, output_file, 2 | concatenated << 2 | sync << 3 | soft << 4);
+    }
+    FILE *output_fp = cp.enabled ? checkpoint_open_output(&cp, output_file) : open_output(output_file);
     if (!output_fp) {
         printf("Error: Cannot create output file\n");
         fclose(input_fp);
         return -1;
     }
+    setvbuf(input_fp, NULL, _IOFBF, STREAM_BUFFER);
+    setvbuf(output_fp, NULL, _IOFBF, STREAM_BUFFER);
+    sparse_output_init(&sparse_out, output_fp);
     
-    // Get file size for proper handling
-    fseek(input_fp, 0, SEEK_END);
-    long file_size = ftell(input_fp);
-    fseek(input_fp, 0, SEEK_SET);
-    long total_blocks = file_size / N;
+    frame_reader_t reader;
+    uint8_t *symbols = malloc(soft ? 1 : (size_t)frame_units(INTERLEAVE_DEPTH, 1, 0, sync) * 8);
+    uint8_t codewords[INTERLEAVE_DEPTH][N];
+    uint8_t decoded[ASM_SIZE + MAX_CODEBLOCK];
+    uint8_t corrected_block[N];
+    const uint8_t *input_frame;
+    long bytes_read;
+    int is_last = 0;
+    int block_count = 0, corrected_blocks = 0, failed_blocks = 0, zero_blocks = 0;
+    int stopped = 0;        // Ended on an error: keep the checkpoint
+    double viterbi_seconds = 0;
+    long viterbi_bits = 0;
     
-    uint8_t received_block[N], corrected_block[N];
-    size_t bytes_read;
-    int block_count = 0, corrected_blocks = 0, failed_blocks = 0;
+    if (reader_init(&reader, input_fp, concatenated, soft, sync) < 0 || !symbols) {
+        printf("Error: Out of memory\n");
+        free(reader.buf);
+        free(symbols);
+        sparse_input_free(&sparse_in);
+        fclose(input_fp);
+        fclose(output_fp);
+        return -1;
+    }
+    reader.sparse = &sparse_in;
+    if (cp.resumed) {
+        if (checkpoint_seek_input(&cp, input_fp) < 0) {
+            printf("Error: Cannot seek input file to the checkpoint\n");
+            free(reader.buf);
+            free(symbols);
+            sparse_input_free(&sparse_in);
+            fclose(input_fp);
+            fclose(output_fp);
+            return -1;
+        }
+        sparse_input_at(&sparse_in, cp.state.input_offset);
+        block_count = cp.state.counters[0];
+        corrected_blocks = cp.state.counters[1];
+        failed_blocks = cp.state.counters[2];
+        reader.slips = cp.state.counters[3];
+        reader.resyncs = cp.state.counters[4];
+        reader.lost_frames = cp.state.counters[6];
+        if (cp.state.counters[5] >= 0) {
+            reader.expected = cp.state.counters[5];
+            reader.locked = reader.acquired = 1;
+        }
+    }
     
-    printf("Processing %ld blocks...\n", total_blocks);
+    if (sync) {
+        printf("Processing blocks with codeblock synchronisation...\n");
+    } else {
+        printf("Processing blocks...\n");
+    }
     
-    while ((bytes_read = fread(received_block, 1, N, input_fp)) > 0) {
-        // Pad incomplete block with zeros
-        if (bytes_read < N) {
-            memset(received_block + bytes_read, 0, N - bytes_read);
+    while ((bytes_read = read_frame(&reader, &input_frame, &is_last)) > 0) {
+        int depth = frame_depth(bytes_read, concatenated, soft, sync);
+        int offset = (concatenated && sync) ? ASM_SIZE : 0;
+        
+        // A zero block stands in for every codeword of a lost frame, so the
+        // blocks after it keep their offsets; they count as failed
+        static const uint8_t placeholder[K];
+        for (long b = 0; b < reader.lost * (concatenated ? INTERLEAVE_DEPTH : 1); b++) {
+            ++block_count;
+            failed_blocks++;
+            if (sparse_write(&sparse_out, placeholder, K) < 0) {
+                printf("Error: Write failed at block %d\n", block_count);
+                stopped = 1;
+                break;
+            }
+        }
+        if (stopped) {
+            break;
         }
         
-        int result = rs_decode_block(received_block, corrected_block);
+        if (depth == 0) {
+            printf("Warning: Ignoring %ld trailing bytes (not a complete frame)\n", bytes_read);
+            break;
+        }
         
-        if (result == -1) {
-            failed_blocks++;
-            // Use original data when correction fails
-            memcpy(corrected_block, received_block, N);
-        } else if (result > 0) {
-            corrected_blocks++;
+        if (concatenated) {
+            clock_t start = clock();
+            const uint8_t *soft_symbols = input_frame;
+            int data_bytes = offset + depth * N;
+            if (!soft) {
+                hard_to_soft(input_frame, (data_bytes * 8 + CONV_K - 1) * 2, symbols);
+                soft_symbols = symbols;
+            }
+            if (viterbi_decode(soft_symbols, data_bytes, decoded) < 0) {
+                printf("Error: Out of memory in Viterbi decoder\n");
+                stopped = 1;
+                break;
+            }
+            viterbi_seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+            viterbi_bits += (long)data_bytes * 8;
+        } else {
+            // Pad incomplete block with zeros
+            memcpy(decoded, input_frame, bytes_read < N ? bytes_read : N);
+            if (bytes_read < N) {
+                memset(decoded + bytes_read, 0, N - bytes_read);
+            }
         }
         
-        // Determine output size
-        size_t write_size = K;
+        if (sync) {
+            randomize(decoded + offset, depth * N);
+        }
+        if (concatenated) {
+            deinterleave_codewords(decoded + offset, depth, codewords);
+        } else {
+            memcpy(codewords[0], decoded, N);
+        }
         
-        // Handle last block padding removal
-        if (++block_count == total_blocks) {
-            while (write_size > 0 && corrected_block[write_size - 1] == 0) {
-                write_size--;
+        for (int d = 0; d < depth; d++) {
+            uint8_t *received_block = codewords[d];
+            int result = 0;
+            
+            // A zero codeword has zero syndromes: nothing to correct
+            if (block_is_zero(received_block, N)) {
+                memset(corrected_block, 0, N);
+                zero_blocks++;
+            } else {
+                result = rs_decode_block(received_block, corrected_block);
+            }
+            
+            if (result == -1) {
+                failed_blocks++;
+                // Use original data when correction fails
+                memcpy(corrected_block, received_block, N);
+            } else if (result > 0) {
+                corrected_blocks++;
+            }
+            
+            // Determine output size
+            size_t write_size = K;
+            
+            // Handle last block padding removal; a trailing partial block
+            // in plain mode is not the padded one
+            ++block_count;
+            int complete = sync || concatenated || bytes_read == N;
+            if (complete && is_last && d == depth - 1) {
+                while (write_size > 0 && corrected_block[write_size - 1] == 0) {
+                    write_size--;
+                }
+            }
+            
+            if (sparse_write(&sparse_out, corrected_block, write_size) < 0) {
+                printf("Error: Write failed at block %d\n", block_count);
+                stopped = 1;
+                break;
             }
         }
         
-        if (fwrite(corrected_block, 1, write_size, output_fp) != write_size) {
-            printf("Error: Write failed at block %d\n", block_count);
+        if (stopped) {
             break;
         }
+        
+        // Outside sync mode a trailing fragment still follows the last block
+        if (sync && is_last) {
+            break;
+        }
+        
+        if (checkpoint_due(&cp, depth)) {
+            // Resume at the first byte the reader may still look at
+            int64_t counters[CHECKPOINT_COUNTERS] = {
+                block_count, corrected_blocks, failed_blocks, reader.slips, reader.resyncs,
+                reader.locked ? reader.expected - reader.start : -1, reader.lost_frames
+            };
+            if (sparse_output_flush(&sparse_out) < 0 ||
+                checkpoint_save(&cp, output_fp, sparse_in.pos - (reader.end - reader.start), counters) < 0) {
+                stopped = 1;
+                break;
+            }
+        }
     }
     
+    free(reader.buf);
+    free(symbols);
+    sparse_input_free(&sparse_in);
     fclose(input_fp);
-    fclose(output_fp);
+    if (sparse_output_finish(&sparse_out) < 0) {
+        printf("Error: Failed to write output file\n");
+        stopped = 1;
+    }
+    if (fclose(output_fp) == 0 && !stopped) {
+        checkpoint_done(&cp);
+    }
     
     printf("Decoding complete: %d blocks processed, %d corrected, %d failed\n", 
            block_count, corrected_blocks, failed_blocks);
+    if (zero_blocks > 0) {
+        printf("Zero blocks: %d skipped, %llu input hole bytes not read, %llu output bytes left as holes\n",
+               zero_blocks, (unsigned long long)sparse_in.hole_bytes, (unsigned long long)sparse_out.hole_bytes);
+    }
+    if (sync) {
+        printf("Synchronisation: %ld slips recovered, %ld re-acquisitions, %ld frames lost\n",
+               reader.slips, reader.resyncs, reader.lost_frames);
+    }
+    if (concatenated && viterbi_seconds > 0) {
+        printf("Viterbi throughput: %.1f Mbit/s\n", viterbi_bits / viterbi_seconds / 1e6);
+    }
     
-    return 0;
+    return failed_blocks > 0 ? 1 : 0;
+}
+
+typedef struct {
+    long total_blocks;
+    int corrected_blocks;
+    int failed_blocks;
+} decode_chunk_ctx_t;
+
+static long decode_chunk(const uint8_t *in, long in_len, uint8_t *out, long first_block, void *ctx) {
+    decode_chunk_ctx_t *dc = ctx;
+    long blocks = (in_len + N - 1) / N;
+    long produced = 0;
+    uint8_t received_block[N];
+
+    for (long b = 0; b < blocks; b++) {
+        long len = (in_len - b * N < N) ? in_len - b * N : N;
+        uint8_t *corrected_block = out + produced;
+        uint8_t full[N];
+
+        // Pad incomplete block with zeros
+        memcpy(received_block, in + b * N, len);
+        if (len < N) {
+            memset(received_block + len, 0, N - len);
+        }
+
+        // rs_decode_block writes all N symbols, so decode into a scratch block
+        int result = rs_decode_block(received_block, full);
+        if (result == -1) {
+            dc->failed_blocks++;
+            memcpy(full, received_block, N);
+        } else if (result > 0) {
+            dc->corrected_blocks++;
+        }
+
+        // Same padding removal as decode_file
+        long write_size = K;
+        if (first_block + b + 1 == dc->total_blocks) {
+            while (write_size > 0 && full[write_size - 1] == 0) {
+                write_size--;
+            }
+        }
+        memcpy(corrected_block, full, write_size);
+        produced += write_size;
+    }
+    return produced;
+}
+
+/**
+ * Plain-mode decode_file on the io_uring pipeline, with a read-only pass
+ * over the input timed first as the bandwidth reference.
+ */
+int decode_file_uring(const char *input_file, const char *output_file) {
+    decode_chunk_ctx_t ctx = { 0, 0, 0 };
+    uring_stats_t raw, stats;
+    struct stat st;
+
+    if (stat(input_file, &st) < 0) {
+        printf("Error: Cannot open input file\n");
+        return -1;
+    }
+    ctx.total_blocks = st.st_size / N;
+
+    printf("Processing %ld blocks with io_uring...\n", ctx.total_blocks);
+    if (uring_file_transform(input_file, NULL, N, K, NULL, NULL, &raw) < 0 ||
+        uring_file_transform(input_file, output_file, N, K, decode_chunk, &ctx, &stats) < 0) {
+        return -1;
+    }
+
+    printf("Decoding complete: %ld blocks processed, %d corrected, %d failed\n",
+           (stats.bytes_in + N - 1) / N, ctx.corrected_blocks, ctx.failed_blocks);
+    uring_report(&stats, &raw);
+    return ctx.failed_blocks > 0 ? 1 : 0;
+}
+
+/**
+ * Decode a --gf16 archive (see rs16.c); the code parameters and the data
+ * length come from its header. Codewords are checked RS16_LANES at a time.
+ * If the archive was cut short, the missing symbols of the last codeword
+ * are passed to the decoder as erasures.
+ */
+int decode_file_gf16(const char *input_file, const char *output_file) {
+    FILE *input_fp = strcmp(input_file, "-") == 0 ? stdin : fopen(input_file, "rb");
+    uint8_t header[RS16_HEADER_SIZE];
+    uint64_t length;
+    int n, k;
+    rs16_code_t rs;
+
+    if (!input_fp) {
+        printf("Error: Cannot open input file\n");
+        return -1;
+    }
+    if (fread(header, 1, RS16_HEADER_SIZE, input_fp) != RS16_HEADER_SIZE ||
+        rs16_get_header(header, &n, &k, &length) < 0) {
+        printf("Error: Not a GF(2^16) archive\n");
+        fclose(input_fp);
+        return -1;
+    }
+    if (rs16_init(&rs, n, k) < 0) {
+        fclose(input_fp);
+        return -1;
+    }
+    FILE *output_fp = open_output(output_file);
+    if (!output_fp) {
+        printf("Error: Cannot create output file\n");
+        fclose(input_fp);
+        rs16_free(&rs);
+        return -1;
+    }
+    setvbuf(input_fp, NULL, _IOFBF, STREAM_BUFFER);
+    setvbuf(output_fp, NULL, _IOFBF, STREAM_BUFFER);
+
+    int nroots = rs.nroots;
+    uint16_t *words = malloc((size_t)RS16_LANES * n * 2);
+    if (!words) {
+        printf("Error: Out of memory\n");
+        fclose(input_fp);
+        fclose(output_fp);
+        rs16_free(&rs);
+        return -1;
+    }
+
+    uint64_t data_symbols = (length + 1) / 2;
+
+    // A regular file must hold every codeword the header promises, less at
+    // most the parity a truncated last codeword can recover as erasures
+    struct stat st;
+    uint64_t codewords = (data_symbols + k - 1) / k;
+    uint64_t expected = RS16_HEADER_SIZE + 2 * (data_symbols + codewords * nroots);
+    if (fstat(fileno(input_fp), &st) == 0 && S_ISREG(st.st_mode) &&
+        (uint64_t)st.st_size + 2 * (uint64_t)nroots < expected) {
+        printf("Error: Header length %llu needs %llu bytes of input, the file has %llu\n",
+               (unsigned long long)length, (unsigned long long)expected, (unsigned long long)st.st_size);
+        free(words);
+        fclose(input_fp);
+        fclose(output_fp);
+        rs16_free(&rs);
+        return -1;
+    }
+
+    printf("Decoding RS(%d,%d) over GF(2^16), %llu bytes of data...\n",
+           n, k, (unsigned long long)length);
+
+    uint64_t done_symbols = 0, remaining = length;
+    int block_count = 0, corrected_blocks = 0, failed_blocks = 0;
+    int result = 0;
+
+    while (result == 0 && done_symbols < data_symbols) {
+        uint16_t *lane_words[RS16_LANES];
+        int len[RS16_LANES], present[RS16_LANES], status[RS16_LANES];
+        int count = 0;
+
+        while (count < RS16_LANES && done_symbols < data_symbols) {
+            int data_len = (data_symbols - done_symbols < (uint64_t)k) ? (int)(data_symbols - done_symbols) : k;
+            uint16_t *word = words + (long)count * n;
+
+            // Symbols missing from a truncated archive become erasures
+            len[count] = data_len + nroots;
+            present[count] = fread(word, 1, len[count] * 2, input_fp) / 2;
+            if (present[count] == 0) {
+                // Nothing left of it: the input ended early (or the header length is wrong)
+                printf("Error: Input ends after %d codewords, header promised %llu bytes\n",
+                       block_count + count, (unsigned long long)length);
+                result = -1;
+                break;
+            }
+            memset(word + present[count], 0, (len[count] - present[count]) * 2);
+
+            lane_words[count++] = word;
+            done_symbols += data_len;
+        }
+
+        if (count == 0) {
+            break;
+        }
+        rs16_decode_batch(&rs, lane_words, len, present, count, status);
+        for (int lane = 0; lane < count; lane++) {
+            block_count++;
+            if (status[lane] < 0) {
+                failed_blocks++;
+            } else if (status[lane] > 0) {
+                corrected_blocks++;
+            }
+
+            size_t write_size = 2 * (size_t)(len[lane] - nroots);
+            if (write_size > remaining) {
+                write_size = remaining;
+            }
+            if (fwrite(lane_words[lane], 1, write_size, output_fp) != write_size) {
+                printf("Error: Write failed at codeword %d\n", block_count);
+                result = -1;
+                break;
+            }
+            remaining -= write_size;
+        }
+    }
+
+    free(words);
+    fclose(input_fp);
+    fclose(output_fp);
+    rs16_free(&rs);
+
+    printf("Decoding complete: %d codewords processed, %d corrected, %d failed\n",
+           block_count, corrected_blocks, failed_blocks);
+    if (result < 0) {
+        return -1;
+    }
+    return failed_blocks > 0 ? 1 : 0;
 }
 
+// The codec daemon reuses this decoder with RS_DECODER_NO_MAIN defined
+#ifndef RS_DECODER_NO_MAIN
 int main(int argc, char *argv[]) {
+    int concatenated = 0, soft = 0, sync = 0, uring = 0, gf16 = 0, checkpoint = 0;
     
+    if (argc >= 3 && strcmp(argv[2], "-") == 0) {
+        reserve_stdout();
+    }
     printf("Reed-Solomon Decoder (N=%d, K=%d, T=%d)\n", N, K, T);
     
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--concat") == 0) {
+            concatenated = 1;
+        } else if (strcmp(argv[i], "--soft") == 0) {
+            soft = 1;
+        } else if (strcmp(argv[i], "--sync") == 0) {
+            sync = 1;
+        } else if (strcmp(argv[i], "--uring") == 0) {
+            uring = 1;
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            checkpoint = 1;
+        } else if (strcmp(argv[i], "--gf16") == 0) {
+            gf16 = 1;
+        } else {
+            printf("Error: Unknown option '%s'\n", argv[i]);
+            argc = 0;
+        }
+    }
+    if (argc >= 3 && (strncmp(argv[1], "--", 2) == 0 || strncmp(argv[2], "--", 2) == 0)) {
+        printf("Error: Input and output files come before the options\n");
+        argc = 0;
+    }
+    if (argc < 3) {
+        printf("Usage: %s <input_file> <output_file> [--concat [--soft]] [--sync] [--uring] [--checkpoint] [--gf16]\n", argv[0]);
+        printf("  either file may be - for stdin / stdout\n");
+        printf("  --concat  input carries the CCSDS rate 1/2 K=7 convolutional inner code\n");
+        printf("  --soft    input holds one soft symbol byte per coded bit (0..255)\n");
+        printf("  --sync    frames carry the CCSDS sync marker and are randomized\n");
+        printf("  --uring   overlap file I/O and decoding with io_uring (plain mode)\n");
+        printf("  --checkpoint  record progress in <output_file>.ckpt; a rerun resumes from it\n");
+        printf("  --gf16    input is a GF(2^16) archive written with --gf16 N K\n");
+        return -1;
+    }
+    if (uring && (concatenated || sync || checkpoint)) {
+        printf("Note: --uring supports plain mode without checkpoints only, using stdio\n");
+        uring = 0;
+    }
+    
     init_galois_field();
-    int result = decode_file(argv[1], argv[2]);
+    init_viterbi();
+    init_randomizer();
+    int result = gf16  ? decode_file_gf16(argv[1], argv[2])
+               : uring ? decode_file_uring(argv[1], argv[2])
+                       : decode_file(argv[1], argv[2], concatenated, soft, sync, checkpoint);
     
     if (result == 0) {
         printf("All blocks decoded successfully\n");
@@ -266,4 +1221,5 @@ int main(int argc, char *argv[]) {
     }
     
     return result;
-}
\ No newline at end of file
+}
+#endif
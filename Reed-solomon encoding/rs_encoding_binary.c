@@ -1,7 +1,17 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // O_DIRECT for the io_uring raw bandwidth pass
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "rs_uring.c"
+#include "rs16.c"
+#include "rs_checkpoint.c"
+#include "rs_sparse.c"
 
 // Reed-Solomon parameters according to CCSDS standard
 #define N 255           // Total codeword length
@@ -12,6 +22,20 @@
 #define PRIM_POLY 0x11D // Field generator polynomial: x^8 + x^7 + x^2 + x + 1
 #define ALPHA 0x02      // Primitive element (alpha = 2)
 
+// Inner convolutional code (CCSDS 131.0-B concatenated coding)
+#define CONV_K 7                // Constraint length
+#define CONV_POLY1 0x4F         // G1 = 171 (octal), newest bit in LSB
+#define CONV_POLY2 0x6D         // G2 = 133 (octal), output inverted per CCSDS
+#define INTERLEAVE_DEPTH 4      // RS codewords per interleaved frame
+#define CONV_CODED_BYTES(len) ((len) * 2 + 2) // Coded bytes for len data bytes incl. tail
+
+// Attached sync marker and pseudo-randomizer (CCSDS 131.0-B sections 9 and 10)
+#define ASM_SIZE 4
+#define MAX_CODEBLOCK (INTERLEAVE_DEPTH * N)
+
+static const uint8_t ASM[ASM_SIZE] = { 0x1A, 0xCF, 0xFC, 0x1D };
+uint8_t randomizer_seq[MAX_CODEBLOCK] __attribute__((aligned(32)));
+
 // Global tables for Galois field operations
 uint8_t gf_exp[512];    // Exponential table (extended for convenience)
 uint8_t gf_log[256];    // Logarithm table
@@ -24,7 +48,13 @@ uint8_t gf_div(uint8_t a, uint8_t b);
 uint8_t gf_pow(uint8_t base, int exp);
 void generate_polynomial(void);
 void rs_encode_block(uint8_t *data, uint8_t *codeword);
-int encode_file(const char *input_file, const char *output_file);
+void interleave_codewords(uint8_t codewords[][N], int depth, uint8_t *frame);
+int conv_encode(const uint8_t *data, int length, uint8_t *coded);
+void init_randomizer(void);
+void randomize(uint8_t *data, int length);
+int encode_file(const char *input_file, const char *output_file, int concatenated, int sync, int checkpoint);
+int encode_file_uring(const char *input_file, const char *output_file);
+int encode_file_gf16(const char *input_file, const char *output_file, int n, int k);
 void print_polynomial(uint8_t *poly, int length, const char *name);
 
 /**
@@ -167,20 +197,191 @@ void rs_encode_block(uint8_t *data, uint8_t *codeword) {
         remainder[0] = gf_mult(generator[0], feedback);
     }
     
-    // Copy parity symbols to codeword
-    memcpy(codeword + K, remainder, PARITY);
+    // Copy parity symbols to codeword, highest degree first so the
+    // codeword reads as one polynomial from codeword[0] (x^254) down to x^0
+    for (i = 0; i < PARITY; i++) {
+        codeword[K + i] = remainder[PARITY - 1 - i];
+    }
+}
+
+/**
+ * Symbol interleaver for concatenated coding
+ * Writes 'depth' codewords symbol by symbol so that a burst left behind by
+ * the Viterbi decoder is spread over several RS codewords:
+ * frame[j * depth + d] = codewords[d][j]
+ */
+void interleave_codewords(uint8_t codewords[][N], int depth, uint8_t *frame) {
+    int d, j;
+
+    for (j = 0; j < N; j++) {
+        for (d = 0; d < depth; d++) {
+            frame[j * depth + d] = codewords[d][j];
+        }
+    }
+}
+
+/**
+ * Parity of an 8-bit value (number of set bits mod 2)
+ */
+static int parity8(uint8_t x) {
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+/**
+ * Rate 1/2, K=7 convolutional encoder (CCSDS inner code)
+ * Input bytes are shifted in MSB first. Each input bit produces the G1
+ * symbol followed by the inverted G2 symbol. The encoder starts in state
+ * zero and is flushed with CONV_K - 1 zero bits so that every frame ends in
+ * state zero, which is what the Viterbi decoder traces back from.
+ * Returns the number of coded bytes written (the last byte is zero padded).
+ */
+int conv_encode(const uint8_t *data, int length, uint8_t *coded) {
+    int total_bits = length * 8 + (CONV_K - 1);
+    int out_bit = 0;
+    int i;
+    uint8_t sr = 0;
+
+    memset(coded, 0, (total_bits * 2 + 7) / 8);
+
+    for (i = 0; i < total_bits; i++) {
+        int bit = (i < length * 8) ? (data[i >> 3] >> (7 - (i & 7))) & 1 : 0;
+
+        sr = (uint8_t)(((sr << 1) | bit) & 0x7F);
+
+        if (parity8(sr & CONV_POLY1)) {
+            coded[out_bit >> 3] |= 0x80 >> (out_bit & 7);
+        }
+        out_bit++;
+        if (!parity8(sr & CONV_POLY2)) {
+            coded[out_bit >> 3] |= 0x80 >> (out_bit & 7);
+        }
+        out_bit++;
+    }
+
+    return (out_bit + 7) / 8;
+}
+
+/**
+ * Precompute the CCSDS pseudo-randomizer sequence
+ * h(x) = x^8 + x^7 + x^5 + x^3 + 1, all ones at the start of every
+ * codeblock, period 255 bits. The sequence begins FF 48 0E C0 9A ...
+ */
+void init_randomizer(void) {
+    uint8_t reg = 0xFF;
+    int i, bit;
+
+    for (i = 0; i < MAX_CODEBLOCK; i++) {
+        uint8_t byte = 0;
+        for (bit = 0; bit < 8; bit++) {
+            uint8_t feedback = (reg ^ (reg >> 3) ^ (reg >> 5) ^ (reg >> 7)) & 1;
+            byte = (uint8_t)((byte << 1) | (reg & 1));
+            reg = (uint8_t)((reg >> 1) | (feedback << 7));
+        }
+        randomizer_seq[i] = byte;
+    }
+}
+
+/**
+ * XOR a codeblock with the precomputed randomizer sequence
+ * (the operation is its own inverse)
+ */
+void randomize(uint8_t *data, int length) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 32 <= length; i += 32) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i r = _mm256_load_si256((const __m256i *)(randomizer_seq + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_xor_si256(d, r));
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i r = _mm_load_si128((const __m128i *)(randomizer_seq + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(d, r));
+    }
+#endif
+    for (; i < length; i++) {
+        data[i] ^= randomizer_seq[i];
+    }
+}
+
+/**
+ * Write one codeword, optionally as a CADU: ASM followed by the randomized
+ * codeword. Returns the number of bytes written or -1 on error.
+ */
+static int write_codeblock(FILE *output_fp, const uint8_t *codeword, int sync) {
+    uint8_t cadu[ASM_SIZE + N];
+    int length = 0;
+
+    if (sync) {
+        memcpy(cadu, ASM, ASM_SIZE);
+        length = ASM_SIZE;
+    }
+    memcpy(cadu + length, codeword, N);
+    if (sync) {
+        randomize(cadu + length, N);
+    }
+    length += N;
+
+    if (fwrite(cadu, 1, length, output_fp) != (size_t)length) {
+        return -1;
+    }
+    return length;
+}
+
+/**
+ * Interleave and convolutionally encode a group of RS codewords, then write
+ * the coded frame. With sync enabled the ASM and randomized codeblock are
+ * encoded together, as in the CCSDS CADU. A short final group simply uses a
+ * smaller depth; the decoder recovers the depth from the frame length.
+ */
+static int write_concatenated_frame(FILE *output_fp, uint8_t codewords[][N], int depth, int sync) {
+    uint8_t frame[ASM_SIZE + MAX_CODEBLOCK];
+    uint8_t coded[CONV_CODED_BYTES(ASM_SIZE + MAX_CODEBLOCK)];
+    int offset = sync ? ASM_SIZE : 0;
+    int coded_len;
+
+    memcpy(frame, ASM, ASM_SIZE);
+    interleave_codewords(codewords, depth, frame + offset);
+    if (sync) {
+        randomize(frame + offset, depth * N);
+    }
+    coded_len = conv_encode(frame, offset + depth * N, coded);
+
+    if (fwrite(coded, 1, coded_len, output_fp) != (size_t)coded_len) {
+        return -1;
+    }
+    return coded_len;
 }
 
 /**
  * Encode entire file using Reed-Solomon coding
- * Reads input file, processes it in K-byte blocks, and writes encoded data
+ * Reads input file, processes it in K-byte blocks, and writes encoded data.
+ * In concatenated mode the codewords are interleaved INTERLEAVE_DEPTH deep
+ * and passed through the inner convolutional code before being written.
+ * With sync enabled every codeblock is randomized and preceded by the ASM.
+ * With checkpoint set, progress is recorded at interleaver frame boundaries
+ * (see rs_checkpoint.c) and an interrupted run resumes from there.
+ * Zero blocks skip the encoder, holes in the input are not read and in
+ * plain mode zero runs stay holes in the output (see rs_sparse.c).
  */
-int encode_file(const char *input_file, const char *output_file) {
+int encode_file(const char *input_file, const char *output_file, int concatenated, int sync, int checkpoint) {
     FILE *input_fp, *output_fp;
     uint8_t data_block[K];
     uint8_t codeword[N];
+    uint8_t group[INTERLEAVE_DEPTH][N];
+    int group_count = 0;
+    long output_size = 0;
     size_t bytes_read;
-    int block_count = 0;
+    size_t last_read = K;
+    int block_count = 0, zero_blocks = 0;
+    checkpointer_t cp = { 0 };
+    sparse_input_t sparse_in;
+    sparse_output_t sparse_out;
     
     // Open input file
     input_fp = fopen(input_file, "rb");
@@ -188,34 +389,88 @@ int encode_file(const char *input_file, const char *output_file) {
         printf("Error: Cannot open input file '%s'\n", input_file);
         return -1;
     }
+    sparse_input_init(&sparse_in, input_fp);
     
     // Open output file
-    output_fp = fopen(output_file, "wb");
+    if (checkpoint) {
+        checkpoint_init(&cp, input_file, output_file, 1 | concatenated << 1 | sync << 2);
+    }
+    output_fp = cp.enabled ? checkpoint_open_output(&cp, output_file) : fopen(output_file, "wb");
     if (!output_fp) {
         printf("Error: Cannot create output file '%s'\n", output_file);
+        sparse_input_free(&sparse_in);
         fclose(input_fp);
         return -1;
     }
+    sparse_output_init(&sparse_out, output_fp);
+    if (cp.resumed) {
+        block_count = cp.state.counters[0];
+        output_size = cp.state.counters[1];
+        if (checkpoint_seek_input(&cp, input_fp) < 0) {
+            printf("Error: Cannot seek input file to the checkpoint\n");
+            sparse_input_free(&sparse_in);
+            fclose(input_fp);
+            fclose(output_fp);
+            return -1;
+        }
+        sparse_input_at(&sparse_in, cp.state.input_offset);
+    }
     
     printf("Encoding file '%s' to '%s'...\n", input_file, output_file);
     
     // Process file in K-byte blocks
-    while ((bytes_read = fread(data_block, 1, K, input_fp)) > 0) {
+    while ((bytes_read = sparse_read(&sparse_in, data_block, K, input_fp)) > 0) {
         // Pad block with zeros if necessary
         if (bytes_read < K) {
             memset(data_block + bytes_read, 0, K - bytes_read);
             printf("Block %d: Padded %zu bytes with zeros\n", block_count + 1, K - bytes_read);
         }
         
-        // Encode the block
-        rs_encode_block(data_block, codeword);
+        last_read = bytes_read;
         
-        // Write encoded block to output file
-        if (fwrite(codeword, 1, N, output_fp) != N) {
-            printf("Error: Failed to write encoded block %d\n", block_count + 1);
-            fclose(input_fp);
-            fclose(output_fp);
-            return -1;
+        // A zero block encodes to the zero codeword
+        int zero = block_is_zero(data_block, K);
+        zero_blocks += zero;
+        
+        if (concatenated) {
+            // Collect codewords until the interleaver frame is full
+            if (zero) {
+                memset(group[group_count++], 0, N);
+            } else {
+                rs_encode_block(data_block, group[group_count++]);
+            }
+            
+            if (group_count == INTERLEAVE_DEPTH) {
+                int coded_len = write_concatenated_frame(output_fp, group, group_count, sync);
+                if (coded_len < 0) {
+                    printf("Error: Failed to write coded frame at block %d\n", block_count + 1);
+                    sparse_input_free(&sparse_in);
+                    fclose(input_fp);
+                    fclose(output_fp);
+                    return -1;
+                }
+                output_size += coded_len;
+                group_count = 0;
+            }
+        } else {
+            // Encode the block
+            if (zero) {
+                memset(codeword, 0, N);
+            } else {
+                rs_encode_block(data_block, codeword);
+            }
+            
+            // Write encoded block to output file
+            int written = sync ? write_codeblock(output_fp, codeword, sync)
+                               : (sparse_write(&sparse_out, codeword, N) < 0 ? -1 : N);
+            if (written < 0) {
+                printf("Error: Failed to write encoded block %d\n", block_count + 1);
+                sparse_input_free(&sparse_in);
+                fclose(input_fp);
+                fclose(output_fp);
+                return -1;
+            }
+            output_size += written;
         }
         
         block_count++;
@@ -224,37 +479,255 @@ int encode_file(const char *input_file, const char *output_file) {
         if (block_count % 100 == 0) {
             printf("Processed %d blocks...\n", block_count);
         }
+        
+        // Checkpoint only between interleaver frames
+        if (checkpoint_due(&cp, 1) && group_count == 0) {
+            int64_t counters[CHECKPOINT_COUNTERS] = { block_count, output_size };
+            if (sparse_output_flush(&sparse_out) < 0 ||
+                checkpoint_save(&cp, output_fp, sparse_in.pos, counters) < 0) {
+                sparse_input_free(&sparse_in);
+                fclose(input_fp);
+                fclose(output_fp);
+                return -1;
+            }
+        }
     }
     
+    // Flush a partially filled interleaver frame
+    if (concatenated && group_count > 0) {
+        int coded_len = write_concatenated_frame(output_fp, group, group_count, sync);
+        if (coded_len < 0) {
+            printf("Error: Failed to write final coded frame\n");
+            sparse_input_free(&sparse_in);
+            fclose(input_fp);
+            fclose(output_fp);
+            return -1;
+        }
+        output_size += coded_len;
+    }
+    
+    sparse_input_free(&sparse_in);
     fclose(input_fp);
-    fclose(output_fp);
+    int write_error = sparse_output_finish(&sparse_out) < 0;
+    if (fclose(output_fp) != 0 || write_error) {
+        printf("Error: Failed to write output file\n");
+        return -1;
+    }
+    checkpoint_done(&cp);
     
     printf("Encoding completed successfully!\n");
     printf("Total blocks processed: %d\n", block_count);
-    printf("Input file size: %d bytes\n", block_count * K - (K - (int)bytes_read));
-    printf("Output file size: %d bytes\n", block_count * N);
-    printf("Coding rate: %.3f\n", (float)K / N);
+    if (zero_blocks > 0) {
+        printf("Zero blocks: %d skipped, %llu input hole bytes not read, %llu output bytes left as holes\n",
+               zero_blocks, (unsigned long long)sparse_in.hole_bytes, (unsigned long long)sparse_out.hole_bytes);
+    }
+    printf("Input file size: %d bytes\n", block_count * K - (K - (int)last_read));
+    printf("Output file size: %ld bytes\n", output_size);
+    if (concatenated) {
+        printf("Coding rate: %.3f (RS %d/%d + convolutional 1/2, interleave depth %d)\n",
+               (float)K / N / 2, K, N, INTERLEAVE_DEPTH);
+    } else {
+        printf("Coding rate: %.3f\n", (float)K / N);
+    }
     printf("Redundancy: %d parity symbols per %d data symbols\n", PARITY, K);
     
     return 0;
 }
 
+static long encode_chunk(const uint8_t *in, long in_len, uint8_t *out, long first_block, void *ctx) {
+    long blocks = (in_len + K - 1) / K;
+    uint8_t data_block[K];
+    (void)ctx;
+
+    for (long b = 0; b < blocks; b++) {
+        long len = (in_len - b * K < K) ? in_len - b * K : K;
+        memcpy(data_block, in + b * K, len);
+        if (len < K) {
+            memset(data_block + len, 0, K - len);
+            printf("Block %ld: Padded %ld bytes with zeros\n", first_block + b + 1, K - len);
+        }
+        rs_encode_block(data_block, out + b * N);
+    }
+    return blocks * N;
+}
+
+/**
+ * Plain-mode encode_file on the io_uring pipeline: reads, RS encoding and
+ * writes of consecutive chunks overlap. A read-only pass over the input is
+ * timed first as the bandwidth reference.
+ */
+int encode_file_uring(const char *input_file, const char *output_file) {
+    uring_stats_t raw, stats;
+
+    printf("Encoding file '%s' to '%s' with io_uring...\n", input_file, output_file);
+    if (uring_file_transform(input_file, NULL, K, N, NULL, NULL, &raw) < 0 ||
+        uring_file_transform(input_file, output_file, K, N, encode_chunk, NULL, &stats) < 0) {
+        return -1;
+    }
+
+    printf("Encoding completed successfully!\n");
+    printf("Total blocks processed: %ld\n", (stats.bytes_in + K - 1) / K);
+    printf("Input file size: %ld bytes\n", stats.bytes_in);
+    printf("Output file size: %ld bytes\n", stats.bytes_out);
+    uring_report(&stats, &raw);
+    return 0;
+}
+
+/**
+ * Archive mode: RS(n, k) over GF(2^16) (see rs16.c). After the header, each
+ * codeword is k data symbols (pairs of input bytes) and n - k parity
+ * symbols; the last codeword is shortened to the data left. Codewords are
+ * encoded RS16_LANES at a time, one per SIMD lane.
+ */
+int encode_file_gf16(const char *input_file, const char *output_file, int n, int k) {
+    rs16_code_t rs;
+    uint8_t header[RS16_HEADER_SIZE];
+    long output_size = RS16_HEADER_SIZE;
+    int block_count = 0;
+
+    if (rs16_init(&rs, n, k) < 0) {
+        return -1;
+    }
+
+    FILE *input_fp = fopen(input_file, "rb");
+    if (!input_fp) {
+        printf("Error: Cannot open input file '%s'\n", input_file);
+        rs16_free(&rs);
+        return -1;
+    }
+    FILE *output_fp = fopen(output_file, "wb");
+    if (!output_fp) {
+        printf("Error: Cannot create output file '%s'\n", output_file);
+        fclose(input_fp);
+        rs16_free(&rs);
+        return -1;
+    }
+
+    fseek(input_fp, 0, SEEK_END);
+    long file_size = ftell(input_fp);
+    fseek(input_fp, 0, SEEK_SET);
+
+    size_t batch_bytes = (size_t)RS16_LANES * k * 2;
+    uint16_t *data = malloc(batch_bytes);
+    uint16_t *parity = malloc((size_t)RS16_LANES * rs.nroots * 2);
+    if (!data || !parity) {
+        printf("Error: Out of memory\n");
+        free(data);
+        free(parity);
+        fclose(input_fp);
+        fclose(output_fp);
+        rs16_free(&rs);
+        return -1;
+    }
+
+    printf("Encoding file '%s' to '%s' with RS(%d,%d) over GF(2^16)...\n",
+           input_file, output_file, n, k);
+    rs16_put_header(header, n, k, file_size);
+    int result = fwrite(header, 1, RS16_HEADER_SIZE, output_fp) == RS16_HEADER_SIZE ? 0 : -1;
+
+    size_t bytes_read;
+    while (result == 0 && (bytes_read = fread(data, 1, batch_bytes, input_fp)) > 0) {
+        const uint16_t *lane_data[RS16_LANES];
+        uint16_t *lane_parity[RS16_LANES];
+        int len[RS16_LANES];
+        long symbols = (bytes_read + 1) / 2;
+        int count = (symbols + k - 1) / k;
+
+        if (bytes_read & 1) {
+            ((uint8_t *)data)[bytes_read] = 0;
+        }
+        for (int lane = 0; lane < count; lane++) {
+            lane_data[lane] = data + (long)lane * k;
+            lane_parity[lane] = parity + (long)lane * rs.nroots;
+            len[lane] = (symbols - (long)lane * k < k) ? symbols - (long)lane * k : k;
+        }
+        rs16_encode_batch(&rs, lane_data, len, count, lane_parity);
+
+        for (int lane = 0; lane < count && result == 0; lane++) {
+            if (fwrite(lane_data[lane], 2, len[lane], output_fp) != (size_t)len[lane] ||
+                fwrite(lane_parity[lane], 2, rs.nroots, output_fp) != (size_t)rs.nroots) {
+                printf("Error: Failed to write codeword %d\n", block_count + 1);
+                result = -1;
+            }
+            output_size += 2L * (len[lane] + rs.nroots);
+            block_count++;
+        }
+    }
+
+    free(data);
+    free(parity);
+    fclose(input_fp);
+    if (fclose(output_fp) != 0) {
+        result = -1;
+    }
+    rs16_free(&rs);
+    if (result < 0) {
+        return -1;
+    }
+
+    printf("Encoding completed successfully!\n");
+    printf("Total codewords: %d\n", block_count);
+    printf("Input file size: %ld bytes\n", file_size);
+    printf("Output file size: %ld bytes\n", output_size);
+    printf("Coding rate: %.4f (up to %d symbol errors per codeword)\n", (float)k / n, (n - k) / 2);
+    return 0;
+}
+
 /**
  * Main function
  */
 int main(int argc, char *argv[]) {
+    int concatenated = 0, sync = 0, uring = 0, checkpoint = 0;
+    int gf16_n = 0, gf16_k = 0;
+    int i;
+    
     printf("Reed-Solomon Encoder (CCSDS 131.0-B-5 Standard)\n");
     printf("================================================\n");
     printf("Parameters: N=%d, K=%d, T=%d (can correct up to %d symbol errors)\n\n", 
            N, K, T, T);
     
     // Check command line arguments
-    if (argc != 3) {
-        printf("Usage: %s <input_file.txt> <output_file.txt>\n", argv[0]);
+    for (i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--concat") == 0) {
+            concatenated = 1;
+        } else if (strcmp(argv[i], "--sync") == 0) {
+            sync = 1;
+        } else if (strcmp(argv[i], "--uring") == 0) {
+            uring = 1;
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            checkpoint = 1;
+        } else if (strcmp(argv[i], "--gf16") == 0 && i + 2 < argc) {
+            gf16_n = atoi(argv[++i]);
+            gf16_k = atoi(argv[++i]);
+        } else {
+            printf("Error: Unknown or incomplete option '%s'\n", argv[i]);
+            argc = 0;
+        }
+    }
+    if (argc >= 3 && (strncmp(argv[1], "--", 2) == 0 || strncmp(argv[2], "--", 2) == 0)) {
+        printf("Error: Input and output files come before the options\n");
+        argc = 0;
+    }
+    if (argc < 3) {
+        printf("Usage: %s <input_file.txt> <output_file.txt> [--concat] [--sync] [--uring] [--checkpoint] [--gf16 N K]\n", argv[0]);
         printf("Example: %s data.txt encoded_data.txt\n", argv[0]);
+        printf("  --concat  add the CCSDS rate 1/2 K=7 convolutional inner code\n");
+        printf("  --sync    attach the CCSDS sync marker and randomize each codeblock\n");
+        printf("  --uring   overlap file I/O and encoding with io_uring (plain mode)\n");
+        printf("  --checkpoint  record progress in <output_file>.ckpt; a rerun resumes from it\n");
+        printf("  --gf16 N K  RS(N,K) over GF(2^16), codewords up to 65535 16-bit symbols\n");
         return 1;
     }
     
+    if (gf16_n) {
+        if (encode_file_gf16(argv[1], argv[2], gf16_n, gf16_k) != 0) {
+            printf("Encoding failed!\n");
+            return 1;
+        }
+        printf("\nEncoded file saved as: %s\n", argv[2]);
+        return 0;
+    }
+    
     // Initialize Galois Field
     printf("Initializing Galois Field GF(2^8)...\n");
     init_galois_field();
@@ -262,10 +735,16 @@ int main(int argc, char *argv[]) {
     // Generate Reed-Solomon generator polynomial
     printf("Generating Reed-Solomon generator polynomial...\n");
     generate_polynomial();
+    init_randomizer();
     
     // Encode the file
     printf("\nStarting file encoding...\n");
-    if (encode_file(argv[1], argv[2]) != 0) {
+    if (uring && (concatenated || sync || checkpoint)) {
+        printf("Note: --uring supports plain mode without checkpoints only, using stdio\n");
+        uring = 0;
+    }
+    if ((uring ? encode_file_uring(argv[1], argv[2])
+               : encode_file(argv[1], argv[2], concatenated, sync, checkpoint)) != 0) {
         printf("Encoding failed!\n");
         return 1;
     }
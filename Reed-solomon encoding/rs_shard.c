@@ -0,0 +1,928 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// Reuse the GF(2^16) codec and the archive header
+#define RS_DECODER_NO_MAIN
+#include "rs_decoding_binary.c"
+
+/*
+ * Sharded archive coding across worker processes.
+ *
+ * The coordinator cuts a --gf16 archive into shards of whole codewords and
+ * hands them to workers over a stream socket: a Unix socket for workers on
+ * this machine, or TCP so that workers on other hosts can join with
+ * --worker tcp:HOST:PORT (the input path must then be visible to them).
+ * A worker maps the input file, codes its shard and streams the result
+ * back; the coordinator writes it at the shard's place in the output.
+ *
+ * Protocol fields are big-endian and every job carries all the worker
+ * needs, so workers keep no state between jobs. When a worker dies its
+ * shard goes back to the queue, local workers are restarted, and a
+ * restarted (or new) worker simply connects again.
+ *
+ * After the codewords the encoder appends an index: each shard's codeword
+ * range and the CRC-32 of its encoded bytes. The plain --gf16 decoder
+ * ignores it; the sharded decoder cuts its shards on the same boundaries
+ * and reports which ones arrived damaged.
+ */
+#define SHARD_DEFAULT_ADDRESS "unix:/tmp/rs_shard.sock"
+#define SHARD_DEFAULT_WORKERS 4
+#define SHARD_DEFAULT_CODEWORDS RS16_LANES  // Codewords per shard: one full lane batch
+#define SHARD_MAX_WORKERS 64
+#define SHARD_MAX_ATTEMPTS 3          // Workers a shard may fail on before the run stops
+#define SHARD_MAX_MESSAGE (64 << 20)
+#define SHARD_CONNECT_TRIES 50        // 100 ms apart
+#define SHARD_PROTOCOL 1
+
+static const uint8_t SHARD_INDEX_MAGIC[4] = { 'R', 'S', 'I', 'X' };
+
+enum { MSG_HELLO = 1, MSG_JOB, MSG_DATA, MSG_DONE, MSG_BYE };
+enum { JOB_ENCODE = 1, JOB_DECODE };
+enum { SHARD_PENDING, SHARD_RUNNING, SHARD_DONE };
+
+/*
+ * Message: type and payload length (u32 each), then the payload.
+ *   HELLO  version, pid
+ *   JOB    shard, op, n, k, first codeword, codewords, data length (u64), input path
+ *   DATA   shard, output offset (u64), bytes
+ *   DONE   shard, status, CRC-32 of the shard's codewords, corrected, failed
+ *   BYE    (no payload)
+ */
+#define JOB_HEADER 32
+#define DATA_HEADER 12
+#define DONE_SIZE 20
+
+typedef struct {
+    uint32_t shard, op, n, k, first, count;
+    uint64_t length;
+    char path[4096];
+} shard_job_t;
+
+typedef struct {
+    uint32_t first, count;
+    int state;
+    int attempts;
+    int has_crc;                // Decode: the index supplied a CRC
+    uint32_t crc, index_crc;
+    uint32_t corrected, failed;
+} shard_t;
+
+typedef struct {
+    int fd;
+    int shard;                  // Shard in progress, or -1
+} worker_conn_t;
+
+/* ---------------------------------------------------------------------- */
+/* Wire format                                                              */
+/* ---------------------------------------------------------------------- */
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+    put_u32(p, v >> 32);
+    put_u32(p + 4, (uint32_t)v);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return ((uint64_t)get_u32(p) << 32) | get_u32(p + 4);
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int send_message(int fd, uint32_t type, const uint8_t *head, size_t head_len,
+                        const void *body, size_t body_len) {
+    uint8_t frame[8];
+    put_u32(frame, type);
+    put_u32(frame + 4, head_len + body_len);
+    return (write_all(fd, frame, 8) < 0 || write_all(fd, head, head_len) < 0 ||
+            write_all(fd, body, body_len) < 0) ? -1 : 0;
+}
+
+// Receive one message into a growing buffer; -1 on disconnect or bad framing
+static int recv_message(int fd, uint32_t *type, uint8_t **buf, size_t *capacity, uint32_t *len) {
+    uint8_t frame[8];
+    if (read_all(fd, frame, 8) < 0) {
+        return -1;
+    }
+    *type = get_u32(frame);
+    *len = get_u32(frame + 4);
+    if (*len > SHARD_MAX_MESSAGE) {
+        return -1;
+    }
+    if (*len > *capacity) {
+        uint8_t *grown = realloc(*buf, *len);
+        if (!grown) return -1;
+        *buf = grown;
+        *capacity = *len;
+    }
+    return read_all(fd, *buf, *len);
+}
+
+/**
+ * Open a stream socket for "unix:PATH" or "tcp:HOST:PORT", listening (for
+ * the coordinator) or connected (for a worker)
+ */
+static int shard_socket(const char *address, int listening) {
+    int fd = -1;
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+        strncpy(addr.sun_path, address + 5, sizeof(addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (listening) {
+            unlink(addr.sun_path);
+            if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 && listen(fd, SHARD_MAX_WORKERS) == 0) {
+                return fd;
+            }
+        } else if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        return -1;
+    }
+
+    if (strncmp(address, "tcp:", 4) == 0) {
+        char host[256];
+        const char *port = strrchr(address + 4, ':');
+        struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+        struct addrinfo *list, *ai;
+        int one = 1;
+
+        if (!port || port - (address + 4) >= (long)sizeof(host)) return -1;
+        memcpy(host, address + 4, port - (address + 4));
+        host[port - (address + 4)] = '\0';
+        hints.ai_flags = listening ? AI_PASSIVE : 0;
+        if (getaddrinfo(host[0] ? host : NULL, port + 1, &hints, &list) != 0) return -1;
+
+        for (ai = list; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (listening) {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, SHARD_MAX_WORKERS) == 0) break;
+            } else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                break;
+            }
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(list);
+        return fd;
+    }
+
+    printf("Error: Address must be unix:PATH or tcp:HOST:PORT\n");
+    return -1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Archive layout                                                           */
+/* ---------------------------------------------------------------------- */
+
+static uint32_t crc32_table[256];
+
+static void crc32_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int j = 0; j < 8; j++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc32_table[i] = c;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc = crc32_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+typedef struct {
+    int n, k, nroots;
+    uint64_t length;            // Data bytes
+    uint64_t data_symbols;
+    uint32_t codewords;
+} archive_layout_t;
+
+static void layout_init(archive_layout_t *a, int n, int k, uint64_t length) {
+    a->n = n;
+    a->k = k;
+    a->nroots = n - k;
+    a->length = length;
+    a->data_symbols = (length + 1) / 2;
+    a->codewords = (a->data_symbols + k - 1) / k;
+}
+
+// Data symbols in codeword c (only the last one is shortened)
+static int layout_data(const archive_layout_t *a, uint32_t c) {
+    uint64_t left = a->data_symbols - (uint64_t)c * a->k;
+    return left < (uint64_t)a->k ? (int)left : a->k;
+}
+
+static uint64_t layout_offset(const archive_layout_t *a, uint32_t c) {
+    return RS16_HEADER_SIZE + (uint64_t)c * a->n * 2;
+}
+
+// End of the codewords, where the shard index starts
+static uint64_t layout_end(const archive_layout_t *a) {
+    return RS16_HEADER_SIZE + 2 * (a->data_symbols + (uint64_t)a->codewords * a->nroots);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Worker                                                                   */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Encode: data symbols come straight from the mapped input, except for a
+ * last codeword that ends in half a symbol. Decode: codewords are copied
+ * out of the mapped archive; symbols past its end are erasures.
+ */
+static int worker_run_job(int fd, const shard_job_t *job, rs16_code_t *rs,
+                          const uint8_t *input, size_t input_size, uint8_t *done) {
+    archive_layout_t a;
+    int nroots = rs->nroots;
+    uint32_t crc = 0, corrected = 0, failed = 0;
+    uint16_t *words = malloc((size_t)RS16_LANES * rs->n * 2);
+    uint8_t *out = malloc((size_t)RS16_LANES * rs->n * 2);
+    uint8_t head[DATA_HEADER];
+    int result = 0;
+
+    layout_init(&a, job->n, job->k, job->length);
+    if (!words || !out) {
+        result = -1;
+    }
+
+    for (uint32_t c = job->first; result == 0 && c < job->first + job->count; c += RS16_LANES) {
+        uint16_t *lane_words[RS16_LANES];
+        int len[RS16_LANES], present[RS16_LANES], status[RS16_LANES];
+        int count = (job->first + job->count - c < RS16_LANES) ? job->first + job->count - c : RS16_LANES;
+        size_t out_len = 0;
+        uint64_t out_offset;
+
+        for (int lane = 0; lane < count; lane++) {
+            int data_len = layout_data(&a, c + lane);
+            lane_words[lane] = words + (size_t)lane * a.n;
+            len[lane] = (job->op == JOB_ENCODE) ? data_len : data_len + nroots;
+
+            if (job->op == JOB_ENCODE) {
+                uint64_t start = (uint64_t)(c + lane) * a.k * 2;
+                size_t bytes = (start + 2 * (uint64_t)data_len <= input_size) ? 2 * (size_t)data_len
+                             : (start < input_size ? input_size - start : 0);
+                memcpy(lane_words[lane], input + start, bytes);
+                memset((uint8_t *)lane_words[lane] + bytes, 0, 2 * (size_t)data_len - bytes);
+            } else {
+                uint64_t start = layout_offset(&a, c + lane);
+                size_t bytes = (start + 2 * (uint64_t)len[lane] <= input_size) ? 2 * (size_t)len[lane]
+                             : (start < input_size ? input_size - start : 0);
+                memcpy(lane_words[lane], input + start, bytes);
+                crc = crc32_update(crc, input + start, bytes);
+                present[lane] = bytes / 2;
+                memset(lane_words[lane] + present[lane], 0, 2 * (size_t)(len[lane] - present[lane]));
+            }
+        }
+
+        if (job->op == JOB_ENCODE) {
+            uint16_t *parity[RS16_LANES];
+            for (int lane = 0; lane < count; lane++) {
+                parity[lane] = lane_words[lane] + len[lane];
+            }
+            rs16_encode_batch(rs, (const uint16_t *const *)lane_words, len, count, parity);
+            for (int lane = 0; lane < count; lane++) {
+                size_t bytes = 2 * (size_t)(len[lane] + nroots);
+                memcpy(out + out_len, lane_words[lane], bytes);
+                out_len += bytes;
+            }
+            crc = crc32_update(crc, out, out_len);
+            out_offset = layout_offset(&a, c);
+        } else {
+            rs16_decode_batch(rs, lane_words, len, present, count, status);
+            for (int lane = 0; lane < count; lane++) {
+                uint64_t start = (uint64_t)(c + lane) * a.k * 2;
+                size_t bytes = 2 * (size_t)(len[lane] - nroots);
+                if (start + bytes > a.length) {
+                    bytes = a.length - start;
+                }
+                memcpy(out + out_len, lane_words[lane], bytes);
+                out_len += bytes;
+                corrected += status[lane] > 0;
+                failed += status[lane] < 0;
+            }
+            out_offset = (uint64_t)c * a.k * 2;
+        }
+
+        put_u32(head, job->shard);
+        put_u64(head + 4, out_offset);
+        if (send_message(fd, MSG_DATA, head, DATA_HEADER, out, out_len) < 0) {
+            result = -2;
+        }
+    }
+
+    put_u32(done, job->shard);
+    put_u32(done + 4, result == 0 ? 0 : 1);
+    put_u32(done + 8, crc);
+    put_u32(done + 12, corrected);
+    put_u32(done + 16, failed);
+    free(words);
+    free(out);
+    return result == -2 ? -1 : 0;
+}
+
+static int parse_job(const uint8_t *p, uint32_t len, shard_job_t *job) {
+    if (len < JOB_HEADER || len - JOB_HEADER >= sizeof(job->path)) {
+        return -1;
+    }
+    job->shard = get_u32(p);
+    job->op = get_u32(p + 4);
+    job->n = get_u32(p + 8);
+    job->k = get_u32(p + 12);
+    job->first = get_u32(p + 16);
+    job->count = get_u32(p + 20);
+    job->length = get_u64(p + 24);
+    memcpy(job->path, p + JOB_HEADER, len - JOB_HEADER);
+    job->path[len - JOB_HEADER] = '\0';
+    return 0;
+}
+
+/**
+ * Worker: connect to the coordinator and code shards until it says BYE or
+ * goes away. The input is mapped once per job, so a worker can serve runs
+ * on different files one after another.
+ */
+int run_worker(const char *address) {
+    uint8_t hello[8], done[DONE_SIZE];
+    uint8_t *buf = NULL;
+    size_t capacity = 0;
+    rs16_code_t rs = { 0 };
+    int fd = -1;
+
+    for (int i = 0; i < SHARD_CONNECT_TRIES && fd < 0; i++) {
+        if ((fd = shard_socket(address, 0)) < 0) {
+            usleep(100000);
+        }
+    }
+    if (fd < 0) {
+        printf("Error: Cannot reach coordinator at %s\n", address);
+        return -1;
+    }
+    put_u32(hello, SHARD_PROTOCOL);
+    put_u32(hello + 4, getpid());
+    if (send_message(fd, MSG_HELLO, hello, sizeof(hello), NULL, 0) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    for (;;) {
+        uint32_t type, len;
+        shard_job_t job;
+
+        if (recv_message(fd, &type, &buf, &capacity, &len) < 0 || type != MSG_JOB ||
+            parse_job(buf, len, &job) < 0) {
+            break;  // BYE, or the coordinator is gone
+        }
+
+        int status = -1;
+        int input_fd = open(job.path, O_RDONLY);
+        struct stat st;
+        if (input_fd >= 0 && fstat(input_fd, &st) == 0 && st.st_size > 0 &&
+            ((int)job.n == rs.n && (int)job.k == rs.k ? 0 : (rs16_free(&rs), rs16_init(&rs, job.n, job.k))) == 0) {
+            uint8_t *input = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, input_fd, 0);
+            if (input != MAP_FAILED) {
+                madvise(input, st.st_size, MADV_SEQUENTIAL);
+                status = worker_run_job(fd, &job, &rs, input, st.st_size, done);
+                munmap(input, st.st_size);
+            }
+        }
+        if (input_fd >= 0) {
+            close(input_fd);
+        }
+        if (status < 0) {
+            if (input_fd < 0) {
+                printf("Worker %d: Cannot open %s\n", getpid(), job.path);
+            }
+            memset(done, 0, sizeof(done));
+            put_u32(done, job.shard);
+            put_u32(done + 4, 1);
+        }
+        if (send_message(fd, MSG_DONE, done, sizeof(done), NULL, 0) < 0) {
+            break;
+        }
+    }
+
+    rs16_free(&rs);
+    free(buf);
+    close(fd);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Coordinator                                                              */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    int op;
+    const char *input;
+    archive_layout_t layout;
+    int out_fd;
+    uint64_t out_size;
+    shard_t *shards;
+    int shard_count;
+    int done;
+    worker_conn_t conns[SHARD_MAX_WORKERS];
+    pid_t pids[SHARD_MAX_WORKERS];      // Local workers, 0 when not running
+    int local_workers;
+    int reassigned, restarts;
+} coordinator_t;
+
+static pid_t spawn_worker(int listen_fd, const char *address) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(listen_fd);
+        _exit(run_worker(address) < 0 ? 1 : 0);
+    }
+    return pid;
+}
+
+static void assign_shard(coordinator_t *co, worker_conn_t *conn) {
+    uint8_t head[JOB_HEADER];
+
+    for (int s = 0; s < co->shard_count; s++) {
+        shard_t *shard = &co->shards[s];
+        if (shard->state != SHARD_PENDING) {
+            continue;
+        }
+        put_u32(head, s);
+        put_u32(head + 4, co->op);
+        put_u32(head + 8, co->layout.n);
+        put_u32(head + 12, co->layout.k);
+        put_u32(head + 16, shard->first);
+        put_u32(head + 20, shard->count);
+        put_u64(head + 24, co->layout.length);
+        if (send_message(conn->fd, MSG_JOB, head, JOB_HEADER, co->input, strlen(co->input)) == 0) {
+            shard->state = SHARD_RUNNING;
+            conn->shard = s;
+        }
+        return;
+    }
+}
+
+// A worker went away: its shard, if any, goes back to the queue
+static int drop_worker(coordinator_t *co, worker_conn_t *conn) {
+    int result = 0;
+
+    if (conn->shard >= 0) {
+        shard_t *shard = &co->shards[conn->shard];
+        shard->state = SHARD_PENDING;
+        co->reassigned++;
+        if (++shard->attempts >= SHARD_MAX_ATTEMPTS) {
+            printf("Error: Shard %d failed on %d workers\n", conn->shard, shard->attempts);
+            result = -1;
+        }
+    }
+    close(conn->fd);
+    conn->fd = -1;
+    conn->shard = -1;
+    return result;
+}
+
+static int handle_message(coordinator_t *co, worker_conn_t *conn, uint8_t **buf, size_t *capacity) {
+    uint32_t type, len;
+
+    if (recv_message(conn->fd, &type, buf, capacity, &len) < 0) {
+        return drop_worker(co, conn);
+    }
+    const uint8_t *p = *buf;
+
+    if (type == MSG_DATA && len >= DATA_HEADER && (int)get_u32(p) == conn->shard) {
+        uint64_t offset = get_u64(p + 4);
+        size_t bytes = len - DATA_HEADER;
+        if (offset + bytes > co->out_size ||
+            pwrite(co->out_fd, p + DATA_HEADER, bytes, offset) != (ssize_t)bytes) {
+            printf("Error: Cannot write shard %d output (%s)\n", conn->shard, strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+
+    if (type == MSG_DONE && len == DONE_SIZE && (int)get_u32(p) == conn->shard) {
+        shard_t *shard = &co->shards[conn->shard];
+        if (get_u32(p + 4) != 0) {
+            return drop_worker(co, conn);
+        }
+        shard->crc = get_u32(p + 8);
+        shard->corrected = get_u32(p + 12);
+        shard->failed = get_u32(p + 16);
+        shard->state = SHARD_DONE;
+        conn->shard = -1;
+        co->done++;
+        assign_shard(co, conn);
+        return 0;
+    }
+
+    return drop_worker(co, conn);
+}
+
+// Restart local workers that exited while shards are left
+static void reap_workers(coordinator_t *co, int listen_fd, const char *address) {
+    pid_t pid;
+    int status;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int w = 0; w < co->local_workers; w++) {
+            if (co->pids[w] != pid) {
+                continue;
+            }
+            co->pids[w] = 0;
+            if (co->done < co->shard_count) {
+                printf("Worker %d exited (status %d), restarting\n", pid, status);
+                co->pids[w] = spawn_worker(listen_fd, address);
+                co->restarts++;
+            }
+        }
+    }
+}
+
+/**
+ * Hand out every shard and collect the results. Local workers are forked
+ * here; with none, the coordinator waits for workers started elsewhere.
+ */
+static int coordinate(coordinator_t *co, const char *address, int workers) {
+    struct pollfd fds[SHARD_MAX_WORKERS + 1];
+    uint8_t *buf = NULL;
+    size_t capacity = 0;
+    int result = 0;
+
+    int listen_fd = shard_socket(address, 1);
+    if (listen_fd < 0) {
+        printf("Error: Cannot listen on %s (%s)\n", address, strerror(errno));
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    for (int c = 0; c < SHARD_MAX_WORKERS; c++) {
+        co->conns[c].fd = -1;
+        co->conns[c].shard = -1;
+    }
+    fflush(stdout);
+    co->local_workers = co->shard_count > 0 ? workers : 0;
+    for (int w = 0; w < co->local_workers; w++) {
+        co->pids[w] = spawn_worker(listen_fd, address);
+    }
+    if (workers == 0 && co->shard_count > 0) {
+        printf("Waiting for workers: %s --worker %s\n", "rs_shard", address);
+    }
+
+    while (result == 0 && co->done < co->shard_count) {
+        int count = 0;
+        fds[count++] = (struct pollfd){ listen_fd, POLLIN, 0 };
+        for (int c = 0; c < SHARD_MAX_WORKERS; c++) {
+            if (co->conns[c].fd >= 0) {
+                fds[count++] = (struct pollfd){ co->conns[c].fd, POLLIN, 0 };
+            }
+        }
+        if (poll(fds, count, 200) < 0 && errno != EINTR) {
+            result = -1;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            uint32_t type, len;
+            int c;
+            for (c = 0; c < SHARD_MAX_WORKERS && co->conns[c].fd >= 0; c++);
+            if (fd >= 0 && (c == SHARD_MAX_WORKERS || recv_message(fd, &type, &buf, &capacity, &len) < 0 ||
+                            type != MSG_HELLO || len != 8 || get_u32(buf) != SHARD_PROTOCOL)) {
+                close(fd);
+            } else if (fd >= 0) {
+                co->conns[c].fd = fd;
+                co->conns[c].shard = -1;
+                assign_shard(co, &co->conns[c]);
+            }
+        }
+
+        for (int i = 1; i < count && result == 0; i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            for (int c = 0; c < SHARD_MAX_WORKERS; c++) {
+                if (co->conns[c].fd == fds[i].fd) {
+                    result = handle_message(co, &co->conns[c], &buf, &capacity);
+                    break;
+                }
+            }
+        }
+
+        // Shards freed by a lost worker go to idle ones
+        for (int c = 0; c < SHARD_MAX_WORKERS; c++) {
+            if (co->conns[c].fd >= 0 && co->conns[c].shard < 0) {
+                assign_shard(co, &co->conns[c]);
+            }
+        }
+        reap_workers(co, listen_fd, address);
+    }
+
+    for (int c = 0; c < SHARD_MAX_WORKERS; c++) {
+        if (co->conns[c].fd >= 0) {
+            send_message(co->conns[c].fd, MSG_BYE, NULL, 0, NULL, 0);
+            close(co->conns[c].fd);
+        }
+    }
+    // Workers still connecting see the socket closed and exit
+    close(listen_fd);
+    if (strncmp(address, "unix:", 5) == 0) {
+        unlink(address + 5);
+    }
+    for (int w = 0; w < co->local_workers; w++) {
+        if (co->pids[w] > 0) {
+            if (result < 0) {
+                kill(co->pids[w], SIGTERM);
+            }
+            waitpid(co->pids[w], NULL, 0);
+        }
+    }
+    free(buf);
+    return result;
+}
+
+static int cut_shards(coordinator_t *co, uint32_t per_shard) {
+    co->shard_count = (co->layout.codewords + per_shard - 1) / per_shard;
+    co->shards = calloc(co->shard_count ? co->shard_count : 1, sizeof(shard_t));
+    if (!co->shards) {
+        return -1;
+    }
+    for (int s = 0; s < co->shard_count; s++) {
+        co->shards[s].first = s * per_shard;
+        co->shards[s].count = (co->layout.codewords - s * per_shard < per_shard)
+                            ? co->layout.codewords - s * per_shard : per_shard;
+    }
+    return 0;
+}
+
+/*
+ * Index after the codewords: "RSIX", shard count, then first codeword,
+ * codeword count and CRC-32 per shard (all u32, big-endian).
+ */
+static int write_index(coordinator_t *co) {
+    size_t size = 8 + 12 * (size_t)co->shard_count;
+    uint8_t *index = malloc(size);
+    if (!index) {
+        return -1;
+    }
+    memcpy(index, SHARD_INDEX_MAGIC, 4);
+    put_u32(index + 4, co->shard_count);
+    for (int s = 0; s < co->shard_count; s++) {
+        put_u32(index + 8 + 12 * s, co->shards[s].first);
+        put_u32(index + 12 + 12 * s, co->shards[s].count);
+        put_u32(index + 16 + 12 * s, co->shards[s].crc);
+    }
+    int result = pwrite(co->out_fd, index, size, layout_end(&co->layout)) == (ssize_t)size ? 0 : -1;
+    free(index);
+    return result;
+}
+
+// Use the archive's index for the shard boundaries, if it has a valid one
+static int read_index(coordinator_t *co, int fd) {
+    uint8_t head[8];
+    uint64_t at = layout_end(&co->layout);
+
+    if (pread(fd, head, 8, at) != 8 || memcmp(head, SHARD_INDEX_MAGIC, 4) != 0) {
+        return -1;
+    }
+    uint32_t count = get_u32(head + 4);
+    if (count == 0 || count > co->layout.codewords) {
+        return -1;
+    }
+    uint8_t *index = malloc(12 * (size_t)count);
+    co->shards = calloc(count, sizeof(shard_t));
+    if (!index || !co->shards || pread(fd, index, 12 * (size_t)count, at + 8) != 12 * (ssize_t)count) {
+        free(index);
+        free(co->shards);
+        co->shards = NULL;
+        return -1;
+    }
+
+    uint32_t next = 0;
+    for (uint32_t s = 0; s < count; s++) {
+        co->shards[s].first = get_u32(index + 12 * s);
+        co->shards[s].count = get_u32(index + 12 * s + 4);
+        co->shards[s].index_crc = get_u32(index + 12 * s + 8);
+        co->shards[s].has_crc = 1;
+        if (co->shards[s].first != next || co->shards[s].count == 0) {
+            break;
+        }
+        next += co->shards[s].count;
+    }
+    free(index);
+    if (next != co->layout.codewords) {
+        free(co->shards);
+        co->shards = NULL;
+        return -1;
+    }
+    co->shard_count = count;
+    return 0;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Sharded counterpart of encode_file_gf16: same archive, plus the index
+ */
+int shard_encode(const char *input_file, const char *output_file, int n, int k,
+                 const char *address, int workers, int per_shard) {
+    static coordinator_t co;
+    uint8_t header[RS16_HEADER_SIZE];
+    struct stat st;
+
+    if (n < 2 || n > GF16_ORDER || k < 1 || k >= n) {
+        printf("Error: GF(2^16) code needs 0 < k < n <= %d\n", GF16_ORDER);
+        return -1;
+    }
+    if (stat(input_file, &st) < 0) {
+        printf("Error: Cannot open input file '%s'\n", input_file);
+        return -1;
+    }
+    co.op = JOB_ENCODE;
+    co.input = realpath(input_file, NULL);
+    layout_init(&co.layout, n, k, st.st_size);
+    co.out_size = layout_end(&co.layout);
+    co.out_fd = open(output_file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    rs16_put_header(header, n, k, st.st_size);
+    if (!co.input || co.out_fd < 0 || cut_shards(&co, per_shard) < 0 ||
+        pwrite(co.out_fd, header, RS16_HEADER_SIZE, 0) != RS16_HEADER_SIZE ||
+        ftruncate(co.out_fd, co.out_size) < 0) {
+        printf("Error: Cannot create output file '%s'\n", output_file);
+        return -1;
+    }
+
+    printf("Encoding '%s': %u codewords of RS(%d,%d) in %d shards, %d local workers\n",
+           input_file, co.layout.codewords, n, k, co.shard_count, workers);
+    double start = now_seconds();
+    if (coordinate(&co, address, workers) < 0 || write_index(&co) < 0 || fsync(co.out_fd) < 0) {
+        printf("Error: Sharded encoding failed\n");
+        close(co.out_fd);
+        return -1;
+    }
+    double elapsed = now_seconds() - start;
+    close(co.out_fd);
+
+    printf("Encoding completed: %ld bytes in %.3f s (%.1f MB/s)\n",
+           (long)st.st_size, elapsed, st.st_size / elapsed / 1e6);
+    printf("Shards reassigned: %d, worker restarts: %d\n", co.reassigned, co.restarts);
+    return 0;
+}
+
+/**
+ * Sharded counterpart of decode_file_gf16
+ */
+int shard_decode(const char *input_file, const char *output_file,
+                 const char *address, int workers, int per_shard) {
+    static coordinator_t co;
+    uint8_t header[RS16_HEADER_SIZE];
+    uint64_t length;
+    int n, k;
+
+    int fd = open(input_file, O_RDONLY);
+    if (fd < 0 || pread(fd, header, RS16_HEADER_SIZE, 0) != RS16_HEADER_SIZE ||
+        rs16_get_header(header, &n, &k, &length) < 0 || n < 2 || k < 1 || k >= n) {
+        printf("Error: Not a GF(2^16) archive\n");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    co.op = JOB_DECODE;
+    co.input = realpath(input_file, NULL);
+    layout_init(&co.layout, n, k, length);
+    int indexed = read_index(&co, fd) == 0;
+    close(fd);
+    if (!indexed && cut_shards(&co, per_shard) < 0) {
+        return -1;
+    }
+
+    co.out_size = length;
+    co.out_fd = open(output_file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (!co.input || co.out_fd < 0 || ftruncate(co.out_fd, length) < 0) {
+        printf("Error: Cannot create output file '%s'\n", output_file);
+        return -1;
+    }
+
+    printf("Decoding '%s': %u codewords of RS(%d,%d) in %d shards%s, %d local workers\n",
+           input_file, co.layout.codewords, n, k, co.shard_count,
+           indexed ? " (from index)" : "", workers);
+    double start = now_seconds();
+    if (coordinate(&co, address, workers) < 0 || fsync(co.out_fd) < 0) {
+        printf("Error: Sharded decoding failed\n");
+        close(co.out_fd);
+        return -1;
+    }
+    double elapsed = now_seconds() - start;
+    close(co.out_fd);
+
+    uint32_t corrected = 0, failed = 0;
+    for (int s = 0; s < co.shard_count; s++) {
+        shard_t *shard = &co.shards[s];
+        corrected += shard->corrected;
+        failed += shard->failed;
+        if (shard->has_crc && shard->crc != shard->index_crc) {
+            printf("Shard %d (codewords %u-%u): damaged, %u codewords corrected, %u failed\n",
+                   s, shard->first, shard->first + shard->count - 1, shard->corrected, shard->failed);
+        }
+    }
+    printf("Decoding complete: %u codewords processed, %u corrected, %u failed\n",
+           co.layout.codewords, corrected, failed);
+    printf("%llu bytes in %.3f s (%.1f MB/s); shards reassigned: %d, worker restarts: %d\n",
+           (unsigned long long)length, elapsed, length / elapsed / 1e6, co.reassigned, co.restarts);
+    return failed > 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *address = SHARD_DEFAULT_ADDRESS;
+    int workers = SHARD_DEFAULT_WORKERS, per_shard = SHARD_DEFAULT_CODEWORDS;
+    int n = 0, k = 0;
+
+    init_gf16_field();
+    crc32_init();
+
+    if (argc >= 2 && strcmp(argv[1], "--worker") == 0) {
+        return run_worker(argc >= 3 ? argv[2] : address) < 0 ? 1 : 0;
+    }
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--gf16") == 0 && i + 2 < argc) {
+            n = atoi(argv[++i]);
+            k = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            per_shard = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            address = argv[++i];
+        } else {
+            argc = 0;
+        }
+    }
+    if (workers < 0 || workers > SHARD_MAX_WORKERS || per_shard < 1) {
+        argc = 0;
+    }
+
+    if (argc >= 4 && strcmp(argv[1], "encode") == 0 && n > 0) {
+        return shard_encode(argv[2], argv[3], n, k, address, workers, per_shard) < 0 ? 1 : 0;
+    }
+    if (argc >= 4 && strcmp(argv[1], "decode") == 0) {
+        int result = shard_decode(argv[2], argv[3], address, workers, per_shard);
+        return result < 0 ? 2 : result;
+    }
+
+    printf("Usage: %s encode INPUT ARCHIVE --gf16 N K [options]\n", argv[0]);
+    printf("       %s decode ARCHIVE OUTPUT [options]\n", argv[0]);
+    printf("       %s --worker [ADDRESS]\n", argv[0]);
+    printf("  --workers W   local worker processes (default %d; 0 = wait for --worker)\n", SHARD_DEFAULT_WORKERS);
+    printf("  --shard C     codewords per shard (default %d)\n", SHARD_DEFAULT_CODEWORDS);
+    printf("  --listen A    unix:PATH or tcp:HOST:PORT (default %s)\n", SHARD_DEFAULT_ADDRESS);
+    return 1;
+}
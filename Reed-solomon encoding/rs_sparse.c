@@ -0,0 +1,239 @@
+/*
+ * Sparse file support for encode_file / decode_file (included by the
+ * encoder and decoder).
+ *
+ * An all-zero block encodes to the all-zero codeword and an all-zero
+ * codeword has zero syndromes, so zero blocks need no coding work at all;
+ * block_is_zero() finds them with wide compares. On input, the holes of a
+ * sparse file are mapped once with SEEK_DATA/SEEK_HOLE and handed out as
+ * zeros without being read. On output, long runs of zeros are skipped with
+ * a seek instead of written, so a sparse input gives a sparse output.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifndef SEEK_DATA
+#define SEEK_DATA 3                     // Linux values, hidden without _GNU_SOURCE
+#define SEEK_HOLE 4
+#endif
+
+#define SPARSE_MAX_EXTENTS 65536        // Past this many data extents the rest is read normally
+#define SPARSE_MIN_HOLE (64 * 1024)     // Shorter zero runs are written, not skipped
+
+// True if all 'length' bytes are zero
+static int block_is_zero(const uint8_t *p, size_t length) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 64 <= length; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 32));
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) {
+            return 0;
+        }
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) != 0xFFFF) {
+            return 0;
+        }
+    }
+#endif
+    uint8_t any = 0;
+    for (; i < length; i++) {
+        any |= p[i];
+    }
+    return any == 0;
+}
+
+typedef struct {
+    uint64_t start, end;
+} sparse_extent_t;
+
+typedef struct {
+    sparse_extent_t *data;              // Data extents in file order, holes between them
+    long count;
+    long next;                          // First extent not wholly before pos
+    uint64_t mapped_end;                // Past this everything is read
+    uint64_t pos;                       // Logical stream position
+    int seek;                           // fp is still behind pos after a skipped hole
+    uint64_t hole_bytes;                // Zeros handed out without reading
+} sparse_input_t;
+
+/**
+ * Map the holes of the input. Must be called before anything is read from
+ * 'fp'; streams and files without holes are simply read as usual.
+ */
+void sparse_input_init(sparse_input_t *s, FILE *fp) {
+    int fd = fileno(fp);
+    struct stat st;
+    off_t offset = 0;
+
+    memset(s, 0, sizeof(*s));
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return;
+    }
+    while (offset < st.st_size && s->count < SPARSE_MAX_EXTENTS) {
+        off_t data = lseek(fd, offset, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) {
+                offset = st.st_size;    // Only a hole is left
+            }
+            break;
+        }
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole < 0) {
+            break;
+        }
+        if (s->count % 64 == 0) {
+            sparse_extent_t *grown = realloc(s->data, (s->count + 64) * sizeof(*grown));
+            if (!grown) {
+                break;
+            }
+            s->data = grown;
+        }
+        s->data[s->count++] = (sparse_extent_t){ data, hole };
+        offset = hole;
+    }
+    lseek(fd, 0, SEEK_SET);
+
+    // Without a hole there is nothing to skip
+    if (s->count == 1 && s->data[0].start == 0 && s->data[0].end >= (uint64_t)offset) {
+        s->count = 0;
+        offset = 0;
+    }
+    s->mapped_end = offset;
+}
+
+// The caller moved fp to 'offset' (e.g. to resume from a checkpoint)
+void sparse_input_at(sparse_input_t *s, uint64_t offset) {
+    s->pos = offset;
+    s->next = 0;
+    s->seek = 0;
+}
+
+/**
+ * fread() replacement: bytes inside a mapped hole are returned as zeros
+ * and skipped over in 'fp' instead of read.
+ */
+size_t sparse_read(sparse_input_t *s, uint8_t *buf, size_t length, FILE *fp) {
+    size_t done = 0;
+
+    while (done < length) {
+        size_t chunk = length - done;
+
+        if (s->pos < s->mapped_end) {
+            while (s->next < s->count && s->data[s->next].end <= s->pos) {
+                s->next++;
+            }
+            uint64_t hole_end = s->next < s->count ? s->data[s->next].start : s->mapped_end;
+            if (s->pos < hole_end) {
+                if (chunk > hole_end - s->pos) {
+                    chunk = hole_end - s->pos;
+                }
+                memset(buf + done, 0, chunk);
+                done += chunk;
+                s->pos += chunk;
+                s->hole_bytes += chunk;
+                s->seek = 1;
+                continue;
+            }
+            if (chunk > s->data[s->next].end - s->pos) {
+                chunk = s->data[s->next].end - s->pos;
+            }
+        }
+        if (s->seek) {
+            if (fseeko(fp, s->pos, SEEK_SET) < 0) {
+                break;
+            }
+            s->seek = 0;
+        }
+        size_t got = fread(buf + done, 1, chunk, fp);
+        done += got;
+        s->pos += got;
+        if (got < chunk) {
+            break;
+        }
+    }
+    return done;
+}
+
+void sparse_input_free(sparse_input_t *s) {
+    free(s->data);
+    s->data = NULL;
+    s->count = 0;
+}
+
+typedef struct {
+    FILE *fp;
+    int enabled;                        // Regular file: zero runs may become holes
+    uint64_t pending;                   // Zero bytes not yet written or skipped
+    uint64_t hole_bytes;
+} sparse_output_t;
+
+void sparse_output_init(sparse_output_t *so, FILE *fp) {
+    struct stat st;
+
+    memset(so, 0, sizeof(*so));
+    so->fp = fp;
+    // Seeking ahead does not leave a gap in an O_APPEND file (stdout >> file)
+    so->enabled = fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) &&
+                  !(fcntl(fileno(fp), F_GETFL) & O_APPEND);
+}
+
+// Put the pending zeros in the file: a hole if the run is long enough
+int sparse_output_flush(sparse_output_t *so) {
+    static const uint8_t zeros[4096];
+
+    if (so->pending >= SPARSE_MIN_HOLE) {
+        if (fseeko(so->fp, so->pending, SEEK_CUR) < 0) {
+            return -1;
+        }
+        so->hole_bytes += so->pending;
+        so->pending = 0;
+    }
+    while (so->pending > 0) {
+        size_t chunk = so->pending < sizeof(zeros) ? so->pending : sizeof(zeros);
+        if (fwrite(zeros, 1, chunk, so->fp) != chunk) {
+            return -1;
+        }
+        so->pending -= chunk;
+    }
+    return 0;
+}
+
+// fwrite() replacement that holds back zero blocks. Returns 0 or -1.
+int sparse_write(sparse_output_t *so, const uint8_t *p, size_t length) {
+    if (so->enabled && block_is_zero(p, length)) {
+        so->pending += length;
+        return 0;
+    }
+    if (so->pending > 0 && sparse_output_flush(so) < 0) {
+        return -1;
+    }
+    return fwrite(p, 1, length, so->fp) == length ? 0 : -1;
+}
+
+/**
+ * Flush the pending zeros before the file is closed. A trailing hole is
+ * only a seek, so the file is extended to its full length here.
+ */
+int sparse_output_finish(sparse_output_t *so) {
+    if (sparse_output_flush(so) < 0 || fflush(so->fp) != 0) {
+        return -1;
+    }
+    if (so->hole_bytes > 0) {
+        off_t end = ftello(so->fp);
+        struct stat st;
+        if (fstat(fileno(so->fp), &st) < 0 || (st.st_size < end && ftruncate(fileno(so->fp), end) < 0)) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * io_uring file pipeline shared by the encoder and decoder (included by
+ * both with --uring support). Talks to the kernel through the raw system
+ * calls, so it needs only <linux/io_uring.h>.
+ *
+ * The input is processed in chunks of whole blocks. URING_DEPTH buffer
+ * slots are registered with the ring; while the coding stage works on one
+ * chunk, reads of the following chunks and writes of the previous ones are
+ * in flight, so the disk and the CPU stay busy at the same time.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define URING_DEPTH 3              // Buffer slots: read ahead, compute, write behind
+#define URING_CHUNK_BLOCKS 4096    // Blocks per chunk (about 1 MB of codewords)
+#define URING_BUF_ALIGN 4096
+
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned pending;              // SQEs queued but not yet submitted
+} uring_t;
+
+/**
+ * Called once per chunk with whole input blocks (the last chunk may end in
+ * a partial block). Writes the transformed blocks to 'out' and returns
+ * the number of output bytes.
+ */
+typedef long (*uring_transform_t)(const uint8_t *in, long in_len, uint8_t *out, long first_block, void *ctx);
+
+typedef struct {
+    long bytes_in;
+    long bytes_out;
+    double seconds;
+    double compute_seconds;
+    int direct;        // Input read with O_DIRECT, past the page cache
+} uring_stats_t;
+
+static int uring_init(uring_t *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+    }
+    if (ring->cq_ring != MAP_FAILED) {
+        ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_SQES);
+    }
+    if (ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        int saved = errno;
+        if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        errno = saved;
+        return -1;
+    }
+
+    uint8_t *sq = ring->sq_ring, *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static void uring_exit(uring_t *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+// Queue a fixed-buffer read or write; submitted by the next uring_wait()
+static void uring_queue(uring_t *ring, int opcode, int fd, void *buf, unsigned len, long offset,
+                        int buf_index, uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->buf_index = buf_index;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+}
+
+// Submit everything queued and wait for at least one completion
+static int uring_wait(uring_t *ring, struct io_uring_cqe *cqe) {
+    for (;;) {
+        unsigned head = *ring->cq_head;
+        if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) && ring->pending == 0) {
+            *cqe = ring->cqes[head & *ring->cq_mask];
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+        int submitted = syscall(__NR_io_uring_enter, ring->fd, ring->pending, ring->pending ? 0 : 1,
+                                IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        ring->pending -= submitted;
+    }
+}
+
+static double uring_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    long chunk;        // Chunk held, -1 when free
+    long done;         // Bytes read (or written) so far
+    long length;       // Bytes expected
+    long out_offset;
+    int state;         // 0 free, 1 reading, 2 read, 3 writing
+} uring_slot_t;
+
+// O_DIRECT transfers must cover whole aligned blocks; reads past EOF come back short
+static long uring_direct_length(long length) {
+    return (length + URING_BUF_ALIGN - 1) / URING_BUF_ALIGN * URING_BUF_ALIGN;
+}
+
+/**
+ * Run 'fn' over the input file in whole blocks of 'in_unit' bytes, writing
+ * its output in order. With 'fn' NULL the input is only read, which gives
+ * the raw bandwidth to compare against: that pass opens the file with
+ * O_DIRECT so it measures the device rather than the page cache, or, where
+ * the file system has no O_DIRECT, drops the file's cached pages first.
+ * Returns 0 on success.
+ */
+int uring_file_transform(const char *input_file, const char *output_file, long in_unit, long out_unit,
+                         uring_transform_t fn, void *ctx, uring_stats_t *stats) {
+    uring_t ring;
+    uring_slot_t slots[URING_DEPTH];
+    struct iovec iov[2 * URING_DEPTH];
+    long chunk_in = URING_CHUNK_BLOCKS * in_unit;
+    long chunk_out = URING_CHUNK_BLOCKS * out_unit;
+    int in_fd, out_fd = -1, result = -1;
+    struct stat st;
+
+    memset(stats, 0, sizeof(*stats));
+    in_fd = fn ? -1 : open(input_file, O_RDONLY | O_DIRECT);
+    stats->direct = in_fd >= 0;
+    if (in_fd < 0) {
+        in_fd = open(input_file, O_RDONLY);
+        if (!fn && in_fd >= 0) {
+            posix_fadvise(in_fd, 0, 0, POSIX_FADV_DONTNEED);
+        }
+    }
+    if (in_fd < 0 || fstat(in_fd, &st) < 0) {
+        printf("Error: Cannot open input file '%s'\n", input_file);
+        if (in_fd >= 0) close(in_fd);
+        return -1;
+    }
+    if (fn) {
+        out_fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            printf("Error: Cannot create output file '%s'\n", output_file);
+            close(in_fd);
+            return -1;
+        }
+    }
+    if (uring_init(&ring, 2 * URING_DEPTH) < 0) {
+        printf("Error: io_uring is not available (%s)\n", strerror(errno));
+        close(in_fd);
+        if (out_fd >= 0) close(out_fd);
+        return -1;
+    }
+
+    // Input buffers are fixed buffers 0..DEPTH-1, output buffers DEPTH..2*DEPTH-1
+    for (int s = 0; s < URING_DEPTH; s++) {
+        iov[s].iov_len = chunk_in;
+        iov[URING_DEPTH + s].iov_len = chunk_out;
+        iov[s].iov_base = aligned_alloc(URING_BUF_ALIGN, (chunk_in + URING_BUF_ALIGN - 1) / URING_BUF_ALIGN * URING_BUF_ALIGN);
+        iov[URING_DEPTH + s].iov_base = aligned_alloc(URING_BUF_ALIGN, (chunk_out + URING_BUF_ALIGN - 1) / URING_BUF_ALIGN * URING_BUF_ALIGN);
+        slots[s].state = 0;
+        slots[s].chunk = -1;
+    }
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iov, 2 * URING_DEPTH) < 0) {
+        printf("Error: Cannot register io_uring buffers (%s)\n", strerror(errno));
+        goto out;
+    }
+
+    long total_chunks = (st.st_size + chunk_in - 1) / chunk_in;
+    long next_read = 0, next_compute = 0, writes_done = 0, out_offset = 0;
+    double start = uring_now();
+
+    while ((fn ? writes_done : next_compute) < total_chunks) {
+        int progressed = 0;
+
+        for (int s = 0; s < URING_DEPTH && next_read < total_chunks; s++) {
+            if (slots[s].state == 0) {
+                long offset = next_read * chunk_in;
+                slots[s].chunk = next_read++;
+                slots[s].done = 0;
+                slots[s].length = (st.st_size - offset < chunk_in) ? st.st_size - offset : chunk_in;
+                slots[s].state = 1;
+                uring_queue(&ring, IORING_OP_READ_FIXED, in_fd, iov[s].iov_base,
+                            stats->direct ? uring_direct_length(slots[s].length) : slots[s].length, offset, s, s);
+            }
+        }
+
+        // Compute strictly in order, so output offsets can simply accumulate
+        for (int s = 0; s < URING_DEPTH; s++) {
+            if (slots[s].state == 2 && slots[s].chunk == next_compute) {
+                stats->bytes_in += slots[s].length;
+                if (!fn) {
+                    slots[s].state = 0;
+                } else {
+                    double t = uring_now();
+                    long produced = fn(iov[s].iov_base, slots[s].length, iov[URING_DEPTH + s].iov_base,
+                                       next_compute * URING_CHUNK_BLOCKS, ctx);
+                    stats->compute_seconds += uring_now() - t;
+                    slots[s].done = 0;
+                    slots[s].length = produced;
+                    slots[s].out_offset = out_offset;
+                    slots[s].state = 3;
+                    out_offset += produced;
+                    stats->bytes_out += produced;
+                    uring_queue(&ring, IORING_OP_WRITE_FIXED, out_fd, iov[URING_DEPTH + s].iov_base,
+                                produced, slots[s].out_offset, URING_DEPTH + s, URING_DEPTH + s);
+                }
+                next_compute++;
+                progressed = 1;
+            }
+        }
+        if (progressed && ring.pending == 0) {
+            continue;
+        }
+        if (!progressed && ring.pending == 0 && (fn ? writes_done : next_compute) >= total_chunks) {
+            break;
+        }
+
+        struct io_uring_cqe cqe;
+        if (uring_wait(&ring, &cqe) < 0) {
+            printf("Error: io_uring wait failed (%s)\n", strerror(errno));
+            goto out;
+        }
+        int writing = cqe.user_data >= URING_DEPTH;
+        uring_slot_t *slot = &slots[cqe.user_data % URING_DEPTH];
+        if (cqe.res <= 0) {
+            printf("Error: io_uring %s failed (%s)\n", writing ? "write" : "read", strerror(-cqe.res));
+            goto out;
+        }
+
+        // Short transfers are resubmitted for the remainder
+        slot->done += cqe.res;
+        if (slot->done < slot->length) {
+            int b = cqe.user_data;
+            uint8_t *buf = (uint8_t *)iov[b].iov_base + slot->done;
+            long offset = writing ? slot->out_offset + slot->done : slot->chunk * chunk_in + slot->done;
+            long remaining = slot->length - slot->done;
+            uring_queue(&ring, writing ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED,
+                        writing ? out_fd : in_fd, buf, stats->direct ? uring_direct_length(remaining) : remaining,
+                        offset, b, b);
+        } else if (writing) {
+            slot->state = 0;
+            writes_done++;
+        } else {
+            slot->state = 2;
+        }
+    }
+
+    stats->seconds = uring_now() - start;
+    result = 0;
+
+out:
+    uring_exit(&ring);
+    for (int s = 0; s < 2 * URING_DEPTH; s++) {
+        free(iov[s].iov_base);
+    }
+    close(in_fd);
+    if (out_fd >= 0) close(out_fd);
+    return result;
+}
+
+void uring_report(const uring_stats_t *stats, const uring_stats_t *raw) {
+    double gb = 1e9;
+    printf("io_uring: %.3f GB in, %.3f GB out in %.3f s: %.2f GB/s (coding busy %.0f%% of the time)\n",
+           stats->bytes_in / gb, stats->bytes_out / gb, stats->seconds,
+           stats->seconds > 0 ? stats->bytes_in / gb / stats->seconds : 0.0,
+           stats->seconds > 0 ? 100.0 * stats->compute_seconds / stats->seconds : 0.0);
+    if (raw && raw->seconds > 0) {
+        printf("Raw read bandwidth of the input: %.2f GB/s (%s)\n", raw->bytes_in / gb / raw->seconds,
+               raw->direct ? "O_DIRECT, past the page cache"
+                           : "no O_DIRECT here: cached pages dropped first, but the file may still be cached");
+    }
+}
@@ -1 +1,127 @@
+/*
+ * Decoder regression tests. Build like the decoder and run from this
+ * directory; scratch files are written here and removed again:
+ *   gcc -O2 -mavx2 test.c && ./a.out
+ * Exit status is the number of failed checks.
+ */
+#define RS_DECODER_NO_MAIN
+#include "rs_decoding_binary.c"
 
+#define TEST_BLOCKS 6
+#define TEST_LOST 2         // Frame lost in noise, counted from 0
+
+static uint8_t test_generator[PARITY + 1];
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+/**
+ * Systematic RS(255,223) codeword with the encoder's generator polynomial
+ * and parity order
+ */
+static void test_encode_block(const uint8_t *data, uint8_t *codeword) {
+    uint8_t remainder[PARITY] = { 0 };
+
+    memcpy(codeword, data, K);
+    for (int i = 0; i < K; i++) {
+        uint8_t feedback = data[i] ^ remainder[PARITY - 1];
+        for (int j = PARITY - 1; j > 0; j--) {
+            remainder[j] = remainder[j - 1] ^ gf_mult(test_generator[j], feedback);
+        }
+        remainder[0] = gf_mult(test_generator[0], feedback);
+    }
+    for (int i = 0; i < PARITY; i++) {
+        codeword[K + i] = remainder[PARITY - 1 - i];
+    }
+}
+
+static void test_block_data(int block, uint8_t *data) {
+    // Never zero, so the last block loses no padding
+    for (int i = 0; i < K; i++) {
+        data[i] = (uint8_t)((block * K + i) * 7 % 251 + 1);
+    }
+}
+
+/*
+ * A --sync stream in which one whole frame, marker included, was lost in
+ * noise: the decoder must re-acquire on the next marker, write a zero
+ * placeholder block for the lost one so later blocks keep their offsets,
+ * and report the loss as a failed block.
+ */
+static void test_lost_frame(void) {
+    const char *input = "test_lost_frame.in", *output = "test_lost_frame.out";
+    uint8_t data[K], codeword[N], block[K];
+
+    FILE *fp = fopen(input, "wb");
+    if (!fp) {
+        check(0, "create the lost-frame input");
+        return;
+    }
+    srand(1);
+    for (int b = 0; b < TEST_BLOCKS; b++) {
+        if (b == TEST_LOST) {
+            for (int i = 0; i < ASM_SIZE + N; i++) {
+                fputc(rand() & 0xFF, fp);
+            }
+            continue;
+        }
+        test_block_data(b, data);
+        test_encode_block(data, codeword);
+        randomize(codeword, N);
+        fwrite(ASM, 1, ASM_SIZE, fp);
+        fwrite(codeword, 1, N, fp);
+    }
+    fclose(fp);
+
+    int result = decode_file(input, output, 0, 0, 1, 0);
+    check(result == 1, "a lost frame makes the decode report failed blocks");
+
+    fp = fopen(output, "rb");
+    if (!fp) {
+        check(0, "open the lost-frame output");
+        remove(input);
+        return;
+    }
+    fseek(fp, 0, SEEK_END);
+    check(ftell(fp) == (long)TEST_BLOCKS * K, "output keeps one block per frame sent");
+    int aligned = 1;
+    for (int b = 0; b < TEST_BLOCKS; b++) {
+        fseek(fp, (long)b * K, SEEK_SET);
+        if (fread(block, 1, K, fp) != K) {
+            aligned = 0;
+            break;
+        }
+        if (b == TEST_LOST) {
+            memset(data, 0, K);
+        } else {
+            test_block_data(b, data);
+        }
+        aligned &= memcmp(block, data, K) == 0;
+    }
+    fclose(fp);
+    check(aligned, "lost block is zero and later blocks are at their own offsets");
+
+    remove(input);
+    remove(output);
+}
+
+int main(void) {
+    init_galois_field();
+    init_randomizer();
+    test_generator[0] = 1;
+    for (int i = 0; i < PARITY; i++) {
+        uint8_t alpha_i = gf_pow(ALPHA, i);
+        for (int j = i + 1; j > 0; j--) {
+            test_generator[j] = test_generator[j - 1] ^ gf_mult(test_generator[j], alpha_i);
+        }
+        test_generator[0] = gf_mult(test_generator[0], alpha_i);
+    }
+
+    test_lost_frame();
+
+    printf("\n%d check(s) failed\n", failures);
+    return failures;
+}
@@ -2,6 +2,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <sys/wait.h>
+
+#include "frame_ring.c"
+#include "pcap_io.c"
+#include "trace.c"
+#include "metrics.c"
 
 #define AX25_FLAG 0x7E
 #define AX_25_CONTROL 0x03
@@ -9,6 +15,12 @@
 
 #define MAX_FILE_SIZE 10240
 #define MAX_PAYLOAD 256
+#define AX25_MAX_FRAME 512
+#define MAX_TEMPLATE_FIELDS 8
+#define KISS_DATA_FRAME 0x00   // KISS type byte: data frame on port 0
+#define AX25_MAX_DIGIS 8
+#define AX25_ADDR_H_BIT 0x80   // Via path: repeated by this digipeater (C bit in source / destination)
+#define AX25_ADDR_RESERVED 0x60
 
 typedef enum {
     BEACON_FRAME = 0,
@@ -19,14 +31,25 @@ typedef enum {
     FRAME_MESSAGE,
 } frame_type_t;
 
+typedef struct {
+    char call[8];
+    uint8_t ssid;
+    uint8_t flags;      // Top bits of the SSID byte: H (or C) and reserved bits
+} ax25_address_t;
+
 typedef struct {
     char source_call[8];
     char dest_call[8];
     uint8_t source;
     uint8_t dest;
+    // Frames built here leave these zero; received frames keep their C and reserved bits
+    uint8_t source_flags;
+    uint8_t dest_flags;
+    int digi_count;
+    ax25_address_t digis[AX25_MAX_DIGIS];   // Via path, first hop first
 } ax25_config_t;
 
-void encode_address(const char* call, uint8_t ssid, uint8_t* out, int last) {
+void encode_address(const char* call, uint8_t ssid, uint8_t flags, uint8_t* out, int last) {
     int call_len = strlen(call);
 
     for (int i = 0; i < 6; i++) {
@@ -36,14 +59,132 @@ void encode_address(const char* call, uint8_t ssid, uint8_t* out, int last) {
             out[i] = ' ' << 1;
         }
     }
-    out[6] = (ssid << 1) | (last ? 1 : 0);
+    out[6] = flags | (ssid << 1) | (last ? 1 : 0);
+}
+
+// Inverse of encode_address; returns the extension bit (1 for the last address)
+int decode_address(const uint8_t* in, char* call, uint8_t* ssid, uint8_t* flags) {
+    int length = 0;
+    for (int i = 0; i < 6; i++) {
+        char c = in[i] >> 1;
+        if (c != ' ') {
+            length = i + 1;
+        }
+        call[i] = c;
+    }
+    call[length] = '\0';
+    *ssid = (in[6] >> 1) & 0x0F;
+    *flags = in[6] & (AX25_ADDR_H_BIT | AX25_ADDR_RESERVED);
+    return in[6] & 1;
+}
+
+/*
+ * Addresses of a flag-delimited frame into 'config'. Returns the offset of
+ * the control field, or -1 if the address field is malformed or has more
+ * than AX25_MAX_DIGIS digipeaters.
+ */
+int ax25_parse_header(const uint8_t* frame, int length, ax25_config_t* config) {
+    int position = 1;
+
+    // Flag, destination, source, control, FCS, flag
+    if (length < 1 + 14 + 1 + 3) {
+        return -1;
+    }
+    int last = decode_address(frame + position, config->dest_call, &config->dest, &config->dest_flags);
+    position += 7;
+    if (last) {
+        return -1;
+    }
+    last = decode_address(frame + position, config->source_call, &config->source, &config->source_flags);
+    position += 7;
+
+    config->digi_count = 0;
+    while (!last) {
+        if (config->digi_count == AX25_MAX_DIGIS || position + 7 + 1 + 3 > length) {
+            return -1;
+        }
+        ax25_address_t* digi = &config->digis[config->digi_count++];
+        last = decode_address(frame + position, digi->call, &digi->ssid, &digi->flags);
+        position += 7;
+    }
+    return position;
+}
+
+// "CALL" or "CALL-SSID" into an address; returns 0 or -1 if it is not a callsign
+int parse_callsign(const char* text, ax25_address_t* address) {
+    int length = 0;
+
+    memset(address, 0, sizeof(*address));
+    while (text[length] && text[length] != '-') {
+        char c = text[length];
+        if (length == 6 || !((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))) {
+            return -1;
+        }
+        address->call[length++] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+    }
+    if (length == 0) {
+        return -1;
+    }
+    if (text[length] == '-') {
+        char* end;
+        long ssid = strtol(text + length + 1, &end, 10);
+        if (end == text + length + 1 || *end || ssid < 0 || ssid > 15) {
+            return -1;
+        }
+        address->ssid = ssid;
+    }
+    return 0;
+}
+
+// Slicing-by-8 tables: crc_table[k][b] is the CRC register after byte b
+// followed by k zero bytes, so eight input bytes cost eight lookups
+static uint16_t crc_table[8][256];
+static int crc_table_ready = 0;
+
+static void crc_init_table(void) {
+    for (int b = 0; b < 256; b++) {
+        uint16_t crc = b << 8;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+        crc_table[0][b] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int b = 0; b < 256; b++) {
+            uint16_t prev = crc_table[k - 1][b];
+            crc_table[k][b] = (prev << 8) ^ crc_table[0][prev >> 8];
+        }
+    }
+    crc_table_ready = 1;
+}
+
+// Table-driven CRC register update, same result as the bitwise loop
+uint16_t crc_update(uint16_t crc, const uint8_t* data, int length) {
+    if (!crc_table_ready) {
+        crc_init_table();
+    }
+
+    for (; length >= 8; data += 8, length -= 8) {
+        crc = crc_table[7][data[0] ^ (crc >> 8)] ^ crc_table[6][data[1] ^ (crc & 0xFF)] ^
+              crc_table[5][data[2]] ^ crc_table[4][data[3]] ^
+              crc_table[3][data[4]] ^ crc_table[2][data[5]] ^
+              crc_table[1][data[6]] ^ crc_table[0][data[7]];
+    }
+    while (length-- > 0) {
+        crc = (crc << 8) ^ crc_table[0][(crc >> 8) ^ *data++];
+    }
+    return crc;
 }
 
 uint16_t calculate_crc(uint8_t* data, int length) {
-    uint16_t crc = 0xFFFF;
+    return crc_update(0xFFFF, data, length) ^ 0xFFFF;
+}
 
-    for (int i = 0; i < length; i++) {
-        crc ^= data[i] << 8;
+// CRC without the initial value or final inversion; crc(a ^ b) = crc(a) ^ crc_linear(b)
+// for equal-length messages, which is what makes incremental FCS updates possible
+uint16_t crc_linear(uint16_t crc, const uint8_t* data, int length, int zero_bytes) {
+    for (int i = 0; i < length + zero_bytes; i++) {
+        crc ^= (i < length ? data[i] : 0) << 8;
         for (int j = 0; j < 8; j++) {
             if (crc & 0x8000) {
                 crc = (crc << 1) ^ 0x1021;
@@ -52,7 +193,7 @@ uint16_t calculate_crc(uint8_t* data, int length) {
             }
         }
     }
-    return crc ^ 0xFFFF;
+    return crc;
 }
 
 int frame_header(frame_type_t type, uint16_t sequence, uint16_t total, uint8_t* buffer) {
@@ -69,10 +210,16 @@ int frame_gen(const ax25_config_t* config, frame_type_t type, uint16_t sequence,
     
     // Opening flag
     frame_buffer[position++] = AX25_FLAG;
-    encode_address(config->dest_call, config->dest, &frame_buffer[position], 0);
+    encode_address(config->dest_call, config->dest, config->dest_flags, &frame_buffer[position], 0);
     position += 7;
-    encode_address(config->source_call, config->source, &frame_buffer[position], 1);
+    encode_address(config->source_call, config->source, config->source_flags, &frame_buffer[position],
+                   config->digi_count == 0);
     position += 7;
+    for (int i = 0; i < config->digi_count; i++) {
+        const ax25_address_t* digi = &config->digis[i];
+        encode_address(digi->call, digi->ssid, digi->flags, &frame_buffer[position], i == config->digi_count - 1);
+        position += 7;
+    }
 
     frame_buffer[position++] = AX_25_CONTROL;
     frame_buffer[position++] = PID_NoL3;
@@ -97,6 +244,9 @@ int frame_gen(const ax25_config_t* config, frame_type_t type, uint16_t sequence,
     return position;
 }
 
+// Output formats for finished frames: hex text, or a pcap / pcapng capture
+typedef void (*frame_writer_t)(FILE* output, const uint8_t* frame, int length, int packet_num);
+
 void write_frame_hex(FILE* output, const uint8_t* frame, int length, int packet_num) {
     fprintf(output, "Packet %d (%d bytes):\n", packet_num, length);
     for (int i = 0; i < length; i++) {
@@ -111,20 +261,407 @@ void write_frame_hex(FILE* output, const uint8_t* frame, int length, int packet_
     fprintf(output, "\n");
 }
 
+// LINKTYPE_AX25_KISS record: KISS type byte, then the frame without flags and FCS
+static void write_frame_kiss(FILE* output, pcap_format_t format, const uint8_t* frame, int length) {
+    static const uint8_t kiss = KISS_DATA_FRAME;
+    if (length >= 4) {
+        pcap_write_record(output, format, realtime_ns(), &kiss, 1, frame + 1, length - 4);
+    }
+}
+
+void write_frame_pcap(FILE* output, const uint8_t* frame, int length, int packet_num) {
+    (void)packet_num;
+    write_frame_kiss(output, PCAP_CLASSIC, frame, length);
+}
+
+void write_frame_pcapng(FILE* output, const uint8_t* frame, int length, int packet_num) {
+    (void)packet_num;
+    write_frame_kiss(output, PCAP_NG, frame, length);
+}
+
+// Rebuild the flag-delimited frame with its FCS from a KISS record; -1 if
+// the record is not a KISS data frame or the frame would not fit
+int ax25_frame_from_kiss(const uint8_t* record, int length, uint8_t* frame) {
+    if (length < 2 || (record[0] & 0x0F) != KISS_DATA_FRAME || length - 1 + 4 > AX25_MAX_FRAME) {
+        return -1;
+    }
+    int position = 0;
+    frame[position++] = AX25_FLAG;
+    memcpy(&frame[position], record + 1, length - 1);
+    position += length - 1;
+
+    uint16_t fcs = calculate_crc(&frame[1], position - 1);
+    frame[position++] = fcs & 0xFF;
+    frame[position++] = (fcs >> 8) & 0xFF;
+    frame[position++] = AX25_FLAG;
+    return position;
+}
+
+// Payload bytes that fit an AX25_MAX_FRAME buffer after flags, addresses, control, PID, header and FCS
+int frame_max_payload(const ax25_config_t* config, frame_type_t type) {
+    int overhead = 1 + 14 + 7 * config->digi_count + 2 + (type != FRAME_MESSAGE ? 5 : 0) + 2 + 1;
+    return AX25_MAX_FRAME - overhead;
+}
+
+// Both return -1 if the message does not fit a frame
 int create_beacon_frame(const ax25_config_t* config, const char* message, uint8_t* frame_buffer) {
-    return frame_gen(config, BEACON_FRAME, 0, 1, (uint8_t*)message, strlen(message), frame_buffer);
+    size_t length = strlen(message);
+    if (length > (size_t)frame_max_payload(config, BEACON_FRAME)) {
+        return -1;
+    }
+    return frame_gen(config, BEACON_FRAME, 0, 1, (uint8_t*)message, length, frame_buffer);
 }
 
 int create_message_frame(const ax25_config_t* config, const char* message, uint8_t* frame_buffer) {
-    return frame_gen(config, FRAME_MESSAGE, 0, 1, (uint8_t*)message, strlen(message), frame_buffer);
+    size_t length = strlen(message);
+    if (length > (size_t)frame_max_payload(config, FRAME_MESSAGE)) {
+        return -1;
+    }
+    return frame_gen(config, FRAME_MESSAGE, 0, 1, (uint8_t*)message, length, frame_buffer);
+}
+
+/*
+ * Frame template: an encoded frame plus, for each byte that is expected to
+ * change (sequence numbers, beacon counters, telemetry values), a table of
+ * its contribution to the FCS. Changing a field byte then costs one lookup
+ * instead of re-running calculate_crc over the whole frame.
+ */
+typedef struct {
+    uint8_t frame[AX25_MAX_FRAME];
+    int length;
+    int fcs_pos; // Offset of the FCS low byte
+    int field_count;
+    int field_pos[MAX_TEMPLATE_FIELDS];
+    uint16_t fcs_delta[MAX_TEMPLATE_FIELDS][256];
+} frame_template_t;
+
+int frame_template_init(frame_template_t* tmpl, const uint8_t* frame, int length,
+                        const int* positions, int count) {
+    if (length > AX25_MAX_FRAME || length < 4 || count > MAX_TEMPLATE_FIELDS) {
+        return -1;
+    }
+
+    memcpy(tmpl->frame, frame, length);
+    tmpl->length = length;
+    tmpl->fcs_pos = length - 3;
+    tmpl->field_count = count;
+
+    for (int f = 0; f < count; f++) {
+        int pos = positions[f];
+        if (pos < 1 || pos >= tmpl->fcs_pos) {
+            return -1;
+        }
+        tmpl->field_pos[f] = pos;
+
+        // Contribution of each bit, then every byte value by linearity
+        uint16_t bit_delta[8];
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t value = 1 << bit;
+            bit_delta[bit] = crc_linear(0, &value, 1, tmpl->fcs_pos - pos - 1);
+        }
+        for (int v = 0; v < 256; v++) {
+            uint16_t delta = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                if (v & (1 << bit)) {
+                    delta ^= bit_delta[bit];
+                }
+            }
+            tmpl->fcs_delta[f][v] = delta;
+        }
+    }
+    return 0;
+}
+
+// Change one field byte and patch the FCS; returns the FCS XOR delta
+uint16_t frame_template_set_byte(frame_template_t* tmpl, int field, uint8_t value) {
+    int pos = tmpl->field_pos[field];
+    uint16_t delta = tmpl->fcs_delta[field][tmpl->frame[pos] ^ value];
+
+    tmpl->frame[pos] = value;
+    tmpl->frame[tmpl->fcs_pos] ^= delta & 0xFF;
+    tmpl->frame[tmpl->fcs_pos + 1] ^= (delta >> 8) & 0xFF;
+    return delta;
+}
+
+// Beacon template whose two sequence bytes (from frame_header) are fields 0 and 1
+int create_beacon_template(const ax25_config_t* config, const char* message, frame_template_t* tmpl) {
+    uint8_t frame_buffer[AX25_MAX_FRAME];
+    int length = create_beacon_frame(config, message, frame_buffer);
+    if (length < 0) {
+        return -1;
+    }
+    int header_pos = 1 + 14 + 7 * config->digi_count + 2;
+    int sequence_pos[2] = { header_pos + 1, header_pos + 2 };
+
+    return frame_template_init(tmpl, frame_buffer, length, sequence_pos, 2);
+}
+
+void frame_template_set_sequence(frame_template_t* tmpl, uint16_t sequence) {
+    frame_template_set_byte(tmpl, 0, (sequence >> 8) & 0xFF);
+    frame_template_set_byte(tmpl, 1, sequence & 0xFF);
+}
+
+/*
+ * Frame buffer pool. Buffers are allocated once, cache-line aligned, and
+ * carry headroom in front of the frame so later stages (FX.25 tag, link
+ * headers) can be prepended in place and trailers (padding, RS parity)
+ * appended, without copying the frame between stage-local arrays.
+ */
+#define FRAME_POOL_ALIGN 64
+#define FRAME_POOL_HEADROOM 64
+#define FRAME_POOL_BUF_SIZE (FRAME_POOL_HEADROOM + AX25_MAX_FRAME)
+
+typedef struct frame_pool frame_pool_t;
+
+typedef struct frame_buf {
+    struct frame_buf* next_free;
+    frame_pool_t* pool;
+    int refcount;
+    int offset;       // Start of the frame within storage
+    int length;
+    uint64_t arrival_ns;  // When the frame came in, on its source's clock (0 if unknown)
+    uint8_t* storage;
+} frame_buf_t;
+
+struct frame_pool {
+    frame_buf_t* bufs;
+    frame_buf_t* free_list;
+    uint8_t* storage;
+    int count;
+    int in_use;
+};
+
+frame_pool_t* frame_pool_create(int count) {
+    frame_pool_t* pool = calloc(1, sizeof(frame_pool_t));
+    if (!pool) return NULL;
+
+    pool->bufs = calloc(count, sizeof(frame_buf_t));
+    pool->storage = aligned_alloc(FRAME_POOL_ALIGN, (size_t)count * FRAME_POOL_BUF_SIZE);
+    if (!pool->bufs || !pool->storage) {
+        free(pool->bufs);
+        free(pool->storage);
+        free(pool);
+        return NULL;
+    }
+
+    pool->count = count;
+    for (int i = count - 1; i >= 0; i--) {
+        pool->bufs[i].pool = pool;
+        pool->bufs[i].storage = pool->storage + (size_t)i * FRAME_POOL_BUF_SIZE;
+        pool->bufs[i].next_free = pool->free_list;
+        pool->free_list = &pool->bufs[i];
+    }
+    return pool;
+}
+
+void frame_pool_destroy(frame_pool_t* pool) {
+    if (pool) {
+        if (pool->in_use) {
+            printf("Warning: Frame pool destroyed with %d buffers in use\n", pool->in_use);
+        }
+        free(pool->bufs);
+        free(pool->storage);
+        free(pool);
+    }
+}
+
+frame_buf_t* frame_buf_alloc(frame_pool_t* pool) {
+    frame_buf_t* buf = pool->free_list;
+    if (!buf) return NULL;
+
+    pool->free_list = buf->next_free;
+    pool->in_use++;
+    buf->next_free = NULL;
+    buf->refcount = 1;
+    buf->offset = FRAME_POOL_HEADROOM;
+    buf->length = 0;
+    buf->arrival_ns = 0;
+    return buf;
+}
+
+void frame_buf_ref(frame_buf_t* buf) {
+    buf->refcount++;
+}
+
+void frame_buf_unref(frame_buf_t* buf) {
+    if (--buf->refcount == 0) {
+        buf->next_free = buf->pool->free_list;
+        buf->pool->free_list = buf;
+        buf->pool->in_use--;
+    }
+}
+
+uint8_t* frame_buf_data(const frame_buf_t* buf) {
+    return buf->storage + buf->offset;
+}
+
+// End of the frame, where the next stage may write up to frame_buf_tailroom() bytes
+uint8_t* frame_buf_tail(const frame_buf_t* buf) {
+    return buf->storage + buf->offset + buf->length;
+}
+
+int frame_buf_tailroom(const frame_buf_t* buf) {
+    return FRAME_POOL_BUF_SIZE - buf->offset - buf->length;
+}
+
+// Grow the frame by 'bytes' at the end; returns where they start, or NULL
+uint8_t* frame_buf_put(frame_buf_t* buf, int bytes) {
+    if (bytes > frame_buf_tailroom(buf)) return NULL;
+    uint8_t* tail = frame_buf_tail(buf);
+    buf->length += bytes;
+    return tail;
+}
+
+// Grow the frame by 'bytes' at the front, into the headroom
+uint8_t* frame_buf_push(frame_buf_t* buf, int bytes) {
+    if (bytes > buf->offset) return NULL;
+    buf->offset -= bytes;
+    buf->length += bytes;
+    return frame_buf_data(buf);
+}
+
+/*
+ * FCS repair. A bit error at distance p from the end of the FCS (p < 16
+ * inside the FCS itself) changes the CRC by x^p mod G, so the syndrome
+ * (computed FCS ^ received FCS) of a single-bit error names its position
+ * through one table lookup. Two-bit errors are found by checking, for each
+ * first position, whether the remaining syndrome is a single-bit one.
+ */
+#define CRC_REPAIR_BITS (AX25_MAX_FRAME * 8)
+
+typedef enum {
+    REPAIR_NONE = 0,
+    REPAIR_SINGLE,      // Fix one flipped bit
+    REPAIR_DOUBLE,      // Also fix two flipped bits when the pair is unique
+} repair_level_t;
+
+typedef struct {
+    repair_level_t level;
+    int max_double_bits;   // Longest frame (bits) for two-bit repair; random syndromes
+                           // match some pair once frames reach a few hundred bits
+    int check_header;      // Reject repairs that leave an implausible address field
+} crc_repair_policy_t;
+
+static const crc_repair_policy_t CRC_REPAIR_DEFAULT = { REPAIR_SINGLE, 256, 1 };
+
+static uint16_t crc_syndrome_pos[65536];   // Syndrome -> bit distance + 1, 0 if none
+static uint16_t crc_syndrome_of[CRC_REPAIR_BITS + 16];
+static int crc_syndrome_ready = 0;
+
+static void crc_init_syndromes(void) {
+    uint16_t syndrome = 1;
+    for (int p = 0; p < CRC_REPAIR_BITS + 16; p++) {
+        crc_syndrome_of[p] = syndrome;
+        crc_syndrome_pos[syndrome] = p + 1;
+        syndrome = (syndrome & 0x8000) ? (syndrome << 1) ^ 0x1021 : syndrome << 1;
+    }
+    crc_syndrome_ready = 1;
+}
+
+// Flip the bit at distance p from the end of the FCS; body ends with the FCS
+static void crc_flip_bit(uint8_t* body, int length, int p) {
+    if (p < 16) {
+        body[length - 2 + p / 8] ^= 1 << (p % 8);   // FCS is sent low byte first
+    } else {
+        int d = p - 16;
+        body[length - 3 - d / 8] ^= 1 << (d % 8);
+    }
+}
+
+static int ax25_header_plausible(const uint8_t* body, int length) {
+    for (int i = 0; i < length; i++) {
+        int in_call = (i % 7) != 6;
+        if (in_call) {
+            char c = body[i] >> 1;
+            if ((body[i] & 1) || !((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == ' ')) {
+                return 0;
+            }
+        } else if (body[i] & 1) {
+            return i >= 13;   // Address field ends after destination and source
+        }
+    }
+    return 0;
+}
+
+/*
+ * Try to repair a flag-delimited frame whose FCS does not check. Returns
+ * the number of bits flipped (0 if the FCS was already good) or -1 if the
+ * policy does not allow a repair; on -1 the frame is left unchanged.
+ */
+int ax25_repair_frame(uint8_t* frame, int length, const crc_repair_policy_t* policy) {
+    uint8_t* body = frame + 1;
+    int body_len = length - 2;
+    int bits = body_len * 8;
+
+    if (!policy) {
+        policy = &CRC_REPAIR_DEFAULT;
+    }
+    if (body_len < 3 || bits > CRC_REPAIR_BITS + 16) {
+        return -1;
+    }
+    if (!crc_syndrome_ready) {
+        crc_init_syndromes();
+    }
+
+    uint16_t fcs = calculate_crc(body, body_len - 2);
+    uint16_t syndrome = fcs ^ (body[body_len - 2] | (body[body_len - 1] << 8));
+    if (syndrome == 0) {
+        return 0;
+    }
+    if (policy->level == REPAIR_NONE) {
+        return -1;
+    }
+
+    int flipped = 0, first = -1, second = -1;
+    int p = crc_syndrome_pos[syndrome] - 1;
+    if (p >= 0 && p < bits) {
+        first = p;
+        flipped = 1;
+    } else if (policy->level >= REPAIR_DOUBLE && bits <= policy->max_double_bits) {
+        for (int a = 0; a < bits; a++) {
+            int b = crc_syndrome_pos[syndrome ^ crc_syndrome_of[a]] - 1;
+            if (b > a && b < bits) {
+                if (flipped) {
+                    return -1;   // More than one pair explains the syndrome
+                }
+                first = a;
+                second = b;
+                flipped = 2;
+            }
+        }
+    }
+    if (!flipped) {
+        return -1;
+    }
+
+    crc_flip_bit(body, body_len, first);
+    if (second >= 0) {
+        crc_flip_bit(body, body_len, second);
+    }
+    if (policy->check_header && !ax25_header_plausible(body, body_len - 2)) {
+        crc_flip_bit(body, body_len, first);
+        if (second >= 0) {
+            crc_flip_bit(body, body_len, second);
+        }
+        return -1;
+    }
+    return flipped;
 }
 
-int packetization(const ax25_config_t* config, const uint8_t* data, int data_length, FILE* output) {
+// Frames go to 'ring' when given, otherwise through 'writer' to 'output'
+int packetization(const ax25_config_t* config, const uint8_t* data, int data_length, FILE* output,
+                  frame_writer_t writer, frame_ring_t* ring) {
     int total_packets = (data_length + MAX_PAYLOAD - 1) / MAX_PAYLOAD;
     printf("Packetizing %d bytes into %d frames\n", data_length, total_packets);
+
+    frame_pool_t* pool = frame_pool_create(1);
+    if (!pool) {
+        printf("Error: Cannot allocate frame buffers\n");
+        return 0;
+    }
     
     for (int packet = 0; packet < total_packets; packet++) {
-        uint8_t frame_buffer[512];
+        frame_buf_t* buf = frame_buf_alloc(pool);
         int data_offset = packet * MAX_PAYLOAD;
         int chunk_size = (data_offset + MAX_PAYLOAD > data_length) ? 
                          (data_length - data_offset) : MAX_PAYLOAD;
@@ -141,23 +678,120 @@ int packetization(const ax25_config_t* config, const uint8_t* data, int data_len
             frame_type = FRAME_DATA;
         }
         
-        // Generate frame
+        // Generate frame straight into the pool buffer
+        trace_begin(TRACE_FRAME, packet);
+        trace_begin(TRACE_FRAME_BUILD, packet);
         int frame_length = frame_gen(config, frame_type, packet, total_packets,
-                                   data + data_offset, chunk_size, frame_buffer);
+                                   data + data_offset, chunk_size, frame_buf_tail(buf));
+        frame_buf_put(buf, frame_length);
+        trace_end(TRACE_FRAME_BUILD, packet);
+        metrics_add(METRIC_FRAMES_BUILT, 1);
         
-        write_frame_hex(output, frame_buffer, frame_length, packet);
+        if (ring) {
+            if (frame_ring_send(ring, frame_buf_data(buf), buf->length, FRAME_RING_TIMEOUT_MS) != 0) {
+                // The consumer stopped taking frames: count the rest as dropped
+                atomic_fetch_add(&ring->shm->dropped, total_packets - packet);
+                printf("Warning: Consumer took no frame for %d ms, dropping the last %d frames\n",
+                       FRAME_RING_TIMEOUT_MS, total_packets - packet);
+                trace_end(TRACE_FRAME, packet);
+                frame_buf_unref(buf);
+                total_packets = packet;
+                break;
+            }
+            metrics_set(METRIC_QUEUE_FRAME_RING,
+                        atomic_load(&ring->shm->sent) - atomic_load(&ring->shm->received));
+        } else {
+            writer(output, frame_buf_data(buf), buf->length, packet);
+        }
+        trace_end(TRACE_FRAME, packet);
+        frame_buf_unref(buf);
     }
-    
+
+    frame_pool_destroy(pool);
     return total_packets;
 }
 
-int main() {
+#ifndef AX25_NO_MAIN
+#define RING_SLOTS 64
+
+// Start the consumer with the ring inherited as "--ring-fd N"
+static pid_t spawn_ring_consumer(frame_ring_t* ring, int argc, char* argv[]) {
+    char fd_arg[16];
+    char** args = calloc(argc + 3, sizeof(char*));
+    if (!args) return -1;
+
+    snprintf(fd_arg, sizeof(fd_arg), "%d", ring->fd);
+    for (int i = 0; i < argc; i++) {
+        args[i] = argv[i];
+    }
+    args[argc] = "--ring-fd";
+    args[argc + 1] = fd_arg;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(args[0], args);
+        printf("Error: Cannot start %s\n", args[0]);
+        _exit(127);
+    }
+    free(args);
+    return pid;
+}
+
+int main(int argc, char* argv[]) {
     ax25_config_t config = {
         .source_call = "N0CALL",
         .dest_call = "CQ",
         .source = 0,
         .dest = 0,
     };
+    frame_ring_t ring = { 0 };
+    pid_t consumer = 0;
+    const char* output_name = "packets.txt";
+    frame_writer_t writer = write_frame_hex;
+    const char* trace_file = NULL;
+    int latency = 0;
+    const char* metrics_address = NULL;
+
+    // Usage: [--pcap FILE | --pcapng FILE] [--trace FILE] [--latency] [--metrics PORT|IP:PORT|unix:PATH]
+    //        [--via CALL[-SSID],...] [--ring CONSUMER [ARGS...]]
+    //   --pcap / --pcapng write the frames as a LINKTYPE_AX25_KISS capture instead of packets.txt
+    //   --via sends the frames through digipeaters, e.g. --via WIDE1-1,WIDE2-1
+    //   --trace writes the pipeline trace events to FILE, --latency prints the stage latencies
+    //   --metrics serves Prometheus metrics at /metrics while the frames are generated
+    //   --ring hands frames to CONSUMER over shared memory
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            latency = 1;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_address = argv[++i];
+        } else if (strcmp(argv[i], "--via") == 0 && i + 1 < argc) {
+            char path[128];
+            snprintf(path, sizeof(path), "%s", argv[++i]);
+            config.digi_count = 0;
+            for (char* hop = strtok(path, ","); hop; hop = strtok(NULL, ",")) {
+                if (config.digi_count == AX25_MAX_DIGIS || parse_callsign(hop, &config.digis[config.digi_count]) < 0) {
+                    printf("Error: Invalid via path %s\n", argv[i]);
+                    return 1;
+                }
+                config.digi_count++;
+            }
+        } else if ((strcmp(argv[i], "--pcap") == 0 || strcmp(argv[i], "--pcapng") == 0) && i + 1 < argc) {
+            writer = (strcmp(argv[i], "--pcap") == 0) ? write_frame_pcap : write_frame_pcapng;
+            output_name = argv[++i];
+        } else if (strcmp(argv[i], "--ring") == 0 && i + 1 < argc) {
+            if (frame_ring_create(&ring, RING_SLOTS) < 0) {
+                return 1;
+            }
+            consumer = spawn_ring_consumer(&ring, argc - i - 1, argv + i + 1);
+            if (consumer < 0) {
+                printf("Error: Cannot start ring consumer\n");
+                return 1;
+            }
+            break;
+        }
+    }
 
     printf("Generating AX.25 Frames\n");
 
@@ -178,24 +812,56 @@ int main() {
     }
     
     printf("Read %d bytes from input.txt\n", data_length);
+
+    if (trace_start(trace_file) < 0 || (metrics_address && metrics_start(metrics_address) < 0)) {
+        return 1;
+    }
+    if (ring.shm) {
+        fflush(stdout);
+        int packets = packetization(&config, data_buffer, data_length, NULL, NULL, &ring);
+        frame_ring_close(&ring);
+        metrics_stop();
+        trace_stop(latency);
+
+        int status = 0;
+        waitpid(consumer, &status, 0);
+        printf("Handed %d packet frames to the consumer\n", packets);
+        frame_ring_report(&ring);
+        frame_ring_detach(&ring);
+        return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : 1;
+    }
     
     // Open output file
-    FILE* output_file = fopen("packets.txt", "w");
+    FILE* output_file;
+    if (writer == write_frame_hex) {
+        output_file = fopen(output_name, "w");
+        if (!output_file) {
+            printf("Error: Cannot create %s\n", output_name);
+        }
+    } else {
+        output_file = pcap_create(output_name, writer == write_frame_pcap ? PCAP_CLASSIC : PCAP_NG,
+                                  LINKTYPE_AX25_KISS);
+    }
     if (!output_file) {
-        printf("Error: Cannot create packets.txt\n");
         return 1;
     }
 
-    int packets = packetization(&config, data_buffer, data_length, output_file);
-    fclose(output_file);
+    int packets = packetization(&config, data_buffer, data_length, output_file, writer, NULL);
+    metrics_stop();
+    trace_stop(latency);
+    if (fclose(output_file) != 0) {
+        printf("Error: Cannot write %s\n", output_name);
+        return 1;
+    }
     
     if (packets > 0) {
         printf("Successfully created %d packet frames\n", packets);
-        printf("Results written to packets.txt\n");
+        printf("Results written to %s\n", output_name);
     } else {
         printf("Error occurred during packetization\n");
         return 1;
     }
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -1,4 +1,69 @@
 gcc ax25_packet.c
 ./a.out
 gcc fx25_packet.c -lfec
-./a.out
\ No newline at end of file
+./a.out
+# IL2P framing instead of FX.25 (writes il2p_packets.txt)
+# ./a.out --mode il2p
+
+# Numbered beacons via incremental FCS/parity templates
+# ./a.out --beacons 10 "Beacon text"
+
+# Pack several AX.25 frames per FX.25 codeblock (a block waits at most 100 ms
+# for more frames; replay goes by the capture timestamps)
+# ./a.out --aggregate
+
+# Repair input frames with a bit error or two in the FCS, drop the rest of
+# the bad ones, before encoding
+# ./a.out --fcs-check
+
+# Send frames in bursts of up to 5 s per key-up
+# ./a.out --burst 5000
+
+# First HARQ transmission of each frame (data + 16 check bytes) instead of FX.25
+# ./a.out --harq
+
+# Hand frames from the AX.25 generator to the FX.25 encoder over a
+# shared-memory ring instead of packets.txt (both built as above)
+# gcc ax25_packet.c -o ax25_packet && gcc fx25_packet.c -lfec -o fx25_packet
+# ./ax25_packet --ring ./fx25_packet
+
+# Frames as pcap / pcapng captures (LINKTYPE_AX25_KISS for AX.25, USER0 for
+# FX.25, USER1 for IL2P, USER2 for HARQ segments) instead of hex text, for
+# Wireshark and replay
+# ./ax25_packet --pcapng ax25.pcapng
+# ./fx25_packet --pcap-in ax25.pcapng --pcapng fx25.pcapng
+# Replay a capture through the encoder or decoder, flat out or at recorded timing
+# ./fx25_packet --replay capture.pcap --loops 100
+# ./fx25_packet --replay fx25.pcapng --realtime --pcap decoded.pcap
+# ./fx25_packet --replay ax25.pcapng --aggregate --pcapng fx25.pcapng
+# Combine repeated copies of FX.25 frames that do not decode on their own
+# ./fx25_packet --replay fx25.pcapng --combine --pcap decoded.pcap
+# Pick the FX.25 strength per destination from how its frames decoded
+# (a capture mixing FX.25 frames heard and AX.25 frames to send)
+# ./fx25_packet --replay link.pcapng --adaptive
+
+# Hybrid ARQ: first transmissions (data + 16 check bytes) as a capture, and a
+# simulated link at 10% byte errors that sends more check bytes on request
+# ./fx25_packet --pcap-in ax25.pcapng --harq --pcapng harq.pcapng
+# ./fx25_packet --replay ax25.pcapng --harq-link 10 --pcapng received.pcapng
+# ./fx25_packet --replay received.pcapng --pcap decoded.pcap
+
+# Per-stage throughput of the whole pipeline over beacon, message, bulk and
+# mixed traffic, with IPC and miss counts where hardware counters exist
+# gcc -O2 pipeline_bench.c -lfec -o pipeline_bench && ./pipeline_bench --frames 4096
+
+# Stage latencies (p50 .. p99.9) from the always-on trace, and the raw trace
+# events (trace.c: trace_file_header_t, then 16-byte trace_event_t records)
+# ./fx25_packet --replay capture.pcap --loops 100 --latency --trace fx25.trace
+
+# Prometheus metrics (frame and RS block counters, corrected-symbol histogram,
+# stage time, queue depths) at http://127.0.0.1:9109/metrics while running
+# ./fx25_packet --replay fx25.pcapng --loops 1000 --metrics 9109
+
+# Digipeat the frames heard in a capture (WIDEn-N paths, aliases, duplicates
+# suppressed for --dedupe-ms) and write what would be transmitted
+# ./ax25_packet --via WIDE1-1,WIDE2-1 --pcap heard.pcap
+# ./fx25_packet --digipeat N0DIG-1 --alias WIDE1-1 --replay heard.pcap --pcap repeated.pcap
+
+# Regression tests (exit status is the number of failed checks)
+# gcc test.c -lfec -o fx25_test && ./fx25_test
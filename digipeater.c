@@ -0,0 +1,249 @@
+// AX.25 digipeater with duplicate suppression (included by fx25_packet.c)
+//
+// digipeat() takes a received frame, checks its via path the way APRS
+// digipeaters do and, if this station should repeat it, rebuilds it with
+// the path updated. The next unused hop (the first without its H bit) is
+// repeated when it is
+//   - our own call: its H bit is set
+//   - one of our aliases (WIDE1-1, RELAY, ...): replaced by our call, H set
+//   - a New-N hop such as WIDE2-2 with n <= max_hops: N counts down, our call
+//     is inserted in front of it (room permitting), and the hop is used up at 0
+// Frames we sent ourselves, or that already went through us, are not repeated.
+//
+// Busy channels carry the same packet via several digipeaters, so a frame
+// is only repeated if its digest (everything but the via path) was not seen
+// within the dedupe window. The cache splits the window into DEDUPE_BUCKETS
+// time buckets, each a fixed open-addressed table of digests: a lookup
+// probes a few slots per bucket, a bucket whose time has passed is reused
+// wholesale, and nothing is allocated after digi_init().
+
+#define DIGI_MAX_ALIASES 8
+#define DIGI_DEFAULT_DEDUPE_MS 30000
+#define DIGI_DEFAULT_MAX_HOPS 2
+#define DEDUPE_BUCKETS 8
+#define DEDUPE_SLOTS 16384              // Per bucket, a power of two
+#define DEDUPE_PROBES 8
+
+typedef struct {
+    uint64_t digest[DEDUPE_SLOTS];      // 0: empty
+    uint64_t epoch;                     // Bucket number (time / bucket_ns) the entries belong to
+} dedupe_bucket_t;
+
+typedef struct {
+    dedupe_bucket_t buckets[DEDUPE_BUCKETS];
+    uint64_t bucket_ns;
+    unsigned long evicted;              // Digests overwritten because their probe run was full
+} dedupe_cache_t;
+
+typedef enum {
+    DIGI_REPEAT = 0,
+    DIGI_NOT_FOR_US,                    // Path done, or the next hop is another station's
+    DIGI_DUPLICATE,
+    DIGI_INVALID,                       // Not an AX.25 frame we can parse or rebuild
+} digi_result_t;
+
+typedef struct {
+    ax25_address_t self;
+    ax25_address_t aliases[DIGI_MAX_ALIASES];
+    int alias_count;
+    char wide[8];                       // New-N alias ("WIDE"), empty to disable
+    int max_hops;
+    dedupe_cache_t* dedupe;
+    unsigned long results[DIGI_INVALID + 1];
+} digipeater_t;
+
+// The window is covered by all buckets but one, so it is always at least dedupe_ms
+void dedupe_init(dedupe_cache_t* cache, long dedupe_ms) {
+    memset(cache, 0, sizeof(*cache));
+    cache->bucket_ns = (uint64_t)dedupe_ms * 1000000ull / (DEDUPE_BUCKETS - 1);
+    if (cache->bucket_ns == 0) {
+        cache->bucket_ns = 1;
+    }
+    for (int b = 0; b < DEDUPE_BUCKETS; b++) {
+        cache->buckets[b].epoch = UINT64_MAX;
+    }
+}
+
+/*
+ * Seen 'digest' within the window before 'now_ns'? If not, it is recorded
+ * at 'now_ns' and 0 is returned.
+ */
+int dedupe_check(dedupe_cache_t* cache, uint64_t digest, uint64_t now_ns) {
+    uint64_t epoch = now_ns / cache->bucket_ns;
+    uint32_t home = digest & (DEDUPE_SLOTS - 1);
+
+    for (int age = 0; age < DEDUPE_BUCKETS && (uint64_t)age <= epoch; age++) {
+        const dedupe_bucket_t* bucket = &cache->buckets[(epoch - age) % DEDUPE_BUCKETS];
+        if (bucket->epoch != epoch - age) {
+            continue;
+        }
+        for (int p = 0; p < DEDUPE_PROBES; p++) {
+            uint64_t slot = bucket->digest[(home + p) & (DEDUPE_SLOTS - 1)];
+            if (slot == digest) {
+                return 1;
+            }
+            if (slot == 0) {
+                break;
+            }
+        }
+    }
+
+    dedupe_bucket_t* current = &cache->buckets[epoch % DEDUPE_BUCKETS];
+    if (current->epoch != epoch) {
+        // Its time has passed: everything in it is older than the window
+        memset(current->digest, 0, sizeof(current->digest));
+        current->epoch = epoch;
+    }
+    for (int p = 0; p < DEDUPE_PROBES; p++) {
+        uint64_t* slot = &current->digest[(home + p) & (DEDUPE_SLOTS - 1)];
+        if (*slot == 0) {
+            *slot = digest;
+            return 0;
+        }
+    }
+    current->digest[home] = digest;
+    cache->evicted++;
+    return 0;
+}
+
+/*
+ * FNV-1a over what identifies a packet: destination and source (SSID bits
+ * only) and everything after the address field. The via path is left out,
+ * as it changes at every hop.
+ */
+static uint64_t digi_digest(const uint8_t* frame, int control_pos, int length) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int i = 1; i < 15; i++) {
+        uint8_t byte = (i == 7 || i == 14) ? frame[i] & 0x1E : frame[i];
+        hash = (hash ^ byte) * 0x100000001B3ull;
+    }
+    for (int i = control_pos; i < length - 3; i++) {
+        hash = (hash ^ frame[i]) * 0x100000001B3ull;
+    }
+    return hash ? hash : 1;
+}
+
+static int address_equal(const ax25_address_t* a, const ax25_address_t* b) {
+    return a->ssid == b->ssid && strcmp(a->call, b->call) == 0;
+}
+
+// New-N hop: wide prefix, one digit n, SSID N; returns n or 0
+static int digi_wide_hops(const digipeater_t* digi, const ax25_address_t* hop) {
+    int length = strlen(digi->wide);
+    if (length == 0 || strncmp(hop->call, digi->wide, length) != 0 || strlen(hop->call) != (size_t)length + 1) {
+        return 0;
+    }
+    int n = hop->call[length] - '0';
+    return (n >= 1 && n <= 7) ? n : 0;
+}
+
+int digi_init(digipeater_t* digi, const ax25_address_t* self, long dedupe_ms) {
+    memset(digi, 0, sizeof(*digi));
+    digi->self = *self;
+    strcpy(digi->wide, "WIDE");
+    digi->max_hops = DIGI_DEFAULT_MAX_HOPS;
+    digi->dedupe = malloc(sizeof(dedupe_cache_t));
+    if (!digi->dedupe) {
+        return -1;
+    }
+    dedupe_init(digi->dedupe, dedupe_ms);
+    return 0;
+}
+
+void digi_free(digipeater_t* digi) {
+    free(digi->dedupe);
+    digi->dedupe = NULL;
+}
+
+int digi_add_alias(digipeater_t* digi, const ax25_address_t* alias) {
+    if (digi->alias_count == DIGI_MAX_ALIASES) {
+        return -1;
+    }
+    digi->aliases[digi->alias_count++] = *alias;
+    return 0;
+}
+
+/*
+ * Decide on a received flag-delimited frame heard at 'now_ns'. On
+ * DIGI_REPEAT the frame to send is in 'out' and its length in 'out_len'.
+ */
+digi_result_t digipeat(digipeater_t* digi, const uint8_t* frame, int length, uint64_t now_ns,
+                       uint8_t* out, int* out_len) {
+    ax25_config_t path;
+
+    // The path may gain our call: 7 more bytes
+    int control_pos = ax25_parse_header(frame, length, &path);
+    if (control_pos < 0 || length + 7 > AX25_MAX_FRAME) {
+        digi->results[DIGI_INVALID]++;
+        return DIGI_INVALID;
+    }
+
+    int next = 0;
+    while (next < path.digi_count && (path.digis[next].flags & AX25_ADDR_H_BIT)) {
+        next++;
+    }
+    ax25_address_t source = { .ssid = path.source };
+    strcpy(source.call, path.source_call);
+    int looped = address_equal(&source, &digi->self);
+    for (int d = 0; !looped && d < next; d++) {
+        looped = address_equal(&path.digis[d], &digi->self);
+    }
+    // Path used up, our own frame, or one we already repeated coming back
+    if (next == path.digi_count || looped) {
+        digi->results[DIGI_NOT_FOR_US]++;
+        return DIGI_NOT_FOR_US;
+    }
+
+    ax25_address_t* hop = &path.digis[next];
+    int alias = address_equal(hop, &digi->self);
+    for (int a = 0; !alias && a < digi->alias_count; a++) {
+        alias = address_equal(hop, &digi->aliases[a]);
+    }
+    int hops = alias ? 0 : digi_wide_hops(digi, hop);
+    if (!alias && (hops == 0 || hops > digi->max_hops || hop->ssid == 0 || hop->ssid > hops)) {
+        digi->results[DIGI_NOT_FOR_US]++;
+        return DIGI_NOT_FOR_US;
+    }
+
+    if (dedupe_check(digi->dedupe, digi_digest(frame, control_pos, length), now_ns)) {
+        digi->results[DIGI_DUPLICATE]++;
+        return DIGI_DUPLICATE;
+    }
+
+    uint8_t flags = hop->flags;
+    if (alias) {
+        *hop = digi->self;
+        hop->flags = flags | AX25_ADDR_H_BIT;
+    } else {
+        // New-N: count the hop down and record ourselves in front of it
+        if (--hop->ssid == 0) {
+            hop->flags |= AX25_ADDR_H_BIT;
+        }
+        if (path.digi_count < AX25_MAX_DIGIS) {
+            memmove(hop + 1, hop, (path.digi_count - next) * sizeof(*hop));
+            path.digi_count++;
+            *hop = digi->self;
+            hop->flags = flags | AX25_ADDR_H_BIT;
+        }
+    }
+
+    int info_len = length - 3 - (control_pos + 2);
+    if (info_len >= 0 && frame[control_pos] == AX_25_CONTROL && frame[control_pos + 1] == PID_NoL3) {
+        // UI frame without layer 3, as APRS sends: frame_gen rebuilds it exactly
+        *out_len = frame_gen(&path, FRAME_MESSAGE, 0, 0, frame + control_pos + 2, info_len, out);
+    } else {
+        // Anything else keeps its control field and PID: new address field, same rest, new FCS
+        int position = 1 + 14 + 7 * path.digi_count;
+        int rest = length - 3 - control_pos;
+        frame_gen(&path, FRAME_MESSAGE, 0, 0, NULL, 0, out);
+        memcpy(out + position, frame + control_pos, rest);
+        position += rest;
+        uint16_t fcs = calculate_crc(out + 1, position - 1);
+        out[position++] = fcs & 0xFF;
+        out[position++] = (fcs >> 8) & 0xFF;
+        out[position++] = AX25_FLAG;
+        *out_len = position;
+    }
+    digi->results[DIGI_REPEAT]++;
+    return DIGI_REPEAT;
+}
@@ -0,0 +1,315 @@
+// Shared-memory frame ring between processes (included by ax25_packet.c)
+//
+// The ring lives in a memfd that the creating process passes to its peers
+// by inheritance (see --ring in ax25_packet.c and --ring-fd in
+// fx25_packet.c). Slots follow the bounded-queue scheme where each slot
+// carries a sequence number, so any number of producers can claim slots
+// with one compare-and-swap while a single consumer drains them in order.
+// Waiting on a full or empty ring uses futexes on shared counters, so an
+// idle process sleeps in the kernel instead of spinning. Waits are bounded:
+// a peer that makes no progress for the timeout (it crashed, or hangs) is
+// given up on instead of blocking this side forever.
+
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define FRAME_RING_MAGIC 0x46524E47u   // "FRNG"
+#define FRAME_RING_SLOT_DATA 512
+#define FRAME_RING_SPIN 64             // Polls before sleeping on the futex
+#define FRAME_RING_TIMEOUT_MS 5000     // Default wait for a peer to make room or send
+
+typedef struct {
+    _Atomic uint64_t sequence;         // Slot is free for position p when == p, full when == p + 1
+    uint32_t length;
+    uint32_t reserved;
+    uint64_t sent_ns;                  // CLOCK_MONOTONIC at send, for latency
+    uint8_t data[FRAME_RING_SLOT_DATA];
+} frame_ring_slot_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;                 // Slots, a power of two
+    _Atomic uint32_t closed;           // Producers are done
+
+    // Futex words: bumped when a frame is published / a slot is freed
+    _Atomic uint32_t data_seq;
+    _Atomic uint32_t space_seq;
+    _Atomic uint32_t data_waiters;
+    _Atomic uint32_t space_waiters;
+
+    _Alignas(64) _Atomic uint64_t head; // Next position to claim (producers)
+    _Alignas(64) _Atomic uint64_t tail; // Next position to read (consumer)
+
+    // Counters, readable by any attached process
+    _Alignas(64) _Atomic uint64_t sent;
+    _Atomic uint64_t received;
+    _Atomic uint64_t full_waits;       // Producer found the ring full (backpressure)
+    _Atomic uint64_t empty_waits;      // Consumer found the ring empty
+    _Atomic uint64_t dropped;          // Frames given up on: ring full past the timeout, or not taken
+    _Atomic uint64_t latency_total_ns;
+    _Atomic uint64_t latency_max_ns;
+
+    _Alignas(64) frame_ring_slot_t slots[];
+} frame_ring_shm_t;
+
+typedef struct {
+    int fd;
+    size_t size;
+    frame_ring_shm_t* shm;
+} frame_ring_t;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Sleep until woken or 'deadline_ns' (0: no limit); returns 0 once the deadline has passed
+static int futex_wait(_Atomic uint32_t* word, uint32_t expected, uint64_t deadline_ns) {
+    struct timespec timeout, *limit = NULL;
+    if (deadline_ns) {
+        uint64_t now = monotonic_ns();
+        if (now >= deadline_ns) {
+            return 0;
+        }
+        timeout.tv_sec = (deadline_ns - now) / 1000000000ull;
+        timeout.tv_nsec = (deadline_ns - now) % 1000000000ull;
+        limit = &timeout;
+    }
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, limit, NULL, 0);
+    return 1;
+}
+
+static uint64_t frame_ring_deadline(int timeout_ms) {
+    return timeout_ms < 0 ? 0 : monotonic_ns() + (uint64_t)timeout_ms * 1000000ull;
+}
+
+static void futex_wake(_Atomic uint32_t* word) {
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+static size_t frame_ring_bytes(uint32_t capacity) {
+    return sizeof(frame_ring_shm_t) + (size_t)capacity * sizeof(frame_ring_slot_t);
+}
+
+static int frame_ring_map(frame_ring_t* ring, int fd, size_t size) {
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    ring->fd = fd;
+    ring->size = size;
+    ring->shm = base;
+    return 0;
+}
+
+// Create a ring of 'capacity' slots (rounded up to a power of two)
+int frame_ring_create(frame_ring_t* ring, uint32_t capacity) {
+    uint32_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    int fd = syscall(SYS_memfd_create, "frame_ring", 0);
+    if (fd < 0) {
+        printf("Error: memfd_create failed (%s)\n", strerror(errno));
+        return -1;
+    }
+    size_t size = frame_ring_bytes(slots);
+    if (ftruncate(fd, size) < 0 || frame_ring_map(ring, fd, size) < 0) {
+        printf("Error: Cannot map frame ring (%s)\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    frame_ring_shm_t* shm = ring->shm;
+    shm->capacity = slots;
+    for (uint32_t i = 0; i < slots; i++) {
+        atomic_init(&shm->slots[i].sequence, i);
+    }
+    atomic_thread_fence(memory_order_release);
+    shm->magic = FRAME_RING_MAGIC;
+    return 0;
+}
+
+// Attach to a ring created by another process and inherited as 'fd'
+int frame_ring_attach(frame_ring_t* ring, int fd) {
+    frame_ring_shm_t header;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || header.magic != FRAME_RING_MAGIC) {
+        printf("Error: fd %d is not a frame ring\n", fd);
+        return -1;
+    }
+    if (frame_ring_map(ring, fd, frame_ring_bytes(header.capacity)) < 0) {
+        printf("Error: Cannot map frame ring (%s)\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void frame_ring_detach(frame_ring_t* ring) {
+    if (ring->shm) {
+        munmap(ring->shm, ring->size);
+        close(ring->fd);
+        ring->shm = NULL;
+    }
+}
+
+/*
+ * Queue one frame. While the ring is full, waits up to 'timeout_ms' for the
+ * consumer to make room (0: no wait, negative: no limit). Returns 0 on
+ * success, 1 if the ring stayed full, -1 if the frame does not fit in a slot.
+ */
+int frame_ring_send(frame_ring_t* ring, const uint8_t* frame, int length, int timeout_ms) {
+    frame_ring_shm_t* shm = ring->shm;
+    uint64_t mask = shm->capacity - 1;
+    uint64_t deadline = 0;
+    int spins = 0;
+
+    if (length < 0 || length > FRAME_RING_SLOT_DATA) {
+        return -1;
+    }
+
+    for (;;) {
+        uint64_t pos = atomic_load_explicit(&shm->head, memory_order_relaxed);
+        frame_ring_slot_t* slot = &shm->slots[pos & mask];
+        int64_t diff = (int64_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - pos);
+
+        if (diff == 0) {
+            if (!atomic_compare_exchange_weak_explicit(&shm->head, &pos, pos + 1,
+                                                       memory_order_relaxed, memory_order_relaxed)) {
+                continue;
+            }
+            memcpy(slot->data, frame, length);
+            slot->length = length;
+            slot->sent_ns = monotonic_ns();
+            atomic_store(&slot->sequence, pos + 1);
+            atomic_fetch_add_explicit(&shm->sent, 1, memory_order_relaxed);
+
+            if (atomic_load(&shm->data_waiters)) {
+                atomic_fetch_add(&shm->data_seq, 1);
+                futex_wake(&shm->data_seq);
+            }
+            return 0;
+        }
+        if (diff > 0) {
+            continue;  // Another producer claimed this position first
+        }
+
+        // Full
+        if (timeout_ms == 0) {
+            return 1;
+        }
+        if (++spins < FRAME_RING_SPIN) {
+            continue;
+        }
+        if (spins == FRAME_RING_SPIN && deadline == 0) {
+            deadline = frame_ring_deadline(timeout_ms);
+        }
+        atomic_fetch_add_explicit(&shm->full_waits, 1, memory_order_relaxed);
+        uint32_t seen = atomic_load(&shm->space_seq);
+        atomic_fetch_add(&shm->space_waiters, 1);
+        int waited = 1;
+        if ((int64_t)(atomic_load(&slot->sequence) - pos) < 0) {
+            waited = futex_wait(&shm->space_seq, seen, deadline);
+        }
+        atomic_fetch_sub(&shm->space_waiters, 1);
+        if (!waited) {
+            return 1;
+        }
+        spins = FRAME_RING_SPIN - 1;
+    }
+}
+
+// No more frames will be sent; the consumer sees end of stream once drained
+void frame_ring_close(frame_ring_t* ring) {
+    atomic_store(&ring->shm->closed, 1);
+    atomic_fetch_add(&ring->shm->data_seq, 1);
+    futex_wake(&ring->shm->data_seq);
+}
+
+/*
+ * Take the next frame (single consumer), waiting up to 'timeout_ms' for
+ * one as frame_ring_send() does. Returns its length, 0 at end of stream,
+ * or -1 if the ring stayed empty or the frame is larger than 'max_len'.
+ */
+int frame_ring_recv(frame_ring_t* ring, uint8_t* frame, int max_len, int timeout_ms) {
+    frame_ring_shm_t* shm = ring->shm;
+    uint64_t mask = shm->capacity - 1;
+    uint64_t deadline = 0;
+    int spins = 0;
+
+    for (;;) {
+        uint64_t pos = atomic_load_explicit(&shm->tail, memory_order_relaxed);
+        frame_ring_slot_t* slot = &shm->slots[pos & mask];
+
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) == pos + 1) {
+            int length = slot->length;
+            if (length > max_len) {
+                return -1;
+            }
+            memcpy(frame, slot->data, length);
+
+            uint64_t latency = monotonic_ns() - slot->sent_ns;
+            atomic_fetch_add_explicit(&shm->latency_total_ns, latency, memory_order_relaxed);
+            if (latency > atomic_load_explicit(&shm->latency_max_ns, memory_order_relaxed)) {
+                atomic_store_explicit(&shm->latency_max_ns, latency, memory_order_relaxed);
+            }
+
+            atomic_store(&slot->sequence, pos + shm->capacity);
+            atomic_store_explicit(&shm->tail, pos + 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&shm->received, 1, memory_order_relaxed);
+
+            if (atomic_load(&shm->space_waiters)) {
+                atomic_fetch_add(&shm->space_seq, 1);
+                futex_wake(&shm->space_seq);
+            }
+            return length;
+        }
+
+        if (atomic_load(&shm->closed) && atomic_load(&shm->head) == pos) {
+            return 0;
+        }
+        if (timeout_ms == 0) {
+            return -1;
+        }
+        if (++spins < FRAME_RING_SPIN) {
+            continue;
+        }
+        if (spins == FRAME_RING_SPIN && deadline == 0) {
+            deadline = frame_ring_deadline(timeout_ms);
+        }
+        atomic_fetch_add_explicit(&shm->empty_waits, 1, memory_order_relaxed);
+        uint32_t seen = atomic_load(&shm->data_seq);
+        atomic_fetch_add(&shm->data_waiters, 1);
+        int waited = 1;
+        if (atomic_load(&slot->sequence) != pos + 1 && !atomic_load(&shm->closed)) {
+            waited = futex_wait(&shm->data_seq, seen, deadline);
+        }
+        atomic_fetch_sub(&shm->data_waiters, 1);
+        if (!waited) {
+            return -1;
+        }
+        spins = FRAME_RING_SPIN - 1;
+    }
+}
+
+void frame_ring_report(const frame_ring_t* ring) {
+    frame_ring_shm_t* shm = ring->shm;
+    uint64_t received = atomic_load(&shm->received);
+
+    printf("Frame ring: %llu sent, %llu received, %llu dropped, %llu full waits, %llu empty waits\n",
+           (unsigned long long)atomic_load(&shm->sent), (unsigned long long)received,
+           (unsigned long long)atomic_load(&shm->dropped),
+           (unsigned long long)atomic_load(&shm->full_waits),
+           (unsigned long long)atomic_load(&shm->empty_waits));
+    if (received > 0) {
+        printf("Frame ring latency: avg %.1f us, max %.1f us\n",
+               atomic_load(&shm->latency_total_ns) / 1000.0 / received,
+               atomic_load(&shm->latency_max_ns) / 1000.0);
+    }
+}
@@ -4,9 +4,18 @@
 #include <stdint.h>
 #include "fec.h"  
 
+// Reuse AX.25 framing and CRC from the AX.25 generator
+#define AX25_NO_MAIN
+#include "ax25_packet.c"
+#include "digipeater.c"
+
 #define FX25_FLAG 0x7E
 #define CORRELATION_TAG_SIZE 8
 #define MAX_FRAME_SIZE 512
+#define MAX_PACKETS 100
+#define LINKTYPE_FX25 LINKTYPE_USER0   // Captures of FX.25 frames: tag + codeblock
+#define LINKTYPE_IL2P LINKTYPE_USER1   // Captures of IL2P frames: sync word onwards
+#define LINKTYPE_HARQ LINKTYPE_USER2   // Captures of HARQ segments: header onwards
 
 static const uint8_t CORR_TAG[8] = {
     0xCC, 0x8F, 0x8A, 0xE4, 0x85, 0xE2, 0x98, 0x01   
@@ -16,20 +25,152 @@ static const uint8_t CORR_TAG[8] = {
 #define K 223 
 #define ROOTS 32
 
+// FX.25 codeblock modes: 16, 32 or 64 check bytes, full or shortened blocks
+typedef struct {
+    uint64_t tag;   // Correlation tag, sent least significant byte first
+    int n;          // Codeblock size
+    int k;          // Data bytes
+    int nroots;     // Check bytes
+} fx25_mode_t;
+
+// Plain encoding always sends RS(255,223) under CORR_TAG, which stands in for
+// the specification's tag for that mode. With --adaptive the FEC controller
+// picks 16, 32 or 64 check bytes for each destination and fx25_select_mode()
+// takes the smallest codeblock of that strength the frame fits, or a weaker
+// one for frames too long for it. The receiver goes by the nearest tag.
+static const fx25_mode_t FX25_MODES[] = {
+    { 0xB74DB7DF8A532F3EULL, 255, 239, 16 },
+    { 0x26FF60A600CC8FDEULL, 144, 128, 16 },
+    { 0xC7DC0508F3D9B09EULL,  80,  64, 16 },
+    { 0x8F056EB4369660EEULL,  48,  32, 16 },
+    { 0x0198E285E48A8FCCULL, 255, 223, 32 },
+    { 0xFF94DC634F1CFF4EULL, 160, 128, 32 },
+    { 0x1EB7B9CDBC09C00EULL,  96,  64, 32 },
+    { 0xDBF869BD2DBB1776ULL,  64,  32, 32 },
+    { 0x3ADB0C13DEAE2836ULL, 255, 191, 64 },
+    { 0xAB69DB6A543188D6ULL, 192, 128, 64 },
+    { 0x4A4ABEC4A724B796ULL, 128,  64, 64 },
+};
+#define FX25_MODE_COUNT (int)(sizeof(FX25_MODES) / sizeof(FX25_MODES[0]))
+#define FX25_TAG_MAX_ERRORS 8     // Tag bit errors tolerated on receive
+#define FX25_RS_SIZES 3           // 16, 32 and 64 check bytes
+
+// IL2P (Improved Layer 2 Protocol)
+#define IL2P_SYNC_WORD_SIZE 3
+#define IL2P_HEADER_SIZE 13
+#define IL2P_HEADER_PARITY 2
+#define IL2P_MAX_PAYLOAD 1023
+#define IL2P_MAX_FEC_PARITY 16
+#define IL2P_MAX_FEC_BLOCK 239
+#define IL2P_BASELINE_BLOCK 247
+#define IL2P_PARITY_SIZES 5 // 2, 4, 6, 8 and 16 parity symbols
+
+static const uint8_t IL2P_SYNC_WORD[IL2P_SYNC_WORD_SIZE] = { 0xF1, 0x5E, 0x48 };
+
+typedef enum {
+    FEC_MODE_FX25 = 0,
+    FEC_MODE_IL2P,
+} fec_mode_t;
+
+#define MAX_CHANNELS 8
+
+// Aggregation of several AX.25 frames into one codeblock
+#define AGGREGATE_BUDGET_MS 100   // Longest a queued frame may wait for company
+#define AGGREGATE_MIN_FRAME 18    // Smallest AX.25 frame (addresses, control, FCS)
+#define AGGREGATE_MAX_FRAMES ((K - 1) / (AGGREGATE_MIN_FRAME + 1))   // Most frames one codeblock holds
+
+// Burst transmission defaults
+#define BURST_BAUD 1200
+#define BURST_TXDELAY_MS 300      // Key-up and preamble before the first frame
+#define BURST_TXTAIL_MS 30        // Hold after the last frame
+#define BURST_MAX_MS 5000         // Longest keyed transmission
+#define BURST_GAP_FLAGS 2         // Flags between frames inside a burst
+#define BURST_MAX_FRAMES 64
+
+typedef struct {
+    fec_mode_t mode;
+    int il2p_max_fec; // IL2P: 16 parity per block instead of 2..8
+} channel_config_t;
+
 typedef struct {
     void* rs_handle; // libfec Reed-Solomon handle
+    void* fx25_rs[FX25_RS_SIZES]; // Handles for 16/32/64 check bytes, see fx25_rs_index()
+    crc_repair_policy_t repair;   // FCS repair tried when RS decoding fails
+    void* il2p_rs[IL2P_PARITY_SIZES]; // IL2P codecs, indexed by il2p_rs_index()
+    uint8_t il2p_scramble[N]; // Scrambler keystream, restarted for every block
+    channel_config_t channels[MAX_CHANNELS];
+    uint8_t gf_exp[512]; // FX.25 field (0x187) tables for incremental parity
+    uint8_t gf_log[256];
 } fx25_config_t;
 
+void fx25_cleanup(fx25_config_t* config);
+
+static int il2p_rs_index(int nroots) {
+    return (nroots == IL2P_MAX_FEC_PARITY) ? IL2P_PARITY_SIZES - 1 : nroots / 2 - 1;
+}
+
+// x^9 + x^4 + 1 LFSR, all ones at the start of each block
+static void il2p_init_scrambler(uint8_t* keystream) {
+    uint16_t state = 0x1FF;
+
+    for (int i = 0; i < N; i++) {
+        uint8_t byte = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            int out = state & 1;
+            int feedback = (state ^ (state >> 4)) & 1;
+            state = (state >> 1) | (feedback << 8);
+            byte = (byte << 1) | out;
+        }
+        keystream[i] = byte;
+    }
+}
+
 fx25_config_t* fx25_init() {
-    fx25_config_t* config = malloc(sizeof(fx25_config_t));
+    fx25_config_t* config = calloc(1, sizeof(fx25_config_t));
     if (!config) return NULL;
 
+    config->repair = CRC_REPAIR_DEFAULT;
     config->rs_handle = init_rs_char(8, 0x187, 112, 11, ROOTS, 0);
     if (!config->rs_handle) {
         free(config);
         return NULL;
     }
 
+    // IL2P uses the x^8+x^4+x^3+x^2+1 field with first root alpha^0;
+    // short blocks are handled by zero-prefixing into the full codeword
+    static const int il2p_roots[IL2P_PARITY_SIZES] = { 2, 4, 6, 8, IL2P_MAX_FEC_PARITY };
+    for (int i = 0; i < IL2P_PARITY_SIZES; i++) {
+        config->il2p_rs[i] = init_rs_char(8, 0x11D, 0, 1, il2p_roots[i], 0);
+        if (!config->il2p_rs[i]) {
+            fx25_cleanup(config);
+            return NULL;
+        }
+    }
+    il2p_init_scrambler(config->il2p_scramble);
+
+    for (int i = 0; i < FX25_RS_SIZES; i++) {
+        config->fx25_rs[i] = init_rs_char(8, 0x187, 112, 11, 16 << i, 0);
+        if (!config->fx25_rs[i]) {
+            fx25_cleanup(config);
+            return NULL;
+        }
+    }
+
+    uint16_t x = 1;
+    for (int i = 0; i < 255; i++) {
+        config->gf_exp[i] = config->gf_exp[i + 255] = (uint8_t)x;
+        config->gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x187;
+    }
+    config->gf_exp[510] = config->gf_exp[0];
+    config->gf_exp[511] = config->gf_exp[1];
+
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+        config->channels[ch].mode = FEC_MODE_FX25;
+        config->channels[ch].il2p_max_fec = 1;
+    }
+
     return config;
 }
 
@@ -38,6 +179,16 @@ void fx25_cleanup(fx25_config_t* config) {
         if (config->rs_handle) {
             free_rs_char(config->rs_handle);
         }
+        for (int i = 0; i < IL2P_PARITY_SIZES; i++) {
+            if (config->il2p_rs[i]) {
+                free_rs_char(config->il2p_rs[i]);
+            }
+        }
+        for (int i = 0; i < FX25_RS_SIZES; i++) {
+            if (config->fx25_rs[i]) {
+                free_rs_char(config->fx25_rs[i]);
+            }
+        }
         free(config);
     }
 }
@@ -74,7 +225,8 @@ int parse_hex(const char* line, uint8_t* output, int max_len) {
     return byte_count;
 }
 
-int read_ax25(const char* filename, uint8_t packets[][MAX_FRAME_SIZE], int* packet_lengths, int max_packets) {
+// Parses each packet straight into its own pool buffer
+int read_ax25(const char* filename, frame_pool_t* pool, frame_buf_t** packets, int max_packets) {
     FILE* file = fopen(filename, "r");
     if (!file) {
         printf("Error: Cannot open %s\n", filename);
@@ -83,51 +235,121 @@ int read_ax25(const char* filename, uint8_t packets[][MAX_FRAME_SIZE], int* pack
     
     char line[1024];
     int packet_count = 0;
-    uint8_t temp_buffer[MAX_FRAME_SIZE];
-    int temp_len = 0;
-    int in_packet = 0;
+    frame_buf_t* current = NULL;
 
     while (fgets(line, sizeof(line), file) && packet_count < max_packets) {
         
         if (strstr(line, "Packet") && strstr(line, "bytes")) {
             // If we were building a packet, save it
-            if (in_packet && temp_len > 0) {
-                memcpy(packets[packet_count], temp_buffer, temp_len);
-                packet_lengths[packet_count] = temp_len;
-                packet_count++;
-                temp_len = 0;
+            if (current && current->length > 0) {
+                packets[packet_count++] = current;
+                current = NULL;
+            }
+            if (!current) {
+                current = frame_buf_alloc(pool);
+                if (!current) {
+                    printf("Error: Out of frame buffers\n");
+                    break;
+                }
             }
-            in_packet = 1;
             continue;
         }
         
-        if (in_packet) {
-            int bytes_parsed = parse_hex(line, temp_buffer + temp_len, 
-                                       MAX_FRAME_SIZE - temp_len);
-            temp_len += bytes_parsed;
+        if (current) {
+            int bytes_parsed = parse_hex(line, frame_buf_tail(current),
+                                       MAX_FRAME_SIZE - current->length);
+            frame_buf_put(current, bytes_parsed);
             
             // Check for empty line (end of packet)
-            if (strlen(line) <= 1 && temp_len > 0) {
-                memcpy(packets[packet_count], temp_buffer, temp_len);
-                packet_lengths[packet_count] = temp_len;
-                packet_count++;
-                temp_len = 0;
-                in_packet = 0;
+            if (strlen(line) <= 1 && current->length > 0) {
+                packets[packet_count++] = current;
+                current = NULL;
             }
         }
     }
     
     // Handle last packet if file doesn't end with empty line
-    if (in_packet && temp_len > 0) {
-        memcpy(packets[packet_count], temp_buffer, temp_len);
-        packet_lengths[packet_count] = temp_len;
-        packet_count++;
+    if (current && current->length > 0 && packet_count < max_packets) {
+        packets[packet_count++] = current;
+    } else if (current) {
+        frame_buf_unref(current);
     }
 
     fclose(file);
     return packet_count;
 }
 
+// Takes frames from a shared-memory ring until the producer closes it or
+// goes quiet; frames past 'max_packets' are drained so the producer never stalls.
+// Each frame is stamped with its CLOCK_MONOTONIC arrival time
+int read_ax25_ring(frame_ring_t* ring, frame_pool_t* pool, frame_buf_t** packets, int max_packets) {
+    uint8_t scratch[MAX_FRAME_SIZE];
+    int packet_count = 0;
+    int dropped = 0;
+    int length;
+
+    for (;;) {
+        frame_buf_t* buf = packet_count < max_packets ? frame_buf_alloc(pool) : NULL;
+        length = frame_ring_recv(ring, buf ? frame_buf_tail(buf) : scratch, MAX_FRAME_SIZE,
+                                 FRAME_RING_TIMEOUT_MS);
+        if (length <= 0) {
+            if (buf) {
+                frame_buf_unref(buf);
+            }
+            break;
+        }
+        if (!buf) {
+            dropped++;
+            continue;
+        }
+        frame_buf_put(buf, length);
+        buf->arrival_ns = monotonic_ns();
+        packets[packet_count++] = buf;
+    }
+
+    if (length < 0) {
+        printf("Warning: No frame from the producer for %d ms, giving up on the ring\n",
+               FRAME_RING_TIMEOUT_MS);
+    }
+    if (dropped > 0) {
+        atomic_fetch_add(&ring->shm->dropped, dropped);
+        printf("Warning: Dropped %d frames after keeping %d\n", dropped, packet_count);
+    }
+    return packet_count;
+}
+
+// Takes the AX.25 frames (LINKTYPE_AX25_KISS records) of a pcap or pcapng capture,
+// stamped with their capture timestamps
+int read_ax25_pcap(const char* filename, frame_pool_t* pool, frame_buf_t** packets, int max_packets) {
+    pcap_reader_t reader;
+    pcap_record_t rec;
+    int packet_count = 0;
+
+    if (pcap_open(&reader, filename) < 0) {
+        return 0;
+    }
+    while (packet_count < max_packets && pcap_next(&reader, &rec) > 0) {
+        if (rec.linktype != LINKTYPE_AX25_KISS) {
+            continue;
+        }
+        frame_buf_t* buf = frame_buf_alloc(pool);
+        if (!buf) {
+            printf("Error: Out of frame buffers\n");
+            break;
+        }
+        int length = ax25_frame_from_kiss(rec.data, rec.length, frame_buf_tail(buf));
+        if (length <= 0) {
+            frame_buf_unref(buf);
+            continue;
+        }
+        frame_buf_put(buf, length);
+        buf->arrival_ns = rec.ts_ns;
+        packets[packet_count++] = buf;
+    }
+    pcap_close(&reader);
+    return packet_count;
+}
+
 int generate_fx25(fx25_config_t* config, const uint8_t* ax25_packet, int ax25_len, uint8_t* fx25_frame) {
     if (ax25_len > K) {
         printf("Error: AX.25 packet too large (%d bytes, max %d)\n", ax25_len, K);
@@ -157,86 +379,2677 @@ int generate_fx25(fx25_config_t* config, const uint8_t* ax25_packet, int ax25_le
     return position;
 }
 
-void write_fx25_hex(FILE* output, const uint8_t* frame, int length, int packet_num) {
-    fprintf(output, "FX.25 Packet %d (%d bytes):\n", packet_num, length);
+// Same codeblock as generate_fx25, built around the AX.25 frame in its
+// pool buffer: padding and parity go in the tailroom, the tag in the headroom
+int generate_fx25_inplace(fx25_config_t* config, frame_buf_t* buf) {
+    int ax25_len = buf->length;
+    if (ax25_len > K) {
+        printf("Error: AX.25 packet too large (%d bytes, max %d)\n", ax25_len, K);
+        return 0;
+    }
 
-    fprintf(output, "Correlation Tag: ");
+    uint8_t* padding = frame_buf_put(buf, N - ax25_len);
+    uint8_t* tag = frame_buf_push(buf, CORRELATION_TAG_SIZE);
+    if (!padding || !tag) {
+        printf("Error: Frame buffer has no room for the FX.25 codeblock\n");
+        return 0;
+    }
+    memset(padding, 0, K - ax25_len);
+    memcpy(tag, CORR_TAG, CORRELATION_TAG_SIZE);
+
+    uint8_t* rs_block = tag + CORRELATION_TAG_SIZE;
+    encode_rs_char(config->rs_handle, rs_block, rs_block + K);
+
+    return buf->length;
+}
+
+static int fx25_rs_index(int nroots) {
+    return (nroots == 16) ? 0 : (nroots == 32) ? 1 : 2;
+}
+
+// Smallest codeblock with the requested check bytes that holds the frame,
+// falling back to fewer check bytes for frames too long for that strength
+int fx25_select_mode(int nroots, int ax25_len) {
+    for (; nroots >= 16; nroots /= 2) {
+        int best = -1;
+        for (int m = 0; m < FX25_MODE_COUNT; m++) {
+            if (FX25_MODES[m].nroots == nroots && FX25_MODES[m].k >= ax25_len &&
+                (best < 0 || FX25_MODES[m].k < FX25_MODES[best].k)) {
+                best = m;
+            }
+        }
+        if (best >= 0) {
+            return best;
+        }
+    }
+    return -1;
+}
+
+int generate_fx25_mode(fx25_config_t* config, int mode, const uint8_t* ax25_packet, int ax25_len, uint8_t* fx25_frame) {
+    const fx25_mode_t* m = &FX25_MODES[mode];
+    if (ax25_len > m->k) {
+        printf("Error: AX.25 packet too large (%d bytes, max %d)\n", ax25_len, m->k);
+        return 0;
+    }
+
+    int position = 0;
     for (int i = 0; i < CORRELATION_TAG_SIZE; i++) {
-        fprintf(output, "%02X ", frame[i]);
+        fx25_frame[position++] = (m->tag >> (8 * i)) & 0xFF;
     }
-    fprintf(output, "\n");
-    
-    // RS codeword 
-    fprintf(output, "RS Codeword:\n");
-    for (int i = CORRELATION_TAG_SIZE; i < length; i++) {
-        fprintf(output, "%02X ", frame[i]);
-        if ((i - CORRELATION_TAG_SIZE + 1) % 16 == 0) {
-            fprintf(output, "\n");
+
+    // Shortened codes are the full code with N - n leading zeros not sent
+    uint8_t rs_block[N];
+    int pad = N - m->n;
+    memset(rs_block, 0, N);
+    memcpy(rs_block + pad, ax25_packet, ax25_len);
+    encode_rs_char(config->fx25_rs[fx25_rs_index(m->nroots)], rs_block, rs_block + N - m->nroots);
+
+    memcpy(fx25_frame + position, rs_block + pad, m->n);
+    position += m->n;
+
+    return position;
+}
+
+/*
+ * Receive an FX.25 frame: identify the mode from the correlation tag
+ * (allowing a few bit errors), then correct the codeblock. Returns the
+ * number of data bytes copied to 'data' or -1, and reports the number of
+ * corrected symbols through 'corrected'.
+ */
+int decode_fx25(fx25_config_t* config, const uint8_t* fx25_frame, int fx25_len, uint8_t* data, int* corrected) {
+    uint64_t tag = 0;
+    int mode = -1, best_errors = FX25_TAG_MAX_ERRORS + 1;
+
+    *corrected = 0;
+    if (fx25_len < CORRELATION_TAG_SIZE) {
+        return -1;
+    }
+    for (int i = 0; i < CORRELATION_TAG_SIZE; i++) {
+        tag |= (uint64_t)fx25_frame[i] << (8 * i);
+    }
+    for (int m = 0; m < FX25_MODE_COUNT; m++) {
+        int errors = __builtin_popcountll(tag ^ FX25_MODES[m].tag);
+        if (errors < best_errors) {
+            best_errors = errors;
+            mode = m;
         }
     }
-    if ((length - CORRELATION_TAG_SIZE) % 16 != 0) {
-        fprintf(output, "\n");
+    if (mode < 0 || fx25_len < CORRELATION_TAG_SIZE + FX25_MODES[mode].n) {
+        return -1;
     }
-    fprintf(output, "\n");
+
+    const fx25_mode_t* m = &FX25_MODES[mode];
+    uint8_t rs_block[N];
+    int pad = N - m->n;
+    memset(rs_block, 0, pad);
+    memcpy(rs_block + pad, fx25_frame + CORRELATION_TAG_SIZE, m->n);
+
+    int result = decode_rs_char(config->fx25_rs[fx25_rs_index(m->nroots)], rs_block, NULL, 0);
+    for (int i = 0; result >= 0 && i < pad; i++) {
+        if (rs_block[i] != 0) {
+            result = -1;
+        }
+    }
+    metrics_rs_block(result);
+    if (result < 0) {
+        return -1;
+    }
+
+    *corrected = result;
+    memcpy(data, rs_block + pad, m->k);
+    return m->k;
 }
 
-int main(int argc, char* argv[]) {
-    const char* input_file = "packets.txt";
-    const char* output_file = "fx25_packets.txt";
-            
-    fx25_config_t* config = fx25_init();
-    if (!config) {
-        printf("Error: Failed to initialize FX.25 configuration\n");
-        return 1;
+typedef struct {
+    unsigned long fast_accepted;  // Inner FCS good on a clean tag, no RS work
+    unsigned long rs_decoded;     // Needed the Reed-Solomon decoder
+    unsigned long repaired;       // RS failed, fixed from the FCS syndrome
+    unsigned long aggregates;     // Codeblocks carrying several frames (see the aggregator)
+    unsigned long failed;
+} fx25_rx_stats_t;
+
+// Length of the flag-delimited AX.25 frame at the start of a zero-padded
+// data field, or -1 if it is not there or its FCS does not check
+static int ax25_frame_bounds(const uint8_t* data, int length) {
+    int end = length;
+    while (end > 0 && data[end - 1] == 0) {
+        end--;
     }
-    
-    uint8_t ax25_packets[100][MAX_FRAME_SIZE];
-    int packet_lengths[100];
-    int packet_count = read_ax25(input_file, ax25_packets, packet_lengths, 100);
+    if (end < 4 || data[0] != AX25_FLAG || data[end - 1] != AX25_FLAG) {
+        return -1;
+    }
+    return end;
+}
 
-    if (packet_count <= 0) {
-        printf("Error: No AX.25 packets found in %s\n", input_file);
-        fx25_cleanup(config);
-        return 1;
+static int ax25_frame_extent(const uint8_t* data, int length) {
+    int end = ax25_frame_bounds(data, length);
+    if (end < 0) {
+        return -1;
     }
 
-    printf("Read %d AX.25 packets\n", packet_count);
-    
-    if (packet_count > 0) {
-        printf("First packet length: %d bytes\n", packet_lengths[0]);
-        printf("First few bytes: ");
-        for (int i = 0; i < 8 && i < packet_lengths[0]; i++) {
-            printf("%02X ", ax25_packets[0][i]);
+    uint16_t fcs = crc_update(0xFFFF, data + 1, end - 4) ^ 0xFFFF;
+    if (data[end - 3] != (fcs & 0xFF) || data[end - 2] != (fcs >> 8)) {
+        return -1;
+    }
+    return end;
+}
+
+/*
+ * FCS-first receive: when the correlation tag arrived without bit errors
+ * and the AX.25 FCS inside the codeblock checks, the frame is taken as is
+ * and the RS decoder never runs. Otherwise falls back to decode_fx25().
+ * Returns the AX.25 frame length copied to 'ax25_packet', or -1; failures
+ * are not counted in 'stats'. When the RS decode succeeded but the data
+ * field is not one frame, it is left in 'data' and '*data_len' is set.
+ */
+static int fx25_receive(fx25_config_t* config, const uint8_t* fx25_frame, int fx25_len,
+                        uint8_t* ax25_packet, int* corrected, fx25_rx_stats_t* stats,
+                        uint8_t* data, int* data_len) {
+    uint64_t tag = 0;
+    int length;
+
+    *corrected = 0;
+    *data_len = 0;
+    if (fx25_len < CORRELATION_TAG_SIZE) {
+        return -1;
+    }
+    for (int i = 0; i < CORRELATION_TAG_SIZE; i++) {
+        tag |= (uint64_t)fx25_frame[i] << (8 * i);
+    }
+
+    for (int m = 0; m < FX25_MODE_COUNT; m++) {
+        if (tag != FX25_MODES[m].tag || fx25_len < CORRELATION_TAG_SIZE + FX25_MODES[m].n) {
+            continue;
         }
-        printf("\n");
+        length = ax25_frame_extent(fx25_frame + CORRELATION_TAG_SIZE, FX25_MODES[m].k);
+        if (length > 0) {
+            memcpy(ax25_packet, fx25_frame + CORRELATION_TAG_SIZE, length);
+            if (stats) stats->fast_accepted++;
+            return length;
+        }
+        break;
     }
-    
-    FILE* output = fopen(output_file, "w");
-    if (!output) {
-        printf("Error: Cannot create %s\n", output_file);
-        fx25_cleanup(config);
-        return 1;
+
+    int k = decode_fx25(config, fx25_frame, fx25_len, data, corrected);
+    length = (k > 0) ? ax25_frame_extent(data, k) : -1;
+    if (length < 0 && k < 0) {
+        // Errors may sit mostly in the check bytes; try the raw data field
+        for (int m = 0; m < FX25_MODE_COUNT; m++) {
+            if (__builtin_popcountll(tag ^ FX25_MODES[m].tag) <= FX25_TAG_MAX_ERRORS &&
+                fx25_len >= CORRELATION_TAG_SIZE + FX25_MODES[m].n) {
+                memcpy(data, fx25_frame + CORRELATION_TAG_SIZE, FX25_MODES[m].k);
+                length = ax25_frame_bounds(data, FX25_MODES[m].k);
+                if (length > 0 && ax25_repair_frame(data, length, &config->repair) > 0) {
+                    memcpy(ax25_packet, data, length);
+                    if (stats) stats->repaired++;
+                    return length;
+                }
+                break;
+            }
+        }
+        return -1;
     }
-    
-    int fx25_count = 0;
+    if (length < 0) {
+        *data_len = k;
+        return -1;
+    }
+    memcpy(ax25_packet, data, length);
+    if (stats) stats->rs_decoded++;
+    return length;
+}
+
+int decode_fx25_fcs_first(fx25_config_t* config, const uint8_t* fx25_frame, int fx25_len,
+                          uint8_t* ax25_packet, int* corrected, fx25_rx_stats_t* stats) {
+    uint8_t data[N];
+    int data_len;
+
+    int length = fx25_receive(config, fx25_frame, fx25_len, ax25_packet, corrected, stats, data, &data_len);
+    if (length < 0 && stats) {
+        stats->failed++;
+    }
+    return length;
+}
+
+/*
+ * Plain AX.25 receive (--fcs-check): frames that arrive with their own FCS
+ * (packets.txt, the frame ring) are checked before they are encoded. A bad
+ * FCS gets the repair the FX.25 receive path falls back to, under the same
+ * policy (config->repair), and frames it cannot fix are dropped. Frames
+ * without flags are passed on as they are. Returns the number of frames
+ * kept, moved to the front of 'packets'.
+ */
+int ax25_check_frames(fx25_config_t* config, frame_buf_t** packets, int packet_count, int* repaired, int* dropped) {
+    int kept = 0;
+
+    *repaired = *dropped = 0;
     for (int i = 0; i < packet_count; i++) {
-        uint8_t fx25_frame[512];
-        
-        int fx25_len = generate_fx25(config, ax25_packets[i], packet_lengths[i], fx25_frame);
-        
-        if (fx25_len > 0) {
-            write_fx25_hex(output, fx25_frame, fx25_len, fx25_count);
-            fx25_count++;
-        } else {
-            printf("Warning: Failed to encode packet %d (length: %d bytes)\n", i, packet_lengths[i]);
+        frame_buf_t* buf = packets[i];
+        uint8_t* frame = frame_buf_data(buf);
+        int length = buf->length;
+
+        if (length >= 4 && frame[0] == AX25_FLAG && frame[length - 1] == AX25_FLAG &&
+            ax25_frame_extent(frame, length) != length) {
+            if (ax25_repair_frame(frame, length, &config->repair) <= 0) {
+                (*dropped)++;
+                frame_buf_unref(buf);
+                continue;
+            }
+            (*repaired)++;
+        }
+        packets[kept++] = buf;
+    }
+    return kept;
+}
+
+// IL2P header fields live in bits 6 and 7 of the 13 header bytes, MSB first
+static void il2p_set_field(uint8_t* hdr, int bit, int first, int width, int value) {
+    for (int i = 0; i < width; i++) {
+        if ((value >> (width - 1 - i)) & 1) {
+            hdr[first + i] |= 1 << bit;
+        }
+    }
+}
+
+static int il2p_get_field(const uint8_t* hdr, int bit, int first, int width) {
+    int value = 0;
+    for (int i = 0; i < width; i++) {
+        value = (value << 1) | ((hdr[first + i] >> bit) & 1);
+    }
+    return value;
+}
+
+// AX.25 PID <-> 4-bit IL2P code (0 = not representable)
+static const uint8_t IL2P_PID_TABLE[16] = {
+    0x00, 0x00, 0x01, 0x06, 0x07, 0x08, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xCC, 0xCD, 0xCE, 0xCF, 0xF0
+};
+
+static int il2p_encode_pid(uint8_t pid) {
+    for (int code = 2; code < 16; code++) {
+        if (IL2P_PID_TABLE[code] == pid && pid != 0x00) {
+            return code;
         }
     }
-    
-    fclose(output);
-    fx25_cleanup(config);
-    
-    printf("Successfully created %d FX.25 frames\n", fx25_count);
-    printf("Results written to %s\n", output_file);
-    
     return 0;
-}
\ No newline at end of file
+}
+
+static void il2p_scramble(const fx25_config_t* config, uint8_t* data, int length) {
+    for (int i = 0; i < length; i++) {
+        data[i] ^= config->il2p_scramble[i];
+    }
+}
+
+// Shortened RS: zero-prefix the block into a full 255-symbol codeword
+static void il2p_rs_encode(fx25_config_t* config, uint8_t* block, int data_len, int nroots) {
+    uint8_t codeword[N];
+    int pad = N - nroots - data_len;
+
+    memset(codeword, 0, pad);
+    memcpy(codeword + pad, block, data_len);
+    encode_rs_char(config->il2p_rs[il2p_rs_index(nroots)], codeword, block + data_len);
+}
+
+static int il2p_rs_decode(fx25_config_t* config, uint8_t* block, int data_len, int nroots) {
+    uint8_t codeword[N];
+    int pad = N - nroots - data_len;
+
+    memset(codeword, 0, pad);
+    memcpy(codeword + pad, block, data_len + nroots);
+    int result = decode_rs_char(config->il2p_rs[il2p_rs_index(nroots)], codeword, NULL, 0);
+    // Any "correction" in the zero prefix means the block was not decodable
+    for (int i = 0; result >= 0 && i < pad; i++) {
+        if (codeword[i] != 0) {
+            result = -1;
+        }
+    }
+    metrics_rs_block(result);
+    if (result < 0) {
+        return -1;
+    }
+    memcpy(block, codeword + pad, data_len + nroots);
+    return result;
+}
+
+// Split the payload into nearly equal blocks and pick their parity size
+static void il2p_block_layout(int payload_len, int max_fec, int* block_count,
+                              int* small_size, int* large_count, int* parity) {
+    int max_block = max_fec ? IL2P_MAX_FEC_BLOCK : IL2P_BASELINE_BLOCK;
+
+    *block_count = (payload_len + max_block - 1) / max_block;
+    if (*block_count == 0) {
+        *small_size = *large_count = *parity = 0;
+        return;
+    }
+    *small_size = payload_len / *block_count;
+    *large_count = payload_len % *block_count;
+
+    if (max_fec) {
+        *parity = IL2P_MAX_FEC_PARITY;
+    } else {
+        int largest = *small_size + (*large_count ? 1 : 0);
+        *parity = (largest <= 61) ? 2 : (largest <= 123) ? 4 : (largest <= 185) ? 6 : 8;
+    }
+}
+
+/*
+ * Translate the AX.25 header into the compact type 1 header when possible:
+ * UI frames with exactly two addresses, SIXBIT-representable callsigns,
+ * canonical SSID bytes and a PID from the IL2P table. Returns 1 and the
+ * offset of the information field, or 0 when the frame has to travel
+ * unmodified in a type 0 (transparent) header.
+ */
+static int il2p_translate_header(const uint8_t* body, int body_len, uint8_t* hdr, int* info_offset) {
+    if (body_len < 16 || (body[6] & 1) || !(body[13] & 1)) {
+        return 0;
+    }
+    if ((body[14] & ~0x10) != AX_25_CONTROL) {
+        return 0;
+    }
+    int pid = il2p_encode_pid(body[15]);
+    if (pid == 0) {
+        return 0;
+    }
+
+    // Command frames have C set in the destination, responses in the source
+    int command = (body[6] >> 7) & 1;
+    if (((body[13] >> 7) & 1) == command || (body[6] & 0x60) != 0x60 || (body[13] & 0x60) != 0x60) {
+        return 0;
+    }
+
+    for (int i = 0; i < 12; i++) {
+        uint8_t addr = body[i < 6 ? i : i + 1];
+        uint8_t c = addr >> 1;
+        if ((addr & 1) || c < 0x20 || c > 0x5F) {
+            return 0;
+        }
+        hdr[i] = c - 0x20;
+    }
+    hdr[12] = (((body[6] >> 1) & 0x0F) << 4) | ((body[13] >> 1) & 0x0F);
+
+    int control = ((body[14] & 0x10) ? 0x40 : 0) | (command ? 0x20 : 0);
+    il2p_set_field(hdr, 7, 0, 1, 1);       // UI
+    il2p_set_field(hdr, 7, 1, 4, pid);
+    il2p_set_field(hdr, 7, 5, 7, control);
+
+    *info_offset = 16;
+    return 1;
+}
+
+int generate_il2p(fx25_config_t* config, const channel_config_t* channel,
+                  const uint8_t* ax25_packet, int ax25_len, uint8_t* il2p_frame) {
+    // IL2P carries the frame without HDLC flags or FCS
+    const uint8_t* body = ax25_packet;
+    int body_len = ax25_len;
+    if (body_len > 0 && body[0] == AX25_FLAG) {
+        body++;
+        body_len--;
+    }
+    if (body_len > 0 && body[body_len - 1] == AX25_FLAG) {
+        body_len--;
+    }
+    body_len -= 2;
+    if (body_len < 15) {
+        printf("Error: AX.25 packet too short for IL2P (%d bytes)\n", ax25_len);
+        return 0;
+    }
+
+    uint8_t header[IL2P_HEADER_SIZE + IL2P_HEADER_PARITY] = {0};
+    int info_offset = 0;
+    int header_type = il2p_translate_header(body, body_len, header, &info_offset);
+    if (!header_type) {
+        memset(header, 0, sizeof(header));
+    }
+
+    int payload_len = body_len - info_offset;
+    if (payload_len > IL2P_MAX_PAYLOAD) {
+        printf("Error: AX.25 packet too large for IL2P (%d bytes, max %d)\n", payload_len, IL2P_MAX_PAYLOAD);
+        return 0;
+    }
+
+    int block_count, small_size, large_count, parity;
+    il2p_block_layout(payload_len, channel->il2p_max_fec, &block_count, &small_size, &large_count, &parity);
+    int total = IL2P_SYNC_WORD_SIZE + sizeof(header) + payload_len + block_count * parity;
+    if (total > MAX_FRAME_SIZE) {
+        printf("Error: IL2P frame too large (%d bytes, max %d)\n", total, MAX_FRAME_SIZE);
+        return 0;
+    }
+
+    il2p_set_field(header, 6, 0, 1, channel->il2p_max_fec ? 1 : 0);
+    il2p_set_field(header, 6, 1, 1, header_type);
+    il2p_set_field(header, 6, 2, 10, payload_len);
+
+    int position = 0;
+    memcpy(il2p_frame + position, IL2P_SYNC_WORD, IL2P_SYNC_WORD_SIZE);
+    position += IL2P_SYNC_WORD_SIZE;
+
+    // Header: scramble, then protect with its own two parity symbols
+    il2p_scramble(config, header, IL2P_HEADER_SIZE);
+    il2p_rs_encode(config, header, IL2P_HEADER_SIZE, IL2P_HEADER_PARITY);
+    memcpy(il2p_frame + position, header, sizeof(header));
+    position += sizeof(header);
+
+    // Payload blocks, each scrambled and followed by its parity
+    const uint8_t* payload = body + info_offset;
+    for (int b = 0; b < block_count; b++) {
+        int size = small_size + (b < large_count ? 1 : 0);
+        uint8_t* block = il2p_frame + position;
+
+        memcpy(block, payload, size);
+        il2p_scramble(config, block, size);
+        il2p_rs_encode(config, block, size, parity);
+
+        payload += size;
+        position += size + parity;
+    }
+
+    return position;
+}
+
+/*
+ * Decode an IL2P frame (starting at the sync word) back into a complete
+ * AX.25 frame with flags and a regenerated FCS. Returns the AX.25 length,
+ * or -1 if the header or any payload block could not be corrected.
+ */
+int decode_il2p(fx25_config_t* config, const uint8_t* il2p_frame, int il2p_len, uint8_t* ax25_packet) {
+    uint8_t header[IL2P_HEADER_SIZE + IL2P_HEADER_PARITY];
+    int position = IL2P_SYNC_WORD_SIZE;
+
+    if (il2p_len < position + (int)sizeof(header)) {
+        return -1;
+    }
+    memcpy(header, il2p_frame + position, sizeof(header));
+    position += sizeof(header);
+    if (il2p_rs_decode(config, header, IL2P_HEADER_SIZE, IL2P_HEADER_PARITY) < 0) {
+        return -1;
+    }
+    il2p_scramble(config, header, IL2P_HEADER_SIZE);
+
+    int max_fec = il2p_get_field(header, 6, 0, 1);
+    int header_type = il2p_get_field(header, 6, 1, 1);
+    int payload_len = il2p_get_field(header, 6, 2, 10);
+
+    int length = 0;
+    ax25_packet[length++] = AX25_FLAG;
+
+    if (header_type) {
+        int pid = il2p_get_field(header, 7, 1, 4);
+        int control = il2p_get_field(header, 7, 5, 7);
+        int command = (control >> 5) & 1;
+
+        for (int i = 0; i < 12; i++) {
+            ax25_packet[length + (i < 6 ? i : i + 1)] = (uint8_t)(((header[i] & 0x3F) + 0x20) << 1);
+        }
+        ax25_packet[length + 6] = (command << 7) | 0x60 | ((header[12] >> 4) << 1);
+        ax25_packet[length + 13] = (!command << 7) | 0x60 | ((header[12] & 0x0F) << 1) | 1;
+        ax25_packet[length + 14] = AX_25_CONTROL | ((control & 0x40) ? 0x10 : 0);
+        ax25_packet[length + 15] = IL2P_PID_TABLE[pid];
+        length += 16;
+    }
+
+    int block_count, small_size, large_count, parity;
+    il2p_block_layout(payload_len, max_fec, &block_count, &small_size, &large_count, &parity);
+    if (il2p_len < position + payload_len + block_count * parity ||
+        length + payload_len + 3 > MAX_FRAME_SIZE) {
+        return -1;
+    }
+
+    for (int b = 0; b < block_count; b++) {
+        int size = small_size + (b < large_count ? 1 : 0);
+        uint8_t block[N];
+
+        memcpy(block, il2p_frame + position, size + parity);
+        if (il2p_rs_decode(config, block, size, parity) < 0) {
+            return -1;
+        }
+        il2p_scramble(config, block, size);
+        memcpy(ax25_packet + length, block, size);
+
+        position += size + parity;
+        length += size;
+    }
+
+    uint16_t fcs = calculate_crc(&ax25_packet[1], length - 1);
+    ax25_packet[length++] = fcs & 0xFF;
+    ax25_packet[length++] = (fcs >> 8) & 0xFF;
+    ax25_packet[length++] = AX25_FLAG;
+
+    return length;
+}
+
+// Encode with whichever FEC framing the channel is configured for
+int encode_for_channel(fx25_config_t* config, int channel, const uint8_t* ax25_packet, int ax25_len, uint8_t* frame) {
+    const channel_config_t* ch = &config->channels[channel];
+
+    if (ch->mode == FEC_MODE_IL2P) {
+        return generate_il2p(config, ch, ax25_packet, ax25_len, frame);
+    }
+    return generate_fx25(config, ax25_packet, ax25_len, frame);
+}
+
+/*
+ * Frame aggregation. Instead of one zero-padded frame per codeblock, several
+ * queued AX.25 frames are written into the K data bytes as an HDLC bit
+ * stream: flag, bit-stuffed frame, flag, bit-stuffed frame, ... with the
+ * rest filled by idle flags. Bit stuffing keeps the flags unambiguous, so
+ * the receiver splits the block with an ordinary HDLC decoder and checks
+ * each frame's FCS. Bits are sent LSB first, as on an AX.25 link.
+ */
+typedef struct {
+    uint8_t block[K];
+    int bit_pos;
+    int frame_count;
+    long first_ms;   // Arrival time of the oldest queued frame
+    long budget_ms;
+} fx25_aggregator_t;
+
+static void put_bit(uint8_t* buffer, int bit_pos, int bit) {
+    if (bit) {
+        buffer[bit_pos >> 3] |= 1 << (bit_pos & 7);
+    } else {
+        buffer[bit_pos >> 3] &= ~(1 << (bit_pos & 7));
+    }
+}
+
+static int put_flag(uint8_t* buffer, int bit_pos) {
+    for (int i = 0; i < 8; i++) {
+        put_bit(buffer, bit_pos++, (AX25_FLAG >> i) & 1);
+    }
+    return bit_pos;
+}
+
+// Append a bit-stuffed frame body; returns the new bit position or -1 if it does not fit
+static int hdlc_stuff(uint8_t* buffer, int bit_pos, int max_bits, const uint8_t* body, int length) {
+    int ones = 0;
+
+    for (int i = 0; i < length; i++) {
+        for (int b = 0; b < 8; b++) {
+            int bit = (body[i] >> b) & 1;
+            if (bit_pos >= max_bits) return -1;
+            put_bit(buffer, bit_pos++, bit);
+            if (bit) {
+                if (++ones == 5) {
+                    if (bit_pos >= max_bits) return -1;
+                    put_bit(buffer, bit_pos++, 0);
+                    ones = 0;
+                }
+            } else {
+                ones = 0;
+            }
+        }
+    }
+    return bit_pos;
+}
+
+void fx25_aggregator_init(fx25_aggregator_t* agg, long budget_ms) {
+    memset(agg, 0, sizeof(*agg));
+    agg->budget_ms = budget_ms;
+}
+
+// Emit the queued frames as one FX.25 frame; returns its length (0 if empty)
+int fx25_aggregator_flush(fx25_config_t* config, fx25_aggregator_t* agg, uint8_t* fx25_frame) {
+    if (agg->frame_count == 0) {
+        return 0;
+    }
+
+    // Idle flags fill the rest of the block
+    for (int bit = agg->bit_pos; bit < K * 8; bit++) {
+        put_bit(agg->block, bit, (AX25_FLAG >> ((bit - agg->bit_pos) & 7)) & 1);
+    }
+    int length = generate_fx25(config, agg->block, K, fx25_frame);
+
+    agg->bit_pos = 0;
+    agg->frame_count = 0;
+    metrics_set(METRIC_QUEUE_AGGREGATOR, 0);
+    return length;
+}
+
+/*
+ * Queue an AX.25 frame (flags optional). If it does not fit in the current
+ * codeblock, that block is emitted first and the frame starts a new one; a
+ * block with no room left for another frame is emitted straight away.
+ * Returns the length of the emitted FX.25 frame, 0 if nothing was emitted,
+ * or -1 if the frame is too large even for an empty codeblock.
+ */
+int fx25_aggregator_add(fx25_config_t* config, fx25_aggregator_t* agg, const uint8_t* ax25_packet,
+                        int ax25_len, long now_ms, uint8_t* fx25_frame) {
+    const uint8_t* body = ax25_packet;
+    int body_len = ax25_len;
+    int emitted = 0;
+
+    if (body_len > 0 && body[0] == AX25_FLAG) {
+        body++;
+        body_len--;
+    }
+    if (body_len > 0 && body[body_len - 1] == AX25_FLAG) {
+        body_len--;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int start = agg->frame_count ? agg->bit_pos : put_flag(agg->block, 0);
+        int end = hdlc_stuff(agg->block, start, K * 8 - 8, body, body_len);
+
+        if (end >= 0) {
+            agg->bit_pos = put_flag(agg->block, end);
+            if (agg->frame_count++ == 0) {
+                agg->first_ms = now_ms;
+            }
+            metrics_set(METRIC_QUEUE_AGGREGATOR, agg->frame_count);
+            if (agg->bit_pos + (AGGREGATE_MIN_FRAME + 1) * 8 > K * 8) {
+                if (emitted) {
+                    // Already returning a block; the next add or poll sends this one
+                    return emitted;
+                }
+                return fx25_aggregator_flush(config, agg, fx25_frame);
+            }
+            return emitted;
+        }
+        if (agg->frame_count == 0) {
+            printf("Error: AX.25 packet too large to aggregate (%d bytes)\n", ax25_len);
+            return -1;
+        }
+        emitted = fx25_aggregator_flush(config, agg, fx25_frame);
+    }
+    return emitted;
+}
+
+// Emit the current block once its oldest frame has used up the latency budget
+int fx25_aggregator_poll(fx25_config_t* config, fx25_aggregator_t* agg, long now_ms, uint8_t* fx25_frame) {
+    if (agg->frame_count > 0 && now_ms - agg->first_ms >= agg->budget_ms) {
+        return fx25_aggregator_flush(config, agg, fx25_frame);
+    }
+    return 0;
+}
+
+/*
+ * Receive side: HDLC-decode a (corrected) codeblock data area and return the
+ * AX.25 frames with a valid FCS, each with its opening and closing flag.
+ */
+int fx25_deaggregate(const uint8_t* data, int length, uint8_t frames[][MAX_FRAME_SIZE],
+                     int* frame_lengths, int max_frames) {
+    uint8_t current[MAX_FRAME_SIZE];
+    uint8_t pattern = 0;
+    int frame_bits = 0, ones = 0, in_frame = 0;
+    int count = 0;
+
+    trace_begin(TRACE_REASSEMBLY, TRACE_NO_FRAME);
+    for (int bit_pos = 0; bit_pos < length * 8 && count < max_frames; bit_pos++) {
+        int bit = (data[bit_pos >> 3] >> (bit_pos & 7)) & 1;
+        pattern = (pattern >> 1) | (bit << 7);
+
+        if (pattern == AX25_FLAG) {
+            // The flag's first seven bits were taken as data; drop them
+            int bytes = (frame_bits - 7) / 8;
+            if (in_frame && frame_bits >= 7 && (frame_bits - 7) % 8 == 0 && bytes >= AGGREGATE_MIN_FRAME) {
+                uint16_t fcs = calculate_crc(current, bytes - 2);
+                if ((fcs & 0xFF) == current[bytes - 2] && (fcs >> 8) == current[bytes - 1]) {
+                    frames[count][0] = AX25_FLAG;
+                    memcpy(&frames[count][1], current, bytes);
+                    frames[count][bytes + 1] = AX25_FLAG;
+                    frame_lengths[count++] = bytes + 2;
+                }
+            }
+            in_frame = 1;
+            frame_bits = 0;
+            ones = 0;
+            continue;
+        }
+        if (!in_frame) {
+            continue;
+        }
+
+        if (bit) {
+            if (++ones > 6) {
+                in_frame = 0; // Abort sequence
+                continue;
+            }
+        } else if (ones == 5) {
+            ones = 0;         // Stuffed zero
+            continue;
+        } else {
+            ones = 0;
+        }
+
+        if (frame_bits >= (MAX_FRAME_SIZE - 2) * 8) {
+            in_frame = 0;
+            continue;
+        }
+        put_bit(current, frame_bits++, bit);
+    }
+
+    trace_end(TRACE_REASSEMBLY, TRACE_NO_FRAME);
+    return count;
+}
+
+// A corrected data field filled to the end that starts with a flag holds
+// several HDLC-framed frames; a single frame is zero padded
+static int fx25_is_aggregate(const uint8_t* data, int length) {
+    return length > 0 && data[0] == AX25_FLAG && data[length - 1] != 0;
+}
+
+/*
+ * Receive a codeblock that may be aggregated: as decode_fx25_fcs_first(),
+ * but a corrected data field filled to the end (no zero padding) that
+ * starts with a flag is split into its frames. Returns the number of
+ * frames stored in 'frames' (flag-delimited), 0 if none could be decoded.
+ */
+int decode_fx25_frames(fx25_config_t* config, const uint8_t* fx25_frame, int fx25_len,
+                       uint8_t frames[][MAX_FRAME_SIZE], int* frame_lengths, int max_frames,
+                       int* corrected, fx25_rx_stats_t* stats) {
+    uint8_t data[N];
+    int data_len, count = 0;
+
+    int length = fx25_receive(config, fx25_frame, fx25_len, frames[0], corrected, stats, data, &data_len);
+    if (length > 0) {
+        frame_lengths[0] = length;
+        return 1;
+    }
+    if (fx25_is_aggregate(data, data_len)) {
+        count = fx25_deaggregate(data, data_len, frames, frame_lengths, max_frames);
+    }
+    if (stats) {
+        if (count > 0) {
+            stats->rs_decoded++;
+            stats->aggregates++;
+        } else {
+            stats->failed++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Burst transmission. Every key-up costs TXDELAY (and TXTAIL), which at
+ * 1200 baud is often longer than the frame itself. The scheduler collects
+ * frames and sends as many as fit in BURST_MAX_MS back to back, separated
+ * only by a few flags, so the key-up is paid once per burst.
+ */
+typedef struct {
+    int baud;
+    int txdelay_ms;
+    int txtail_ms;
+    int max_burst_ms;
+    int gap_flags;
+} burst_config_t;
+
+typedef struct {
+    burst_config_t cfg;
+    frame_writer_t writer;
+    int annotate;       // Hex text output: mark where each burst starts
+    uint8_t frames[BURST_MAX_FRAMES][MAX_FRAME_SIZE];
+    int lengths[BURST_MAX_FRAMES];
+    int count;
+    long queued_bits;   // Frame and gap bits in the current burst
+    // Statistics
+    int bursts;
+    int frames_sent;
+    long frame_bits;    // Bits of frame data sent
+    double burst_ms;    // Keyed time with bursting
+    double single_ms;   // Keyed time if every frame were sent on its own
+} burst_scheduler_t;
+
+static double bits_to_ms(const burst_config_t* cfg, long bits) {
+    return bits * 1000.0 / cfg->baud;
+}
+
+static double burst_airtime_ms(const burst_config_t* cfg, long bits) {
+    return cfg->txdelay_ms + bits_to_ms(cfg, bits) + cfg->txtail_ms;
+}
+
+void burst_init(burst_scheduler_t* burst, const burst_config_t* cfg, frame_writer_t writer) {
+    memset(burst, 0, sizeof(*burst));
+    burst->cfg = *cfg;
+    burst->writer = writer;
+    burst->annotate = 1;
+}
+
+// Key up once and send every queued frame
+void burst_flush(burst_scheduler_t* burst, FILE* output) {
+    if (burst->count == 0) {
+        return;
+    }
+
+    double airtime = burst_airtime_ms(&burst->cfg, burst->queued_bits);
+    if (burst->annotate) {
+        fprintf(output, "Burst %d: %d frames, %.0f ms keyed (TXDELAY %d ms)\n\n",
+                burst->bursts, burst->count, airtime, burst->cfg.txdelay_ms);
+    }
+
+    for (int i = 0; i < burst->count; i++) {
+        burst->writer(output, burst->frames[i], burst->lengths[i], burst->frames_sent++);
+        burst->frame_bits += burst->lengths[i] * 8;
+        burst->single_ms += burst_airtime_ms(&burst->cfg, burst->lengths[i] * 8);
+    }
+
+    burst->burst_ms += airtime;
+    burst->bursts++;
+    burst->count = 0;
+    burst->queued_bits = 0;
+    metrics_set(METRIC_QUEUE_BURST, 0);
+}
+
+// Queue a frame, sending the current burst first if the frame would overrun it
+void burst_queue(burst_scheduler_t* burst, FILE* output, const uint8_t* frame, int length) {
+    long bits = length * 8 + (burst->count ? burst->cfg.gap_flags * 8 : 0);
+
+    if (burst->count == BURST_MAX_FRAMES ||
+        (burst->count && burst_airtime_ms(&burst->cfg, burst->queued_bits + bits) > burst->cfg.max_burst_ms)) {
+        burst_flush(burst, output);
+        bits = length * 8;
+    }
+
+    memcpy(burst->frames[burst->count], frame, length);
+    burst->lengths[burst->count++] = length;
+    burst->queued_bits += bits;
+    metrics_set(METRIC_QUEUE_BURST, burst->count);
+}
+
+// Channel efficiency: share of keyed time spent sending frame data
+void burst_report(const burst_scheduler_t* burst) {
+    if (burst->frames_sent == 0) {
+        return;
+    }
+
+    double data_ms = bits_to_ms(&burst->cfg, burst->frame_bits);
+    printf("Channel efficiency at %d baud, TXDELAY %d ms:\n", burst->cfg.baud, burst->cfg.txdelay_ms);
+    printf("  one frame per key-up:   %5.1f%% (%d key-ups, %.0f ms keyed)\n",
+           100.0 * data_ms / burst->single_ms, burst->frames_sent, burst->single_ms);
+    printf("  bursts up to %5d ms: %5.1f%% (%d key-ups, %.0f ms keyed)\n", burst->cfg.max_burst_ms,
+           100.0 * data_ms / burst->burst_ms, burst->bursts, burst->burst_ms);
+}
+
+/*
+ * FX.25 frame templates. RS parity is linear, so changing data byte p by d
+ * changes the parity by d times the parity of the unit vector at p. The
+ * template stores that unit parity (in log form) for every field byte and
+ * for the two FCS bytes, which are the only bytes a field change touches.
+ */
+#define FX25_TEMPLATE_SLOTS 16
+#define GF_LOG_ZERO 255
+
+typedef struct {
+    frame_template_t ax25;
+    uint8_t frame[MAX_FRAME_SIZE]; // Correlation tag + RS codeblock
+    int length;
+    uint8_t parity_log[MAX_TEMPLATE_FIELDS + 2][ROOTS]; // Fields, then FCS low/high
+} fx25_template_t;
+
+typedef struct {
+    uint32_t key;
+    int in_use;
+    unsigned long last_used;
+    fx25_template_t tmpl;
+} fx25_template_slot_t;
+
+typedef struct {
+    fx25_template_slot_t slots[FX25_TEMPLATE_SLOTS];
+    unsigned long clock;
+} fx25_template_cache_t;
+
+static void fx25_unit_parity(fx25_config_t* config, int pos, uint8_t* parity_log) {
+    uint8_t block[N] = {0};
+
+    block[pos] = 1;
+    encode_rs_char(config->rs_handle, block, block + K);
+    for (int j = 0; j < ROOTS; j++) {
+        parity_log[j] = block[K + j] ? config->gf_log[block[K + j]] : GF_LOG_ZERO;
+    }
+}
+
+int fx25_template_init(fx25_config_t* config, fx25_template_t* tmpl, const frame_template_t* ax25) {
+    tmpl->ax25 = *ax25;
+    tmpl->length = generate_fx25(config, ax25->frame, ax25->length, tmpl->frame);
+    if (tmpl->length == 0) {
+        return -1;
+    }
+
+    for (int f = 0; f < ax25->field_count; f++) {
+        fx25_unit_parity(config, ax25->field_pos[f], tmpl->parity_log[f]);
+    }
+    fx25_unit_parity(config, ax25->fcs_pos, tmpl->parity_log[MAX_TEMPLATE_FIELDS]);
+    fx25_unit_parity(config, ax25->fcs_pos + 1, tmpl->parity_log[MAX_TEMPLATE_FIELDS + 1]);
+    return 0;
+}
+
+static void fx25_template_apply(const fx25_config_t* config, fx25_template_t* tmpl, int slot, uint8_t delta) {
+    if (delta == 0) {
+        return;
+    }
+
+    uint8_t* parity = tmpl->frame + CORRELATION_TAG_SIZE + K;
+    int log_delta = config->gf_log[delta];
+    for (int j = 0; j < ROOTS; j++) {
+        if (tmpl->parity_log[slot][j] != GF_LOG_ZERO) {
+            parity[j] ^= config->gf_exp[log_delta + tmpl->parity_log[slot][j]];
+        }
+    }
+}
+
+// Change one field byte: patches the data byte, the inner FCS and the RS parity
+void fx25_template_set_byte(const fx25_config_t* config, fx25_template_t* tmpl, int field, uint8_t value) {
+    uint8_t* block = tmpl->frame + CORRELATION_TAG_SIZE;
+    int pos = tmpl->ax25.field_pos[field];
+    int fcs_pos = tmpl->ax25.fcs_pos;
+    uint8_t old = tmpl->ax25.frame[pos];
+
+    uint16_t fcs_delta = frame_template_set_byte(&tmpl->ax25, field, value);
+    block[pos] = value;
+    block[fcs_pos] = tmpl->ax25.frame[fcs_pos];
+    block[fcs_pos + 1] = tmpl->ax25.frame[fcs_pos + 1];
+
+    fx25_template_apply(config, tmpl, field, old ^ value);
+    fx25_template_apply(config, tmpl, MAX_TEMPLATE_FIELDS, fcs_delta & 0xFF);
+    fx25_template_apply(config, tmpl, MAX_TEMPLATE_FIELDS + 1, (fcs_delta >> 8) & 0xFF);
+}
+
+void fx25_template_set_sequence(const fx25_config_t* config, fx25_template_t* tmpl, uint16_t sequence) {
+    fx25_template_set_byte(config, tmpl, 0, (sequence >> 8) & 0xFF);
+    fx25_template_set_byte(config, tmpl, 1, sequence & 0xFF);
+}
+
+fx25_template_t* fx25_template_lookup(fx25_template_cache_t* cache, uint32_t key) {
+    for (int i = 0; i < FX25_TEMPLATE_SLOTS; i++) {
+        fx25_template_slot_t* slot = &cache->slots[i];
+        if (slot->in_use && slot->key == key) {
+            slot->last_used = ++cache->clock;
+            return &slot->tmpl;
+        }
+    }
+    return NULL;
+}
+
+// Add (or replace) the template for a key, evicting the least recently used slot
+fx25_template_t* fx25_template_insert(fx25_config_t* config, fx25_template_cache_t* cache,
+                                      uint32_t key, const frame_template_t* ax25) {
+    fx25_template_slot_t* victim = &cache->slots[0];
+
+    for (int i = 0; i < FX25_TEMPLATE_SLOTS; i++) {
+        fx25_template_slot_t* slot = &cache->slots[i];
+        if (slot->in_use && slot->key == key) {
+            victim = slot;
+            break;
+        }
+        if (!slot->in_use || (victim->in_use && slot->last_used < victim->last_used)) {
+            victim = slot;
+        }
+    }
+
+    victim->in_use = 0;
+    if (fx25_template_init(config, &victim->tmpl, ax25) < 0) {
+        return NULL;
+    }
+    victim->key = key;
+    victim->in_use = 1;
+    victim->last_used = ++cache->clock;
+    return &victim->tmpl;
+}
+
+/*
+ * Diversity combining. Copies of the same FX.25 frame (from digipeaters or
+ * several receivers) are grouped by a fingerprint of the address field,
+ * falling back to byte similarity when the address itself was hit. Each
+ * new copy triggers a decode of the combined block: byte-wise majority
+ * vote for hard copies, or summed bit reliabilities when every copy came
+ * with them. Bytes the copies disagree on are passed to RS as erasures,
+ * which corrects twice as many of them as unknown errors.
+ */
+#define COMBINER_SLOTS 16
+#define COMBINER_MAX_COPIES 8
+#define COMBINER_SOFT_ERASE 16    // Summed |reliability| below this marks a weak bit
+#define COMBINER_WINDOW 16        // Copies further apart (in receptions) are not combined
+#define COMBINER_SOFT_SURE 32     // |reliability| at which two copies may not disagree
+#define COMBINE_PENDING 0
+#define COMBINE_DUPLICATE -2
+
+typedef struct {
+    int in_use;
+    int done;                     // Already delivered; later copies are duplicates
+    int mode;
+    uint32_t fingerprint;
+    int copies;
+    int soft_copies;
+    unsigned long last_used;
+    uint8_t copy[COMBINER_MAX_COPIES][N];
+    int16_t soft[N * 8];          // Summed reliabilities, positive means 1
+} combiner_slot_t;
+
+typedef struct {
+    combiner_slot_t slots[COMBINER_SLOTS];
+    unsigned long clock;
+    unsigned long decoded_single;  // Decoded from the first copy
+    unsigned long decoded_combined;
+    unsigned long duplicates;
+} combiner_t;
+
+void combiner_init(combiner_t* comb) {
+    memset(comb, 0, sizeof(*comb));
+}
+
+static uint32_t combiner_fingerprint(const uint8_t* data) {
+    uint32_t hash = 2166136261u;   // FNV-1a over flag + destination + source
+    for (int i = 0; i < 15; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// A copy joins a recent group when it is close enough to the group's first
+// copy. Copies too damaged to decode alone can differ in more bytes than
+// two distinct codewords do, so only a matching address fingerprint allows
+// that much disagreement; a delivered frame only absorbs copies it would
+// have decoded to anyway. With reliabilities only confident disagreements
+// count, which separates noisy copies from distinct frames far better.
+static int combiner_distance(const combiner_slot_t* slot, int n, const uint8_t* data,
+                             const int8_t* reliability, int limit) {
+    int differ = 0;
+
+    if (reliability && slot->soft_copies == slot->copies && !slot->done) {
+        for (int i = 0; i < n && differ <= limit; i++) {
+            for (int bit = 0; bit < 8; bit++) {
+                int a = reliability[i * 8 + bit], b = slot->soft[i * 8 + bit];
+                if (abs(a) >= COMBINER_SOFT_SURE && abs(b) >= COMBINER_SOFT_SURE && (a > 0) != (b > 0)) {
+                    differ++;
+                    break;
+                }
+            }
+        }
+        return differ;
+    }
+    for (int i = 0; i < n && differ <= limit; i++) {
+        differ += slot->copy[0][i] != data[i];
+    }
+    return differ;
+}
+
+static combiner_slot_t* combiner_match(combiner_t* comb, int mode, const uint8_t* data, const int8_t* reliability) {
+    const fx25_mode_t* m = &FX25_MODES[mode];
+    uint32_t fingerprint = combiner_fingerprint(data);
+    combiner_slot_t* best = NULL;
+    combiner_slot_t* victim = &comb->slots[0];
+    int best_differ = N;
+
+    for (int s = 0; s < COMBINER_SLOTS; s++) {
+        combiner_slot_t* slot = &comb->slots[s];
+        if (!slot->in_use) {
+            if (victim->in_use) victim = slot;
+            continue;
+        }
+        if (victim->in_use && slot->last_used < victim->last_used) {
+            victim = slot;
+        }
+        if (slot->mode != mode || comb->clock - slot->last_used >= COMBINER_WINDOW) {
+            continue;
+        }
+
+        int limit = (slot->fingerprint == fingerprint && !slot->done) ? m->n / 4 : m->nroots / 2;
+        int differ = combiner_distance(slot, m->n, data, reliability, limit);
+        if (differ <= limit && differ < best_differ) {
+            best = slot;
+            best_differ = differ;
+        }
+    }
+    if (best) {
+        best->last_used = ++comb->clock;
+        return best;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->in_use = 1;
+    victim->mode = mode;
+    victim->fingerprint = fingerprint;
+    victim->last_used = ++comb->clock;
+    return victim;
+}
+
+// Combined hard decision per byte and a reliability score (lower is weaker)
+static void combiner_vote(const combiner_slot_t* slot, int n, uint8_t* block, int* score) {
+    for (int i = 0; i < n; i++) {
+        if (slot->soft_copies == slot->copies) {
+            uint8_t byte = 0;
+            int weakest = 0x7FFF;
+            for (int bit = 0; bit < 8; bit++) {
+                int16_t sum = slot->soft[i * 8 + bit];
+                byte = (byte << 1) | (sum > 0);
+                if (abs(sum) < weakest) weakest = abs(sum);
+            }
+            block[i] = byte;
+            score[i] = weakest;
+        } else {
+            int best = 0, best_count = 0;
+            for (int c = 0; c < slot->copies; c++) {
+                int count = 0;
+                for (int d = 0; d < slot->copies; d++) {
+                    count += slot->copy[d][i] == slot->copy[c][i];
+                }
+                if (count > best_count) {
+                    best_count = count;
+                    best = c;
+                }
+            }
+            block[i] = slot->copy[best][i];
+            score[i] = (best_count * 2 > slot->copies) ? COMBINER_SOFT_ERASE : best_count;
+        }
+    }
+}
+
+/*
+ * Add one received copy; 'reliability' holds one value per codeblock bit
+ * (MSB first, positive means 1) or is NULL for hard input. Returns the
+ * AX.25 frame length once the frame decodes, COMBINE_PENDING while more
+ * copies are needed, COMBINE_DUPLICATE for copies of a delivered frame,
+ * or -1 if the copy is not a recognisable FX.25 frame.
+ */
+int combiner_add(fx25_config_t* config, combiner_t* comb, const uint8_t* fx25_frame, int fx25_len,
+                 const int8_t* reliability, uint8_t* ax25_packet, int* corrected) {
+    uint64_t tag = 0;
+    int mode = -1, best_errors = FX25_TAG_MAX_ERRORS + 1;
+
+    *corrected = 0;
+    if (fx25_len < CORRELATION_TAG_SIZE) {
+        return -1;
+    }
+    for (int i = 0; i < CORRELATION_TAG_SIZE; i++) {
+        tag |= (uint64_t)fx25_frame[i] << (8 * i);
+    }
+    for (int m = 0; m < FX25_MODE_COUNT; m++) {
+        int errors = __builtin_popcountll(tag ^ FX25_MODES[m].tag);
+        if (errors < best_errors) {
+            best_errors = errors;
+            mode = m;
+        }
+    }
+    if (mode < 0 || fx25_len < CORRELATION_TAG_SIZE + FX25_MODES[mode].n) {
+        return -1;
+    }
+
+    const fx25_mode_t* m = &FX25_MODES[mode];
+    const uint8_t* data = fx25_frame + CORRELATION_TAG_SIZE;
+    combiner_slot_t* slot = combiner_match(comb, mode, data, reliability);
+    if (slot->done) {
+        comb->duplicates++;
+        return COMBINE_DUPLICATE;
+    }
+
+    // A full group already failed with every copy it holds; the copy is
+    // dropped, so that the soft sums only cover stored copies
+    if (slot->copies == COMBINER_MAX_COPIES) {
+        return COMBINE_PENDING;
+    }
+    memcpy(slot->copy[slot->copies], data, m->n);
+    slot->copies++;
+    if (reliability) {
+        for (int i = 0; i < m->n * 8; i++) {
+            int sum = slot->soft[i] + reliability[i];
+            slot->soft[i] = sum > 0x7FFF ? 0x7FFF : sum < -0x7FFF ? -0x7FFF : sum;
+        }
+        slot->soft_copies++;
+    }
+
+    uint8_t block[N];
+    int score[N];
+    int eras_pos[N];
+    int no_eras = 0;
+    int pad = N - m->n;
+
+    memset(block, 0, pad);
+    combiner_vote(slot, m->n, block + pad, score);
+
+    // Erase the weakest bytes, leaving half the check bytes for errors
+    if (slot->copies > 1) {
+        int used[N] = { 0 };
+        while (no_eras < m->nroots / 2) {
+            int weakest = -1;
+            for (int i = 0; i < m->n; i++) {
+                if (!used[i] && score[i] < COMBINER_SOFT_ERASE && (weakest < 0 || score[i] < score[weakest])) {
+                    weakest = i;
+                }
+            }
+            if (weakest < 0) break;
+            used[weakest] = 1;
+            eras_pos[no_eras++] = pad + weakest;
+        }
+    }
+
+    int result = decode_rs_char(config->fx25_rs[fx25_rs_index(m->nroots)], block, eras_pos, no_eras);
+    int length = -1;
+    if (result >= 0) {
+        int pad_clean = 1;
+        for (int i = 0; i < pad; i++) {
+            if (block[i] != 0) pad_clean = 0;
+        }
+        length = pad_clean ? ax25_frame_extent(block + pad, m->k) : -1;
+    }
+    if (length < 0) {
+        return COMBINE_PENDING;
+    }
+
+    for (int s = 0; s < COMBINER_SLOTS; s++) {
+        combiner_slot_t* other = &comb->slots[s];
+        if (other != slot && other->in_use && other->done && other->mode == mode &&
+            memcmp(other->copy[0], block + pad, m->n) == 0) {
+            slot->in_use = 0;
+            comb->duplicates++;
+            return COMBINE_DUPLICATE;
+        }
+    }
+
+    memcpy(ax25_packet, block + pad, length);
+    memcpy(slot->copy[0], block + pad, m->n);   // Later copies compare against the clean block
+    slot->fingerprint = combiner_fingerprint(block + pad);
+    slot->done = 1;
+    *corrected = result;
+    if (slot->copies == 1) {
+        comb->decoded_single++;
+    } else {
+        comb->decoded_combined++;
+    }
+    return length;
+}
+
+/*
+ * Adaptive FEC. The controller keeps per-peer statistics from the FX.25
+ * decoder (corrected symbols and decode failures on frames received from
+ * that peer, taken as a measure of the shared channel) and asks a pluggable
+ * policy how many check bytes to use for the next frames to that peer.
+ */
+#define FEC_MAX_PEERS 32
+#define FEC_EWMA_SHIFT 3          // Statistics average over about 8 frames
+
+typedef struct {
+    uint8_t address[7];   // AX.25 address of the peer (callsign + SSID byte)
+    int in_use;
+    int nroots;           // Check bytes currently used towards this peer
+    double load;          // Average corrected symbols / correctable symbols
+    double failure_rate;  // Average share of frames that failed to decode
+    int frames_since_change;
+    unsigned long last_used;
+    unsigned long frames, failures, corrected;
+    unsigned long changes;    // Times the policy picked a different strength
+} fec_peer_t;
+
+// A policy returns the check bytes to use next (16, 32 or 64)
+typedef int (*fec_policy_t)(const fec_peer_t* peer, void* ctx);
+
+typedef struct {
+    fec_peer_t peers[FEC_MAX_PEERS];
+    fec_policy_t policy;
+    void* policy_ctx;
+    int default_nroots;
+    unsigned long clock;
+} fec_controller_t;
+
+// Default policy: separate up and down thresholds plus a minimum dwell time
+// before stepping down, so the code does not flap on a marginal link
+typedef struct {
+    double up_load;       // Step up when more than this share of capacity is used
+    double down_load;     // Step down only below this share...
+    double up_failure;    // ...or step up when this many frames fail
+    double down_failure;  // ...and only when failures are below this
+    int down_dwell;       // Frames at the current strength before stepping down
+} fec_hysteresis_t;
+
+static const fec_hysteresis_t FEC_HYSTERESIS_DEFAULT = { 0.5, 0.125, 0.05, 0.01, 32 };
+
+int fec_policy_hysteresis(const fec_peer_t* peer, void* ctx) {
+    const fec_hysteresis_t* h = ctx ? ctx : &FEC_HYSTERESIS_DEFAULT;
+
+    if ((peer->load > h->up_load || peer->failure_rate > h->up_failure) && peer->nroots < 64) {
+        return peer->nroots * 2;
+    }
+    if (peer->load < h->down_load && peer->failure_rate < h->down_failure &&
+        peer->frames_since_change >= h->down_dwell && peer->nroots > 16) {
+        return peer->nroots / 2;
+    }
+    return peer->nroots;
+}
+
+void fec_controller_init(fec_controller_t* ctrl, fec_policy_t policy, void* policy_ctx) {
+    memset(ctrl, 0, sizeof(*ctrl));
+    ctrl->policy = policy ? policy : fec_policy_hysteresis;
+    ctrl->policy_ctx = policy_ctx;
+    ctrl->default_nroots = ROOTS;
+}
+
+static int address_match(const uint8_t* a, const uint8_t* b) {
+    for (int i = 0; i < 6; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return ((a[6] >> 1) & 0x0F) == ((b[6] >> 1) & 0x0F);
+}
+
+// Find a peer, optionally creating it (replacing the least recently used)
+fec_peer_t* fec_controller_peer(fec_controller_t* ctrl, const uint8_t* address, int create) {
+    fec_peer_t* victim = &ctrl->peers[0];
+
+    for (int i = 0; i < FEC_MAX_PEERS; i++) {
+        fec_peer_t* peer = &ctrl->peers[i];
+        if (peer->in_use && address_match(peer->address, address)) {
+            peer->last_used = ++ctrl->clock;
+            return peer;
+        }
+        if (!peer->in_use || (victim->in_use && peer->last_used < victim->last_used)) {
+            victim = peer;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    memcpy(victim->address, address, 7);
+    victim->in_use = 1;
+    victim->nroots = ctrl->default_nroots;
+    victim->last_used = ++ctrl->clock;
+    return victim;
+}
+
+// Feed one decode result (corrected symbols, or failed) for a peer
+void fec_controller_report(fec_controller_t* ctrl, const uint8_t* address, int corrected, int failed, int nroots) {
+    fec_peer_t* peer = fec_controller_peer(ctrl, address, 1);
+    double load = failed ? 1.0 : (double)corrected / (nroots / 2);
+    double weight = 1.0 / (1 << FEC_EWMA_SHIFT);
+
+    peer->frames++;
+    peer->failures += failed ? 1 : 0;
+    peer->corrected += failed ? 0 : corrected;
+    peer->load += (load - peer->load) * weight;
+    peer->failure_rate += ((failed ? 1.0 : 0.0) - peer->failure_rate) * weight;
+    peer->frames_since_change++;
+
+    int next = ctrl->policy(peer, ctrl->policy_ctx);
+    if (next != peer->nroots) {
+        peer->nroots = next;
+        peer->frames_since_change = 0;
+        peer->changes++;
+    }
+}
+
+int fec_controller_nroots(fec_controller_t* ctrl, const uint8_t* address) {
+    fec_peer_t* peer = fec_controller_peer(ctrl, address, 0);
+    return peer ? peer->nroots : ctrl->default_nroots;
+}
+
+static const uint8_t* ax25_address_field(const uint8_t* frame, int index) {
+    return frame + (frame[0] == AX25_FLAG ? 1 : 0) + 7 * index;
+}
+
+// Decode a received FX.25 frame and credit the result to its sender
+int decode_fx25_from_peer(fx25_config_t* config, fec_controller_t* ctrl, const uint8_t* fx25_frame,
+                          int fx25_len, uint8_t* data) {
+    int corrected;
+    int length = decode_fx25(config, fx25_frame, fx25_len, data, &corrected);
+    int nroots = ROOTS;
+
+    for (int m = 0; m < FX25_MODE_COUNT; m++) {
+        uint64_t tag = 0;
+        for (int i = 0; i < CORRELATION_TAG_SIZE && i < fx25_len; i++) {
+            tag |= (uint64_t)fx25_frame[i] << (8 * i);
+        }
+        if (__builtin_popcountll(tag ^ FX25_MODES[m].tag) <= FX25_TAG_MAX_ERRORS) {
+            nroots = FX25_MODES[m].nroots;
+            break;
+        }
+    }
+
+    // On failure the uncorrected source address is the best guess of the sender
+    const uint8_t* source = (length > 0) ? ax25_address_field(data, 1)
+                                         : ax25_address_field(fx25_frame + CORRELATION_TAG_SIZE, 1);
+    if (length > 0 || fx25_len >= CORRELATION_TAG_SIZE + 15) {
+        fec_controller_report(ctrl, source, corrected, length < 0, nroots);
+    }
+    return length;
+}
+
+// As decode_fx25_frames(), with the result credited to the sender
+int decode_fx25_frames_from_peer(fx25_config_t* config, fec_controller_t* ctrl, const uint8_t* fx25_frame,
+                                 int fx25_len, uint8_t frames[][MAX_FRAME_SIZE], int* frame_lengths,
+                                 int max_frames) {
+    uint8_t data[N];
+    int k = decode_fx25_from_peer(config, ctrl, fx25_frame, fx25_len, data);
+    int length = (k > 0) ? ax25_frame_extent(data, k) : -1;
+
+    if (length > 0) {
+        memcpy(frames[0], data, length);
+        frame_lengths[0] = length;
+        return 1;
+    }
+    return fx25_is_aggregate(data, k) ? fx25_deaggregate(data, k, frames, frame_lengths, max_frames) : 0;
+}
+
+// Encode towards a peer with the strength the controller currently picks
+int encode_for_peer(fx25_config_t* config, fec_controller_t* ctrl, const uint8_t* ax25_packet,
+                    int ax25_len, uint8_t* fx25_frame) {
+    int mode = fx25_select_mode(fec_controller_nroots(ctrl, ax25_address_field(ax25_packet, 0)), ax25_len);
+    if (mode < 0) {
+        printf("Error: AX.25 packet too large (%d bytes)\n", ax25_len);
+        return 0;
+    }
+    return generate_fx25_mode(config, mode, ax25_packet, ax25_len, fx25_frame);
+}
+
+// Check bytes of an FX.25 frame as sent (exact correlation tag), or 0
+static int fx25_frame_nroots(const uint8_t* fx25_frame, int fx25_len) {
+    uint64_t tag = 0;
+    for (int i = 0; i < CORRELATION_TAG_SIZE && i < fx25_len; i++) {
+        tag |= (uint64_t)fx25_frame[i] << (8 * i);
+    }
+    for (int m = 0; m < FX25_MODE_COUNT; m++) {
+        if (FX25_MODES[m].tag == tag) {
+            return FX25_MODES[m].nroots;
+        }
+    }
+    return 0;
+}
+
+void fec_controller_summary(const fec_controller_t* ctrl) {
+    for (int i = 0; i < FEC_MAX_PEERS; i++) {
+        const fec_peer_t* peer = &ctrl->peers[i];
+        if (!peer->in_use) {
+            continue;
+        }
+        char call[7];
+        int len = 0;
+        for (int c = 0; c < 6 && (peer->address[c] >> 1) != ' '; c++) {
+            call[len++] = peer->address[c] >> 1;
+        }
+        call[len] = '\0';
+        printf("  %s-%d: %d check bytes after %lu changes, %lu frames heard, %lu failed, %lu symbols corrected\n",
+               call, (peer->address[6] >> 1) & 0x0F, peer->nroots, peer->changes, peer->frames,
+               peer->failures, peer->corrected);
+    }
+}
+
+/*
+ * Type-II hybrid ARQ. Every frame is encoded once with the 64-root mother
+ * code; the first transmission carries the data and only the first
+ * HARQ_FIRST_PARITY check bytes, the rest are punctured. When the receiver
+ * cannot decode, it asks for the next HARQ_STEP_PARITY check bytes and
+ * retries with everything it holds for that frame ID. Punctured check
+ * bytes are passed to the decoder as erasures, so 2 * errors + punctured
+ * must stay within 64.
+ */
+#define HARQ_ROOTS 64
+#define HARQ_MAX_DATA (N - HARQ_ROOTS)
+#define HARQ_FIRST_PARITY 16
+#define HARQ_STEP_PARITY 16
+#define HARQ_SLOTS 16
+#define HARQ_HEADER_SIZE 4        // Frame ID (2), redundancy version, data length
+
+typedef struct {
+    uint8_t codeword[N];          // Zero prefix + data + all mother-code check bytes
+    int data_len;
+    uint16_t frame_id;
+} harq_tx_t;
+
+typedef struct {
+    int in_use;
+    uint16_t frame_id;
+    int data_len;
+    int parity_received;          // Check bytes held, always a prefix of the parity
+    unsigned long last_used;
+    uint8_t block[N];
+} harq_slot_t;
+
+typedef struct {
+    harq_slot_t slots[HARQ_SLOTS];
+    unsigned long clock;
+} harq_rx_t;
+
+// Check bytes sent up to and including redundancy version 'rv'
+static int harq_parity_after(int rv) {
+    int parity = HARQ_FIRST_PARITY + rv * HARQ_STEP_PARITY;
+    return parity > HARQ_ROOTS ? HARQ_ROOTS : parity;
+}
+
+int harq_encode(fx25_config_t* config, harq_tx_t* tx, uint16_t frame_id, const uint8_t* data, int data_len) {
+    if (data_len <= 0 || data_len > HARQ_MAX_DATA) {
+        printf("Error: HARQ frame too large (%d bytes, max %d)\n", data_len, HARQ_MAX_DATA);
+        return -1;
+    }
+
+    memset(tx->codeword, 0, N);
+    memcpy(tx->codeword + HARQ_MAX_DATA - data_len, data, data_len);
+    encode_rs_char(config->fx25_rs[fx25_rs_index(HARQ_ROOTS)], tx->codeword, tx->codeword + HARQ_MAX_DATA);
+    tx->data_len = data_len;
+    tx->frame_id = frame_id;
+    return 0;
+}
+
+/*
+ * Build redundancy version 'rv' of a frame: version 0 is the data plus the
+ * first check bytes, later versions carry only new check bytes. Returns
+ * the segment length, or 0 once the mother code is exhausted.
+ */
+int harq_segment(const harq_tx_t* tx, int rv, uint8_t* segment) {
+    int first = (rv == 0) ? 0 : harq_parity_after(rv - 1);
+    int last = harq_parity_after(rv);
+    int position = 0;
+
+    if (rv > 0 && first >= HARQ_ROOTS) {
+        return 0;
+    }
+
+    segment[position++] = tx->frame_id >> 8;
+    segment[position++] = tx->frame_id & 0xFF;
+    segment[position++] = rv;
+    segment[position++] = tx->data_len;
+
+    if (rv == 0) {
+        memcpy(segment + position, tx->codeword + HARQ_MAX_DATA - tx->data_len, tx->data_len);
+        position += tx->data_len;
+    }
+    memcpy(segment + position, tx->codeword + HARQ_MAX_DATA + first, last - first);
+    return position + last - first;
+}
+
+void harq_rx_init(harq_rx_t* rx) {
+    memset(rx, 0, sizeof(*rx));
+}
+
+static harq_slot_t* harq_rx_slot(harq_rx_t* rx, uint16_t frame_id, int create) {
+    harq_slot_t* victim = &rx->slots[0];
+
+    for (int i = 0; i < HARQ_SLOTS; i++) {
+        harq_slot_t* slot = &rx->slots[i];
+        if (slot->in_use && slot->frame_id == frame_id) {
+            slot->last_used = ++rx->clock;
+            return slot;
+        }
+        if (!slot->in_use || (victim->in_use && slot->last_used < victim->last_used)) {
+            victim = slot;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->in_use = 1;
+    victim->frame_id = frame_id;
+    victim->last_used = ++rx->clock;
+    return victim;
+}
+
+/*
+ * Take in one received segment. Returns the data length when the frame
+ * decodes (the slot is released), 0 when more redundancy is needed (send
+ * a request for version *next_rv), or -1 when the segment is unusable or
+ * all redundancy has been used without success.
+ */
+int harq_receive(fx25_config_t* config, harq_rx_t* rx, const uint8_t* segment, int length,
+                 uint8_t* data, int* next_rv) {
+    if (length < HARQ_HEADER_SIZE) {
+        return -1;
+    }
+
+    uint16_t frame_id = (segment[0] << 8) | segment[1];
+    int rv = segment[2];
+    int data_len = segment[3];
+    int first = (rv == 0) ? 0 : harq_parity_after(rv - 1);
+    int last = harq_parity_after(rv);
+    const uint8_t* payload = segment + HARQ_HEADER_SIZE;
+
+    if (data_len <= 0 || data_len > HARQ_MAX_DATA ||
+        length != HARQ_HEADER_SIZE + (rv == 0 ? data_len : 0) + last - first) {
+        return -1;
+    }
+
+    harq_slot_t* slot = harq_rx_slot(rx, frame_id, rv == 0);
+    if (!slot) {
+        return -1;  // Extra redundancy for a frame we never saw
+    }
+    if (rv == 0) {
+        memset(slot->block, 0, N);
+        slot->data_len = data_len;
+        slot->parity_received = 0;
+        memcpy(slot->block + HARQ_MAX_DATA - data_len, payload, data_len);
+        payload += data_len;
+    }
+    if (slot->data_len != data_len || first != slot->parity_received) {
+        return -1;  // Out of order; the sender will be asked again
+    }
+    memcpy(slot->block + HARQ_MAX_DATA + first, payload, last - first);
+    slot->parity_received = last;
+
+    int eras_pos[HARQ_ROOTS];
+    int no_eras = 0;
+    for (int i = slot->parity_received; i < HARQ_ROOTS; i++) {
+        eras_pos[no_eras++] = HARQ_MAX_DATA + i;
+    }
+
+    uint8_t block[N];
+    memcpy(block, slot->block, N);
+    int result = decode_rs_char(config->fx25_rs[fx25_rs_index(HARQ_ROOTS)], block, eras_pos, no_eras);
+    int pad_clean = 1;
+    for (int i = 0; i < HARQ_MAX_DATA - data_len; i++) {
+        if (block[i] != 0) pad_clean = 0;
+    }
+
+    if (result >= 0 && pad_clean) {
+        memcpy(data, block + HARQ_MAX_DATA - data_len, data_len);
+        slot->in_use = 0;
+        return data_len;
+    }
+    if (slot->parity_received >= HARQ_ROOTS) {
+        slot->in_use = 0;
+        return -1;
+    }
+    *next_rv = rv + 1;
+    return 0;
+}
+
+void write_fx25_hex(FILE* output, const uint8_t* frame, int length, int packet_num) {
+    fprintf(output, "FX.25 Packet %d (%d bytes):\n", packet_num, length);
+
+    fprintf(output, "Correlation Tag: ");
+    for (int i = 0; i < CORRELATION_TAG_SIZE; i++) {
+        fprintf(output, "%02X ", frame[i]);
+    }
+    fprintf(output, "\n");
+    
+    // RS codeword 
+    fprintf(output, "RS Codeword:\n");
+    for (int i = CORRELATION_TAG_SIZE; i < length; i++) {
+        fprintf(output, "%02X ", frame[i]);
+        if ((i - CORRELATION_TAG_SIZE + 1) % 16 == 0) {
+            fprintf(output, "\n");
+        }
+    }
+    if ((length - CORRELATION_TAG_SIZE) % 16 != 0) {
+        fprintf(output, "\n");
+    }
+    fprintf(output, "\n");
+}
+
+void write_il2p_hex(FILE* output, const uint8_t* frame, int length, int packet_num) {
+    fprintf(output, "IL2P Packet %d (%d bytes):\n", packet_num, length);
+
+    fprintf(output, "Sync Word: ");
+    for (int i = 0; i < IL2P_SYNC_WORD_SIZE; i++) {
+        fprintf(output, "%02X ", frame[i]);
+    }
+    fprintf(output, "\n");
+
+    fprintf(output, "Header: ");
+    for (int i = IL2P_SYNC_WORD_SIZE; i < IL2P_SYNC_WORD_SIZE + IL2P_HEADER_SIZE + IL2P_HEADER_PARITY; i++) {
+        fprintf(output, "%02X ", frame[i]);
+    }
+    fprintf(output, "\n");
+
+    // Payload blocks with parity
+    int start = IL2P_SYNC_WORD_SIZE + IL2P_HEADER_SIZE + IL2P_HEADER_PARITY;
+    fprintf(output, "Payload:\n");
+    for (int i = start; i < length; i++) {
+        fprintf(output, "%02X ", frame[i]);
+        if ((i - start + 1) % 16 == 0) {
+            fprintf(output, "\n");
+        }
+    }
+    if ((length - start) % 16 != 0) {
+        fprintf(output, "\n");
+    }
+    fprintf(output, "\n");
+}
+
+void write_harq_hex(FILE* output, const uint8_t* segment, int length, int packet_num) {
+    fprintf(output, "HARQ Segment %d (%d bytes):\n", packet_num, length);
+    fprintf(output, "Frame ID: %d, Redundancy Version: %d, Data Length: %d\n",
+            (segment[0] << 8) | segment[1], segment[2], segment[3]);
+
+    fprintf(output, "Payload:\n");
+    for (int i = HARQ_HEADER_SIZE; i < length; i++) {
+        fprintf(output, "%02X ", segment[i]);
+        if ((i - HARQ_HEADER_SIZE + 1) % 16 == 0) {
+            fprintf(output, "\n");
+        }
+    }
+    if ((length - HARQ_HEADER_SIZE) % 16 != 0) {
+        fprintf(output, "\n");
+    }
+    fprintf(output, "\n");
+}
+
+// FX.25, IL2P or HARQ frame as one capture record; the capture's link type says which
+void write_codeblock_pcap(FILE* output, const uint8_t* frame, int length, int packet_num) {
+    (void)packet_num;
+    pcap_write_record(output, PCAP_CLASSIC, realtime_ns(), NULL, 0, frame, length);
+}
+
+void write_codeblock_pcapng(FILE* output, const uint8_t* frame, int length, int packet_num) {
+    (void)packet_num;
+    pcap_write_record(output, PCAP_NG, realtime_ns(), NULL, 0, frame, length);
+}
+
+/*
+ * HARQ link simulation: a frame is sent as successive redundancy versions
+ * over a channel that corrupts each payload byte with probability
+ * 'error_rate', and the receiver asks for the next version until the frame decodes or
+ * the mother code is used up. Segments are written to 'output' (if given)
+ * as the receiver got them. Returns the number of segments sent, or -1 if
+ * the frame cannot be encoded.
+ */
+typedef struct {
+    unsigned long frames, decoded, failed;
+    unsigned long segments, check_bytes;  // Sent, over all frames
+} harq_link_stats_t;
+
+static int harq_link_frame(fx25_config_t* config, harq_rx_t* rx, uint16_t frame_id, const uint8_t* ax25_packet,
+                           int ax25_len, double error_rate, FILE* output, pcap_format_t format, uint64_t ts_ns,
+                           harq_link_stats_t* link) {
+    harq_tx_t tx;
+    uint8_t segment[HARQ_HEADER_SIZE + N];
+    uint8_t data[N];
+    int rv = 0, result = 0, sent = 0;
+
+    if (harq_encode(config, &tx, frame_id, ax25_packet, ax25_len) < 0) {
+        return -1;
+    }
+    link->frames++;
+    while (result == 0) {
+        int sent_rv = rv;
+        int length = harq_segment(&tx, rv, segment);
+        if (length == 0) {
+            result = -1;
+            break;
+        }
+        for (int i = HARQ_HEADER_SIZE; i < length; i++) {
+            if (rand() < error_rate * RAND_MAX) {
+                segment[i] ^= 1 + rand() % 255;
+            }
+        }
+        sent++;
+        link->segments++;
+        link->check_bytes += harq_parity_after(sent_rv) - (sent_rv ? harq_parity_after(sent_rv - 1) : 0);
+        if (output) {
+            pcap_write_record(output, format, ts_ns, NULL, 0, segment, length);
+        }
+        result = harq_receive(config, rx, segment, length, data, &rv);
+    }
+
+    if (result == ax25_len && memcmp(data, ax25_packet, ax25_len) == 0) {
+        link->decoded++;
+    } else {
+        link->failed++;
+    }
+    return sent;
+}
+
+/*
+ * Replay driver: every record of a capture goes through the FEC pipeline
+ * straight from the mapped file. AX.25 (KISS) records are encoded for the
+ * channel, FX.25, IL2P and HARQ records are decoded back to AX.25 (all the
+ * frames of an aggregated codeblock). With 'realtime' each record is held
+ * until its offset from the first one has passed; otherwise records go as
+ * fast as the coder takes them. With 'comb', FX.25 records go through
+ * the diversity combiner, so repeated copies that fail alone can decode
+ * together. With 'ctrl', FX.25 decode results feed the adaptive FEC
+ * controller and AX.25 records are encoded with the strength it picks for
+ * their destination. With 'harq_error_rate' >= 0, AX.25 records are sent
+ * over the simulated HARQ link instead. With 'agg', AX.25 records are packed
+ * into aggregated FX.25 codeblocks on the capture's clock: a block goes out
+ * when it fills up, or when its oldest frame has waited out the budget before
+ * the next record arrives (in real time, while replay is idle waiting for it).
+ * Results of the kind of the first record are written to 'output_file' if given.
+ */
+typedef struct {
+    unsigned long records, encoded, decoded, failed, skipped;
+    unsigned long corrected;    // RS symbols corrected while decoding
+    uint64_t bytes;             // Record bytes fed to the pipeline
+    uint64_t max_late_ns;       // Realtime: furthest behind the recorded timing
+} replay_stats_t;
+
+static void replay_wait(uint64_t due_ns, replay_stats_t* stats) {
+    uint64_t now = monotonic_ns();
+    if (now >= due_ns) {
+        if (now - due_ns > stats->max_late_ns) {
+            stats->max_late_ns = now - due_ns;
+        }
+        return;
+    }
+    struct timespec ts = { due_ns / 1000000000ull, due_ns % 1000000000ull };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+// Counts an aggregated codeblock emitted at 'ts_ns' and writes it to 'output' if given
+static void replay_send_block(FILE* output, pcap_format_t format, uint64_t ts_ns, const uint8_t* frame,
+                              int length, unsigned long* blocks) {
+    if (length <= 0) {
+        return;
+    }
+    (*blocks)++;
+    if (output) {
+        pcap_write_record(output, format, ts_ns, NULL, 0, frame, length);
+    }
+}
+
+int replay_capture(fx25_config_t* config, int channel, const char* capture, int realtime, int loops,
+                   combiner_t* comb, fec_controller_t* ctrl, fx25_aggregator_t* agg, double harq_error_rate,
+                   const char* output_file, pcap_format_t format) {
+    static const uint8_t kiss = KISS_DATA_FRAME;
+    int il2p = (config->channels[channel].mode == FEC_MODE_IL2P);
+    uint32_t encoded_type = (harq_error_rate >= 0) ? LINKTYPE_HARQ : il2p ? LINKTYPE_IL2P : LINKTYPE_FX25;
+    pcap_reader_t reader;
+    pcap_record_t rec;
+    replay_stats_t stats = { 0 };
+    fx25_rx_stats_t rx = { 0 };
+    unsigned long held = 0;      // Copies kept by the combiner for more to arrive
+    unsigned long strength[FX25_RS_SIZES] = { 0 };  // Adaptive: frames encoded per check byte count
+    harq_link_stats_t link = { 0 };
+    unsigned long harq_requests = 0;  // HARQ records that left their frame short of redundancy
+    unsigned long blocks = 0;         // Aggregated codeblocks sent
+    harq_rx_t harq_rx;
+    FILE* output = NULL;
+
+    if (pcap_open(&reader, capture) < 0) {
+        return 1;
+    }
+    size_t start_pos = reader.pos;
+
+    // Encoding an AX.25 capture gives codeblocks, anything else gives AX.25
+    uint32_t output_type = LINKTYPE_AX25_KISS;
+    pcap_reader_t peek = reader;
+    if (pcap_next(&peek, &rec) > 0 && rec.linktype == LINKTYPE_AX25_KISS) {
+        output_type = encoded_type;
+    }
+    if (output_file && !(output = pcap_create(output_file, format, output_type))) {
+        pcap_close(&reader);
+        return 1;
+    }
+    FILE* block_output = (output_type == encoded_type) ? output : NULL;
+    harq_rx_init(&harq_rx);
+    srand(1);   // The same simulated link errors on every run
+
+    uint64_t started = monotonic_ns();
+    for (int loop = 0; loop < loops; loop++) {
+        uint64_t base = monotonic_ns(), first_ts = 0, last_ts = 0;
+        uint8_t frame[MAX_FRAME_SIZE];
+        int first = 1;
+        int result;
+
+        reader.pos = start_pos;
+        while ((result = pcap_next(&reader, &rec)) > 0) {
+            uint8_t ax25[AGGREGATE_MAX_FRAMES][MAX_FRAME_SIZE];
+            int ax25_len[AGGREGATE_MAX_FRAMES];
+            int length, count = 1, corrected = 0;
+
+            // The budget of the queued block may run out before this record arrives
+            uint64_t budget_end = agg ? (uint64_t)(agg->first_ms + agg->budget_ms) * 1000000 : 0;
+            if (agg && agg->frame_count > 0 && budget_end <= rec.ts_ns) {
+                if (realtime) {
+                    replay_wait(base + (budget_end > first_ts ? budget_end - first_ts : 0), &stats);
+                }
+                length = fx25_aggregator_poll(config, agg, budget_end / 1000000, frame);
+                replay_send_block(block_output, format, budget_end, frame, length, &blocks);
+            }
+            last_ts = rec.ts_ns;
+            if (realtime) {
+                if (first) {
+                    first_ts = rec.ts_ns;
+                    first = 0;
+                }
+                replay_wait(base + (rec.ts_ns > first_ts ? rec.ts_ns - first_ts : 0), &stats);
+            }
+            uint32_t id = stats.records++;
+            stats.bytes += rec.length;
+            trace_begin(TRACE_FRAME, id);
+
+            if (rec.linktype == LINKTYPE_AX25_KISS) {
+                trace_begin(TRACE_DEMOD, id);
+                length = ax25_frame_from_kiss(rec.data, rec.length, ax25[0]);
+                trace_end(TRACE_DEMOD, id);
+                if (length < 0) {
+                    stats.skipped++;
+                    trace_end(TRACE_FRAME, id);
+                    continue;
+                }
+                trace_begin(TRACE_FX25_ENCODE, id);
+                if (harq_error_rate >= 0) {
+                    length = harq_link_frame(config, &harq_rx, id, ax25[0], length, harq_error_rate,
+                                             output_type == encoded_type ? output : NULL, format, rec.ts_ns, &link);
+                } else if (ctrl && !il2p) {
+                    length = encode_for_peer(config, ctrl, ax25[0], length, frame);
+                } else if (agg) {
+                    // Queued; the block comes out here only when this frame fills it
+                    length = fx25_aggregator_add(config, agg, ax25[0], length, rec.ts_ns / 1000000, frame);
+                    replay_send_block(block_output, format, rec.ts_ns, frame, length, &blocks);
+                    length = length < 0 ? -1 : 1;
+                } else {
+                    length = encode_for_channel(config, channel, ax25[0], length, frame);
+                }
+                trace_end(TRACE_FX25_ENCODE, id);
+                if (length <= 0) {
+                    stats.failed++;
+                    trace_end(TRACE_FRAME, id);
+                    continue;
+                }
+                if (ctrl && !il2p) {
+                    strength[fx25_rs_index(fx25_frame_nroots(frame, length))]++;
+                }
+                stats.encoded++;
+                metrics_add(METRIC_FRAMES_ENCODED, 1);
+                if (output && output_type == encoded_type && harq_error_rate < 0 && !agg) {
+                    trace_begin(TRACE_MODULATE, id);
+                    pcap_write_record(output, format, rec.ts_ns, NULL, 0, frame, length);
+                    trace_end(TRACE_MODULATE, id);
+                }
+                trace_end(TRACE_FRAME, id);
+                continue;
+            }
+
+            trace_begin(TRACE_RS_DECODE, id);
+            if (rec.linktype == LINKTYPE_FX25 && comb) {
+                ax25_len[0] = combiner_add(config, comb, rec.data, rec.length, NULL, ax25[0], &corrected);
+                count = ax25_len[0] > 0;
+            } else if (rec.linktype == LINKTYPE_FX25 && ctrl) {
+                count = decode_fx25_frames_from_peer(config, ctrl, rec.data, rec.length, ax25, ax25_len,
+                                                     AGGREGATE_MAX_FRAMES);
+            } else if (rec.linktype == LINKTYPE_FX25) {
+                count = decode_fx25_frames(config, rec.data, rec.length, ax25, ax25_len,
+                                           AGGREGATE_MAX_FRAMES, &corrected, &rx);
+            } else if (rec.linktype == LINKTYPE_IL2P) {
+                ax25_len[0] = decode_il2p(config, rec.data, rec.length, ax25[0]);
+                count = ax25_len[0] >= 4;
+            } else if (rec.linktype == LINKTYPE_HARQ) {
+                int next_rv;
+                ax25_len[0] = harq_receive(config, &harq_rx, rec.data, rec.length, ax25[0], &next_rv);
+                count = ax25_len[0] >= 4;
+            } else {
+                stats.skipped++;
+                trace_end(TRACE_RS_DECODE, id);
+                trace_end(TRACE_FRAME, id);
+                continue;
+            }
+            trace_end(TRACE_RS_DECODE, id);
+            if (rec.linktype == LINKTYPE_HARQ && ax25_len[0] == 0) {
+                // Not decodable yet; the sender's next redundancy version may be further on
+                harq_requests++;
+                trace_end(TRACE_FRAME, id);
+                continue;
+            }
+            if (comb && rec.linktype == LINKTYPE_FX25 &&
+                (ax25_len[0] == COMBINE_PENDING || ax25_len[0] == COMBINE_DUPLICATE)) {
+                // Not a failure: held for the next copy, or a frame already delivered
+                held += ax25_len[0] == COMBINE_PENDING;
+                trace_end(TRACE_FRAME, id);
+                continue;
+            }
+            if (count == 0) {
+                stats.failed++;
+                metrics_add(METRIC_FRAMES_FAILED, 1);
+                trace_end(TRACE_FRAME, id);
+                continue;
+            }
+            // An aggregated codeblock gives several frames
+            stats.decoded += count;
+            metrics_add(METRIC_FRAMES_DECODED, count);
+            stats.corrected += corrected;
+            for (int f = 0; f < count && output && output_type == LINKTYPE_AX25_KISS; f++) {
+                pcap_write_record(output, format, rec.ts_ns, &kiss, 1, ax25[f] + 1, ax25_len[f] - 4);
+            }
+            trace_end(TRACE_FRAME, id);
+        }
+        if (agg) {
+            // End of the capture: send the last, partly filled block
+            replay_send_block(block_output, format, last_ts, frame, fx25_aggregator_flush(config, agg, frame),
+                              &blocks);
+        }
+        if (result < 0) {
+            printf("Warning: Capture %s is damaged after %lu records\n", capture, stats.records);
+            break;
+        }
+    }
+    double seconds = (monotonic_ns() - started) / 1e9;
+    pcap_close(&reader);
+
+    int write_error = 0;
+    if (output) {
+        write_error = fclose(output) != 0;
+    }
+
+    printf("Replayed %lu records of %s in %.3f s: %lu encoded, %lu decoded, %lu failed, %lu skipped\n",
+           stats.records, capture, seconds, stats.encoded, stats.decoded, stats.failed, stats.skipped);
+    if (seconds > 0) {
+        printf("Throughput: %.0f frames/s, %.2f MB/s\n", stats.records / seconds, stats.bytes / seconds / 1e6);
+    }
+    if (rx.fast_accepted + rx.rs_decoded + rx.repaired + rx.failed > 0) {
+        printf("FX.25 receive: %lu fast-accepted, %lu RS decoded, %lu repaired, %lu symbols corrected\n",
+               rx.fast_accepted, rx.rs_decoded, rx.repaired, stats.corrected);
+    }
+    if (rx.aggregates > 0) {
+        printf("FX.25 receive: %lu aggregated codeblocks split into frames\n", rx.aggregates);
+    }
+    if (agg) {
+        printf("Aggregation: %lu AX.25 frames sent in %lu codeblocks\n", stats.encoded, blocks);
+    }
+    if (comb) {
+        printf("Combiner: %lu decoded from one copy, %lu from combined copies, %lu duplicate copies, "
+               "%lu copies held for combining\n",
+               comb->decoded_single, comb->decoded_combined, comb->duplicates, held);
+    }
+    if (ctrl) {
+        printf("Adaptive FEC: %lu frames encoded with 16 check bytes, %lu with 32, %lu with 64\n",
+               strength[0], strength[1], strength[2]);
+        fec_controller_summary(ctrl);
+    }
+    if (link.frames > 0) {
+        printf("HARQ link, %.1f%% byte errors: %lu frames, %lu decoded, %lu failed, "
+               "%.2f segments and %.1f of %d check bytes sent per frame\n",
+               harq_error_rate * 100, link.frames, link.decoded, link.failed, (double)link.segments / link.frames,
+               (double)link.check_bytes / link.frames, HARQ_ROOTS);
+    }
+    if (harq_requests > 0) {
+        printf("HARQ receive: %lu segments left their frame needing more redundancy\n", harq_requests);
+    }
+    if (realtime) {
+        printf("Realtime replay: at most %.3f ms behind the recorded timing\n", stats.max_late_ns / 1e6);
+    }
+    if (write_error) {
+        printf("Error: Cannot write %s\n", output_file);
+        return 1;
+    }
+    if (output) {
+        printf("Results written to %s\n", output_file);
+    }
+    return 0;
+}
+
+/*
+ * Digipeater over a capture: each record (AX.25, or FX.25 / IL2P to be
+ * decoded first, as for replay) is offered to digipeat(), and the frames it
+ * repeats are encoded for 'channel' and written to 'output_file', as a
+ * capture when 'as_capture' is set and as hex text otherwise. Records are
+ * heard at their capture timestamps (or in real time with 'realtime'), and
+ * each further loop is heard one dedupe window after the previous one ends.
+ */
+int digipeat_capture(fx25_config_t* config, int channel, digipeater_t* digi, const char* capture,
+                     int realtime, int loops, const char* output_file, int as_capture, pcap_format_t format) {
+    int il2p = (config->channels[channel].mode == FEC_MODE_IL2P);
+    pcap_reader_t reader;
+    pcap_record_t rec;
+    replay_stats_t stats = { 0 };
+    FILE* output;
+
+    if (pcap_open(&reader, capture) < 0) {
+        return 1;
+    }
+    if (as_capture) {
+        output = pcap_create(output_file, format, il2p ? LINKTYPE_IL2P : LINKTYPE_FX25);
+    } else if (!(output = fopen(output_file, "w"))) {
+        printf("Error: Cannot create %s\n", output_file);
+    }
+    if (!output) {
+        pcap_close(&reader);
+        return 1;
+    }
+
+    // Length of the capture in time plus the longest the dedupe cache can
+    // remember, so every loop is heard as new traffic
+    size_t start_pos = reader.pos;
+    uint64_t first_ts = UINT64_MAX, last_ts = 0;
+    while (pcap_next(&reader, &rec) > 0) {
+        first_ts = rec.ts_ns < first_ts ? rec.ts_ns : first_ts;
+        last_ts = rec.ts_ns > last_ts ? rec.ts_ns : last_ts;
+    }
+    uint64_t loop_ns = (last_ts >= first_ts ? last_ts - first_ts : 0) +
+                       digi->dedupe->bucket_ns * DEDUPE_BUCKETS;
+
+    unsigned long undecodable = 0;
+    int sent = 0;
+    uint64_t started = monotonic_ns();
+    for (int loop = 0; loop < loops; loop++) {
+        int result;
+        reader.pos = start_pos;
+        while ((result = pcap_next(&reader, &rec)) > 0) {
+            uint8_t ax25[AGGREGATE_MAX_FRAMES][MAX_FRAME_SIZE];
+            int ax25_len[AGGREGATE_MAX_FRAMES];
+            uint8_t repeat[AX25_MAX_FRAME];
+            uint8_t frame[MAX_FRAME_SIZE];
+            int count, length, repeat_len, corrected;
+
+            uint32_t id = stats.records++;
+            stats.bytes += rec.length;
+            trace_begin(TRACE_FRAME, id);
+
+            trace_begin(TRACE_RS_DECODE, id);
+            if (rec.linktype == LINKTYPE_AX25_KISS) {
+                ax25_len[0] = ax25_frame_from_kiss(rec.data, rec.length, ax25[0]);
+                count = ax25_len[0] >= 4;
+            } else if (rec.linktype == LINKTYPE_FX25) {
+                count = decode_fx25_frames(config, rec.data, rec.length, ax25, ax25_len,
+                                           AGGREGATE_MAX_FRAMES, &corrected, NULL);
+            } else if (rec.linktype == LINKTYPE_IL2P) {
+                ax25_len[0] = decode_il2p(config, rec.data, rec.length, ax25[0]);
+                count = ax25_len[0] >= 4;
+            } else {
+                stats.skipped++;
+                trace_end(TRACE_RS_DECODE, id);
+                trace_end(TRACE_FRAME, id);
+                continue;
+            }
+            trace_end(TRACE_RS_DECODE, id);
+            if (count == 0) {
+                undecodable++;
+                if (rec.linktype != LINKTYPE_AX25_KISS) {
+                    metrics_add(METRIC_FRAMES_FAILED, 1);
+                }
+                trace_end(TRACE_FRAME, id);
+                continue;
+            }
+            if (rec.linktype != LINKTYPE_AX25_KISS) {
+                metrics_add(METRIC_FRAMES_DECODED, count);
+            }
+
+            // Every frame of an aggregated codeblock is offered on its own
+            uint64_t heard = realtime ? monotonic_ns() : rec.ts_ns + loop * loop_ns;
+            for (int f = 0; f < count; f++) {
+                trace_begin(TRACE_FRAME_BUILD, id);
+                digi_result_t verdict = digipeat(digi, ax25[f], ax25_len[f], heard, repeat, &repeat_len);
+                trace_end(TRACE_FRAME_BUILD, id);
+                if (verdict == DIGI_DUPLICATE) {
+                    metrics_add(METRIC_FRAMES_DUPLICATE, 1);
+                }
+                if (verdict != DIGI_REPEAT) {
+                    continue;
+                }
+                metrics_add(METRIC_FRAMES_DIGIPEATED, 1);
+
+                trace_begin(TRACE_FX25_ENCODE, id);
+                length = encode_for_channel(config, channel, repeat, repeat_len, frame);
+                trace_end(TRACE_FX25_ENCODE, id);
+                if (length <= 0) {
+                    stats.failed++;
+                    continue;
+                }
+                stats.encoded++;
+                metrics_add(METRIC_FRAMES_ENCODED, 1);
+
+                trace_begin(TRACE_MODULATE, id);
+                if (as_capture) {
+                    pcap_write_record(output, format, realtime ? realtime_ns() : heard, NULL, 0, frame, length);
+                } else if (il2p) {
+                    write_il2p_hex(output, frame, length, sent);
+                } else {
+                    write_fx25_hex(output, frame, length, sent);
+                }
+                sent++;
+                trace_end(TRACE_MODULATE, id);
+            }
+            trace_end(TRACE_FRAME, id);
+        }
+        if (result < 0) {
+            printf("Warning: Capture %s is damaged after %lu records\n", capture, stats.records);
+            break;
+        }
+    }
+    double seconds = (monotonic_ns() - started) / 1e9;
+    pcap_close(&reader);
+    int write_error = fclose(output) != 0;
+
+    printf("Digipeater %s-%d heard %lu records of %s in %.3f s\n", digi->self.call, digi->self.ssid,
+           stats.records, capture, seconds);
+    printf("  %lu repeated, %lu duplicates, %lu not for us, %lu invalid, %lu undecodable, %lu not encodable\n",
+           digi->results[DIGI_REPEAT], digi->results[DIGI_DUPLICATE], digi->results[DIGI_NOT_FOR_US],
+           digi->results[DIGI_INVALID], undecodable, stats.failed);
+    if (seconds > 0) {
+        printf("Throughput: %.0f frames/s\n", stats.records / seconds);
+    }
+    if (digi->dedupe->evicted > 0) {
+        printf("Dedupe cache: %lu digests evicted early (cache full)\n", digi->dedupe->evicted);
+    }
+    if (write_error) {
+        printf("Error: Cannot write %s\n", output_file);
+        return 1;
+    }
+    printf("Results written to %s\n", output_file);
+    return 0;
+}
+
+/*
+ * Numbered beacons: the frame is built and encoded once, then every further
+ * beacon only patches its sequence number, FCS and (for FX.25) RS parity.
+ */
+int write_beacons(fx25_config_t* config, int channel, const char* message, int count, const char* output_file) {
+    ax25_config_t ax25_config = {
+        .source_call = "N0CALL",
+        .dest_call = "CQ",
+        .source = 0,
+        .dest = 0,
+    };
+    int il2p = (config->channels[channel].mode == FEC_MODE_IL2P);
+
+    frame_template_t beacon;
+    if (create_beacon_template(&ax25_config, message, &beacon) < 0) {
+        printf("Error: Beacon message too long (at most %d bytes)\n", frame_max_payload(&ax25_config, BEACON_FRAME));
+        return 1;
+    }
+
+    fx25_template_cache_t* cache = calloc(1, sizeof(fx25_template_cache_t));
+    fx25_template_t* tmpl = cache ? fx25_template_insert(config, cache, 0, &beacon) : NULL;
+    if (!tmpl) {
+        printf("Error: Failed to create beacon template\n");
+        free(cache);
+        return 1;
+    }
+
+    FILE* output = fopen(output_file, "w");
+    if (!output) {
+        printf("Error: Cannot create %s\n", output_file);
+        free(cache);
+        return 1;
+    }
+
+    for (int seq = 0; seq < count; seq++) {
+        trace_begin(TRACE_FRAME, seq);
+        if (il2p) {
+            // IL2P scrambles the payload, so only the FCS is patched incrementally
+            uint8_t frame[MAX_FRAME_SIZE];
+            trace_begin(TRACE_FX25_ENCODE, seq);
+            frame_template_set_sequence(&beacon, seq);
+            int length = encode_for_channel(config, channel, beacon.frame, beacon.length, frame);
+            trace_end(TRACE_FX25_ENCODE, seq);
+            trace_begin(TRACE_MODULATE, seq);
+            write_il2p_hex(output, frame, length, seq);
+            trace_end(TRACE_MODULATE, seq);
+        } else {
+            trace_begin(TRACE_FX25_ENCODE, seq);
+            fx25_template_set_sequence(config, tmpl, seq);
+            trace_end(TRACE_FX25_ENCODE, seq);
+            trace_begin(TRACE_MODULATE, seq);
+            write_fx25_hex(output, tmpl->frame, tmpl->length, seq);
+            trace_end(TRACE_MODULATE, seq);
+        }
+        metrics_add(METRIC_FRAMES_ENCODED, 1);
+        trace_end(TRACE_FRAME, seq);
+    }
+
+    fclose(output);
+    free(cache);
+
+    printf("Successfully created %d beacon frames\n", count);
+    printf("Results written to %s\n", output_file);
+    return 0;
+}
+
+// The pipeline benchmark reuses this file with FX25_NO_MAIN defined
+#ifndef FX25_NO_MAIN
+// Sends an encoded frame through the burst scheduler if there is one, else straight to the writer
+static void send_encoded(burst_scheduler_t* burst, frame_writer_t writer, FILE* output,
+                         const uint8_t* frame, int length, int* count) {
+    if (burst) {
+        burst_queue(burst, output, frame, length);
+    } else {
+        writer(output, frame, length, *count);
+    }
+    metrics_add(METRIC_FRAMES_ENCODED, 1);
+    (*count)++;
+}
+
+int main(int argc, char* argv[]) {
+    const char* input_file = "packets.txt";
+    const char* output_file = "fx25_packets.txt";
+    int channel = 0;
+    int beacon_count = 0;
+    const char* beacon_message = NULL;
+    int aggregate = 0;
+    int fcs_check = 0;
+    int burst_max_ms = 0;
+    int ring_fd = -1;
+    const char* pcap_input = NULL;
+    const char* pcap_output = NULL;
+    pcap_format_t pcap_format = PCAP_CLASSIC;
+    const char* replay_file = NULL;
+    int realtime = 0;
+    int loops = 1;
+    int combine = 0;
+    int adaptive = 0;
+    int harq = 0;
+    double harq_error_rate = -1;
+    const char* trace_file = NULL;
+    int latency = 0;
+    const char* metrics_address = NULL;
+    ax25_address_t digi_call;
+    int digipeater = 0;
+    ax25_address_t aliases[DIGI_MAX_ALIASES];
+    int alias_count = 0;
+    long dedupe_ms = DIGI_DEFAULT_DEDUPE_MS;
+    int max_hops = DIGI_DEFAULT_MAX_HOPS;
+            
+    fx25_config_t* config = fx25_init();
+    if (!config) {
+        printf("Error: Failed to initialize FX.25 configuration\n");
+        return 1;
+    }
+
+    // Usage: [--channel N] [--mode fx25|il2p] [--baseline-fec] [--beacons COUNT MESSAGE] [--aggregate]
+    //        [--burst MAX_MS] [--ring-fd FD] [--fcs-check] [--harq] [--pcap-in FILE] [--pcap FILE | --pcapng FILE]
+    //        [--replay FILE [--realtime] [--loops N] [--combine] [--adaptive] [--harq-link PERCENT]]
+    //        [--trace FILE] [--latency]
+    //        [--metrics PORT|IP:PORT|unix:PATH]
+    //        [--digipeat CALL[-SSID] [--alias CALL[-SSID]]... [--max-hops N] [--dedupe-ms MS]]
+    //   --harq writes the first HARQ transmission of each frame (data and 16 check bytes)
+    //     instead of FX.25; replay decodes captures of HARQ segments
+    //   --aggregate packs several AX.25 frames into each FX.25 codeblock; a block goes out when
+    //     full or once its oldest frame has waited 100 ms for company, going by when the frames
+    //     arrived on the ring or in the capture (packets.txt frames all arrive at once)
+    //   --fcs-check repairs input frames with a bad FCS as the FX.25 receive path does (a bit
+    //     error or two) and drops the ones it cannot fix; by default frames are encoded as read
+    //   --pcap-in reads the AX.25 frames from a LINKTYPE_AX25_KISS capture instead of packets.txt
+    //   --pcap / --pcapng write the frames as a capture instead of hex text
+    //   --replay pushes a capture through the encoder or decoder and reports the throughput
+    //   --combine decodes the replayed FX.25 frames with the diversity combiner, so repeated
+    //     copies of a frame that fail alone are decoded together
+    //   --adaptive picks the FX.25 strength for each replayed AX.25 frame from how well the
+    //     FX.25 frames replayed so far from its destination decoded (not with --combine)
+    //   --harq-link sends the replayed AX.25 frames over a simulated HARQ link that corrupts
+    //     PERCENT of the bytes, asking for more check bytes until each frame decodes
+    //   --trace writes the pipeline trace events to FILE, --latency prints the stage latencies
+    //   --metrics serves Prometheus metrics at /metrics while the program runs
+    //   --digipeat repeats the frames of the --replay capture whose via path asks for CALL, an
+    //     --alias or a WIDEn-N hop (n up to --max-hops), once per --dedupe-ms window
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--channel") == 0 && i + 1 < argc) {
+            channel = atoi(argv[++i]);
+            if (channel < 0 || channel >= MAX_CHANNELS) {
+                printf("Error: Channel must be 0..%d\n", MAX_CHANNELS - 1);
+                fx25_cleanup(config);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "fx25") == 0) {
+                config->channels[channel].mode = FEC_MODE_FX25;
+            } else if (strcmp(argv[i], "il2p") == 0) {
+                config->channels[channel].mode = FEC_MODE_IL2P;
+            } else {
+                printf("Error: Unknown mode %s, expected fx25 or il2p\n", argv[i]);
+                fx25_cleanup(config);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--baseline-fec") == 0) {
+            config->channels[channel].il2p_max_fec = 0;
+        } else if (strcmp(argv[i], "--beacons") == 0 && i + 2 < argc) {
+            beacon_count = atoi(argv[++i]);
+            beacon_message = argv[++i];
+        } else if (strcmp(argv[i], "--aggregate") == 0) {
+            aggregate = 1;
+        } else if (strcmp(argv[i], "--fcs-check") == 0) {
+            fcs_check = 1;
+        } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            burst_max_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ring-fd") == 0 && i + 1 < argc) {
+            ring_fd = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pcap-in") == 0 && i + 1 < argc) {
+            pcap_input = argv[++i];
+        } else if ((strcmp(argv[i], "--pcap") == 0 || strcmp(argv[i], "--pcapng") == 0) && i + 1 < argc) {
+            pcap_format = (strcmp(argv[i], "--pcap") == 0) ? PCAP_CLASSIC : PCAP_NG;
+            pcap_output = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_file = argv[++i];
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = 1;
+        } else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--combine") == 0) {
+            combine = 1;
+        } else if (strcmp(argv[i], "--adaptive") == 0) {
+            adaptive = 1;
+        } else if (strcmp(argv[i], "--harq") == 0) {
+            harq = 1;
+        } else if (strcmp(argv[i], "--harq-link") == 0 && i + 1 < argc) {
+            harq_error_rate = atof(argv[++i]) / 100;
+            harq_error_rate = harq_error_rate < 0 ? 0 : harq_error_rate;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            latency = 1;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_address = argv[++i];
+        } else if ((strcmp(argv[i], "--digipeat") == 0 || strcmp(argv[i], "--alias") == 0) && i + 1 < argc) {
+            int alias = (strcmp(argv[i], "--alias") == 0);
+            ax25_address_t* address = alias ? &aliases[alias_count] : &digi_call;
+            if ((alias && alias_count == DIGI_MAX_ALIASES) || parse_callsign(argv[i + 1], address) < 0) {
+                printf("Error: Invalid callsign %s for %s\n", argv[i + 1], argv[i]);
+                fx25_cleanup(config);
+                return 1;
+            }
+            alias_count += alias;
+            digipeater |= !alias;
+            i++;
+        } else if (strcmp(argv[i], "--max-hops") == 0 && i + 1 < argc) {
+            max_hops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dedupe-ms") == 0 && i + 1 < argc) {
+            dedupe_ms = atol(argv[++i]);
+        }
+    }
+    if (trace_start(trace_file) < 0 || (metrics_address && metrics_start(metrics_address) < 0)) {
+        trace_stop(0);
+        fx25_cleanup(config);
+        return 1;
+    }
+    int il2p = (config->channels[channel].mode == FEC_MODE_IL2P) && !harq;
+    if (il2p) {
+        output_file = "il2p_packets.txt";
+    } else if (harq) {
+        output_file = "harq_segments.txt";
+    }
+
+    if (beacon_count > 0) {
+        int result = write_beacons(config, channel, beacon_message, beacon_count, output_file);
+        metrics_stop();
+        trace_stop(latency);
+        fx25_cleanup(config);
+        return result;
+    }
+    if (digipeater) {
+        digipeater_t digi;
+        int result = 1;
+        if (!replay_file) {
+            printf("Error: --digipeat needs the received frames as a capture (--replay FILE)\n");
+        } else if (digi_init(&digi, &digi_call, dedupe_ms) < 0) {
+            printf("Error: Cannot allocate the dedupe cache\n");
+        } else {
+            digi.max_hops = max_hops;
+            for (int i = 0; i < alias_count; i++) {
+                digi_add_alias(&digi, &aliases[i]);
+            }
+            result = digipeat_capture(config, channel, &digi, replay_file, realtime, loops > 0 ? loops : 1,
+                                      pcap_output ? pcap_output : output_file, pcap_output != NULL, pcap_format);
+            digi_free(&digi);
+        }
+        metrics_stop();
+        trace_stop(latency);
+        fx25_cleanup(config);
+        return result;
+    }
+    if (replay_file) {
+        combiner_t* comb = combine ? malloc(sizeof(combiner_t)) : NULL;
+        fec_controller_t* ctrl = adaptive ? malloc(sizeof(fec_controller_t)) : NULL;
+        int result = 1;
+        if (combine && adaptive) {
+            printf("Error: --combine and --adaptive cannot be used together\n");
+        } else if ((combine && !comb) || (adaptive && !ctrl)) {
+            printf("Error: Cannot allocate the combiner or FEC controller\n");
+        } else {
+            if (comb) {
+                combiner_init(comb);
+            }
+            if (ctrl) {
+                fec_controller_init(ctrl, NULL, NULL);
+            }
+            // Aggregation needs plain FX.25 at the channel's own strength
+            fx25_aggregator_t aggregator;
+            fx25_aggregator_init(&aggregator, AGGREGATE_BUDGET_MS);
+            int aggregated = aggregate && !ctrl && harq_error_rate < 0 &&
+                             config->channels[channel].mode == FEC_MODE_FX25;
+            result = replay_capture(config, channel, replay_file, realtime, loops > 0 ? loops : 1,
+                                    comb, ctrl, aggregated ? &aggregator : NULL, harq_error_rate,
+                                    pcap_output, pcap_format);
+        }
+        free(comb);
+        free(ctrl);
+        metrics_stop();
+        trace_stop(latency);
+        fx25_cleanup(config);
+        return result;
+    }
+    
+    frame_pool_t* pool = frame_pool_create(MAX_PACKETS);
+    frame_buf_t* ax25_packets[MAX_PACKETS];
+    int packet_count = 0;
+    if (pool && ring_fd >= 0) {
+        frame_ring_t ring;
+        if (frame_ring_attach(&ring, ring_fd) == 0) {
+            packet_count = read_ax25_ring(&ring, pool, ax25_packets, MAX_PACKETS);
+            input_file = "frame ring";
+            frame_ring_detach(&ring);
+        }
+    } else if (pool && pcap_input) {
+        input_file = pcap_input;
+        packet_count = read_ax25_pcap(input_file, pool, ax25_packets, MAX_PACKETS);
+    } else if (pool) {
+        packet_count = read_ax25(input_file, pool, ax25_packets, MAX_PACKETS);
+    }
+
+    if (fcs_check) {
+        int repaired, dropped;
+        packet_count = ax25_check_frames(config, ax25_packets, packet_count, &repaired, &dropped);
+        printf("FCS check: %d frames repaired, %d dropped\n", repaired, dropped);
+    }
+
+    if (packet_count <= 0) {
+        printf("Error: No AX.25 packets found in %s\n", input_file);
+        frame_pool_destroy(pool);
+        fx25_cleanup(config);
+        return 1;
+    }
+
+    printf("Read %d AX.25 packets\n", packet_count);
+    
+    if (packet_count > 0) {
+        printf("First packet length: %d bytes\n", ax25_packets[0]->length);
+        printf("First few bytes: ");
+        for (int i = 0; i < 8 && i < ax25_packets[0]->length; i++) {
+            printf("%02X ", frame_buf_data(ax25_packets[0])[i]);
+        }
+        printf("\n");
+    }
+    
+    FILE* output;
+    if (pcap_output) {
+        output_file = pcap_output;
+        output = pcap_create(output_file, pcap_format, harq ? LINKTYPE_HARQ : il2p ? LINKTYPE_IL2P : LINKTYPE_FX25);
+    } else {
+        output = fopen(output_file, "w");
+        if (!output) {
+            printf("Error: Cannot create %s\n", output_file);
+        }
+    }
+    if (!output) {
+        for (int i = 0; i < packet_count; i++) {
+            frame_buf_unref(ax25_packets[i]);
+        }
+        frame_pool_destroy(pool);
+        fx25_cleanup(config);
+        return 1;
+    }
+    
+    int fx25_count = 0;
+    frame_writer_t writer = harq ? write_harq_hex : il2p ? write_il2p_hex : write_fx25_hex;
+    if (pcap_output) {
+        writer = (pcap_format == PCAP_CLASSIC) ? write_codeblock_pcap : write_codeblock_pcapng;
+    }
+    burst_scheduler_t* burst = NULL;
+    if (burst_max_ms > 0) {
+        burst_config_t burst_cfg = {
+            .baud = BURST_BAUD,
+            .txdelay_ms = BURST_TXDELAY_MS,
+            .txtail_ms = BURST_TXTAIL_MS,
+            .max_burst_ms = burst_max_ms,
+            .gap_flags = BURST_GAP_FLAGS,
+        };
+        burst = malloc(sizeof(burst_scheduler_t));
+        if (burst) {
+            burst_init(burst, &burst_cfg, writer);
+            burst->annotate = !pcap_output;
+        }
+    }
+
+    fx25_aggregator_t aggregator;
+    fx25_aggregator_init(&aggregator, AGGREGATE_BUDGET_MS);
+    aggregate = aggregate && !il2p && !harq;
+
+    for (int i = 0; i < packet_count; i++) {
+        uint8_t encoded[512];
+        uint8_t* fx25_frame = encoded;
+        frame_buf_t* buf = ax25_packets[i];
+        int ax25_len = buf->length;
+        
+        int fx25_len;
+        trace_begin(TRACE_FRAME, i);
+        trace_begin(TRACE_FX25_ENCODE, i);
+        if (aggregate) {
+            // A block whose oldest frame waited out the budget before this one
+            // arrived goes first; frames read from a file all arrive together
+            long arrival_ms = buf->arrival_ns / 1000000;
+            uint8_t expired[512];
+            int expired_len = fx25_aggregator_poll(config, &aggregator, arrival_ms, expired);
+            if (expired_len > 0) {
+                send_encoded(burst, writer, output, expired, expired_len, &fx25_count);
+            }
+            fx25_len = fx25_aggregator_add(config, &aggregator, frame_buf_data(buf), ax25_len, arrival_ms,
+                                           fx25_frame);
+        } else if (harq) {
+            // Only the first redundancy version; a live link sends the others on request
+            harq_tx_t tx;
+            fx25_len = (harq_encode(config, &tx, i, frame_buf_data(buf), ax25_len) < 0) ? 0
+                       : harq_segment(&tx, 0, fx25_frame);
+        } else if (!il2p) {
+            fx25_len = generate_fx25_inplace(config, buf);
+            fx25_frame = frame_buf_data(buf);
+        } else {
+            fx25_len = encode_for_channel(config, channel, frame_buf_data(buf), ax25_len, fx25_frame);
+        }
+        trace_end(TRACE_FX25_ENCODE, i);
+        if (aggregate && fx25_len == 0) {
+            trace_end(TRACE_FRAME, i);
+            frame_buf_unref(buf);
+            continue;
+        }
+        
+        if (fx25_len > 0) {
+            trace_begin(TRACE_MODULATE, i);
+            send_encoded(burst, writer, output, fx25_frame, fx25_len, &fx25_count);
+            trace_end(TRACE_MODULATE, i);
+        } else {
+            printf("Warning: Failed to encode packet %d (length: %d bytes)\n", i, ax25_len);
+        }
+        trace_end(TRACE_FRAME, i);
+        frame_buf_unref(buf);
+    }
+
+    if (aggregate) {
+        uint8_t fx25_frame[512];
+        int fx25_len = fx25_aggregator_flush(config, &aggregator, fx25_frame);
+        if (fx25_len > 0) {
+            send_encoded(burst, writer, output, fx25_frame, fx25_len, &fx25_count);
+        }
+        printf("Aggregated %d AX.25 packets into %d codeblocks\n", packet_count, fx25_count);
+    }
+
+    if (burst) {
+        burst_flush(burst, output);
+        burst_report(burst);
+        free(burst);
+    }
+    metrics_stop();
+    trace_stop(latency);
+    
+    fclose(output);
+    frame_pool_destroy(pool);
+    fx25_cleanup(config);
+    
+    printf("Successfully created %d %s frames\n", fx25_count, harq ? "HARQ" : il2p ? "IL2P" : "FX.25");
+    printf("Results written to %s\n", output_file);
+    
+    return 0;
+}
+#endif
@@ -0,0 +1,370 @@
+// Prometheus metrics for the frame pipeline (included by ax25_packet.c)
+//
+// Counters and gauges live in per-thread shards. A thread registers its own
+// cache-line aligned shard the first time it counts something and is the
+// only writer of it, so counting is a relaxed load and store to a line no
+// other thread writes; nothing is shared on the hot path. A scrape sums the
+// shards, adds the per-stage times kept by the trace rings (trace.c) and
+// the CPU time of each counting thread, and renders the Prometheus text
+// format. Rates (frames per second) are left to rate() on the counters.
+//
+// --metrics ADDR serves it from a thread of its own on a local TCP port
+// (PORT, or IP:PORT for an IPv4 address other than loopback) or on a Unix socket
+// (unix:PATH), one request per connection.
+
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define METRICS_MAX_THREADS 64
+#define METRICS_MAX_SYMBOLS 32          // Most symbols RS(255,191) can correct
+#define METRICS_POLL_MS 100             // How often the server looks at its stop flag
+#define METRICS_REQUEST_MAX 4096
+
+typedef enum {
+    METRIC_FRAMES_BUILT = 0,
+    METRIC_FRAMES_ENCODED,
+    METRIC_FRAMES_DECODED,
+    METRIC_FRAMES_FAILED,
+    METRIC_RS_BLOCKS_CORRECTED,
+    METRIC_RS_BLOCKS_FAILED,
+    METRIC_FRAMES_DIGIPEATED,
+    METRIC_FRAMES_DUPLICATE,
+    METRIC_COUNTERS,
+} metric_counter_t;
+
+static const char* METRIC_COUNTER_NAMES[METRIC_COUNTERS][2] = {
+    { "ax25_frames_built_total", "AX.25 frames built by frame_gen" },
+    { "fx25_frames_encoded_total", "FX.25 / IL2P frames encoded for the channel" },
+    { "fx25_frames_decoded_total", "AX.25 frames recovered from received FX.25 / IL2P frames" },
+    { "fx25_frames_failed_total", "Received FX.25 / IL2P frames that could not be decoded" },
+    { "fx25_rs_blocks_corrected_total", "Reed-Solomon blocks decoded with at least one corrected symbol" },
+    { "fx25_rs_blocks_failed_total", "Reed-Solomon blocks with more errors than the code corrects" },
+    { "ax25_frames_digipeated_total", "Frames repeated by the digipeater" },
+    { "ax25_frames_duplicate_total", "Frames for the digipeater dropped as duplicates" },
+};
+
+typedef enum {
+    METRIC_QUEUE_FRAME_RING = 0,        // Frames sent to the ring and not yet received
+    METRIC_QUEUE_BURST,                 // Frames waiting for the next key-up
+    METRIC_QUEUE_AGGREGATOR,            // Frames waiting in a partly filled codeblock
+    METRIC_GAUGES,
+} metric_gauge_t;
+
+static const char* METRIC_QUEUE_NAMES[METRIC_GAUGES] = { "frame ring", "burst", "aggregator" };
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t counters[METRIC_COUNTERS];
+    _Atomic int64_t gauges[METRIC_GAUGES];
+    _Atomic uint64_t symbols[METRICS_MAX_SYMBOLS + 1];  // RS blocks by symbols corrected
+    clockid_t cpu_clock;
+    int has_cpu_clock;
+} metrics_shard_t;
+
+static struct {
+    _Atomic int shard_count;
+    metrics_shard_t* _Atomic shards[METRICS_MAX_THREADS];
+    _Atomic int stop;
+    int listen_fd;
+    int running;
+    char unix_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    pthread_t server;
+} metrics = { .listen_fd = -1 };
+
+static _Thread_local metrics_shard_t* metrics_local;
+
+static metrics_shard_t* metrics_register(void) {
+    int index = atomic_fetch_add(&metrics.shard_count, 1);
+    if (index >= METRICS_MAX_THREADS) {
+        atomic_store(&metrics.shard_count, METRICS_MAX_THREADS);
+        return NULL;
+    }
+    metrics_shard_t* shard = aligned_alloc(64, (sizeof(metrics_shard_t) + 63) & ~(size_t)63);
+    if (!shard) {
+        return NULL;
+    }
+    memset(shard, 0, sizeof(*shard));
+    shard->has_cpu_clock = pthread_getcpuclockid(pthread_self(), &shard->cpu_clock) == 0;
+    atomic_store_explicit(&metrics.shards[index], shard, memory_order_release);
+    metrics_local = shard;
+    return shard;
+}
+
+static inline metrics_shard_t* metrics_shard(void) {
+    return metrics_local ? metrics_local : metrics_register();
+}
+
+static inline void metrics_add(int counter, uint64_t n) {
+    metrics_shard_t* shard = metrics_shard();
+    if (shard) {
+        uint64_t value = atomic_load_explicit(&shard->counters[counter], memory_order_relaxed);
+        atomic_store_explicit(&shard->counters[counter], value + n, memory_order_relaxed);
+    }
+}
+
+// Queue depths are gauges of the thread that owns the queue
+static inline void metrics_set(int gauge, int64_t value) {
+    metrics_shard_t* shard = metrics_shard();
+    if (shard) {
+        atomic_store_explicit(&shard->gauges[gauge], value, memory_order_relaxed);
+    }
+}
+
+// Outcome of one Reed-Solomon decode: symbols corrected, or -1 on failure
+static inline void metrics_rs_block(int corrected) {
+    metrics_shard_t* shard = metrics_shard();
+    if (!shard) {
+        return;
+    }
+    if (corrected < 0) {
+        metrics_add(METRIC_RS_BLOCKS_FAILED, 1);
+        return;
+    }
+    if (corrected > 0) {
+        metrics_add(METRIC_RS_BLOCKS_CORRECTED, 1);
+    }
+    int bucket = corrected < METRICS_MAX_SYMBOLS ? corrected : METRICS_MAX_SYMBOLS;
+    uint64_t value = atomic_load_explicit(&shard->symbols[bucket], memory_order_relaxed);
+    atomic_store_explicit(&shard->symbols[bucket], value + 1, memory_order_relaxed);
+}
+
+static double cpu_seconds(clockid_t clock) {
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) < 0) {
+        return -1;
+    }
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Sum the shards and write the Prometheus text format to 'out'
+void metrics_render(FILE* out) {
+    static const int symbol_bounds[] = { 0, 1, 2, 4, 8, 16, 32 };
+    uint64_t counters[METRIC_COUNTERS] = { 0 };
+    int64_t gauges[METRIC_GAUGES] = { 0 };
+    uint64_t symbols[METRICS_MAX_SYMBOLS + 1] = { 0 };
+    int shards = atomic_load(&metrics.shard_count);
+
+    for (int i = 0; i < shards && i < METRICS_MAX_THREADS; i++) {
+        metrics_shard_t* shard = atomic_load_explicit(&metrics.shards[i], memory_order_acquire);
+        if (!shard) {
+            continue;
+        }
+        for (int c = 0; c < METRIC_COUNTERS; c++) {
+            counters[c] += atomic_load_explicit(&shard->counters[c], memory_order_relaxed);
+        }
+        for (int g = 0; g < METRIC_GAUGES; g++) {
+            gauges[g] += atomic_load_explicit(&shard->gauges[g], memory_order_relaxed);
+        }
+        for (int s = 0; s <= METRICS_MAX_SYMBOLS; s++) {
+            symbols[s] += atomic_load_explicit(&shard->symbols[s], memory_order_relaxed);
+        }
+    }
+
+    for (int c = 0; c < METRIC_COUNTERS; c++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", METRIC_COUNTER_NAMES[c][0],
+                METRIC_COUNTER_NAMES[c][1], METRIC_COUNTER_NAMES[c][0], METRIC_COUNTER_NAMES[c][0],
+                (unsigned long long)counters[c]);
+    }
+
+    uint64_t blocks = 0, corrected = 0;
+    int bound = 0;
+    fprintf(out, "# HELP fx25_rs_corrected_symbols Symbols corrected per Reed-Solomon block decoded\n"
+                 "# TYPE fx25_rs_corrected_symbols histogram\n");
+    for (int s = 0; s <= METRICS_MAX_SYMBOLS; s++) {
+        blocks += symbols[s];
+        corrected += (uint64_t)s * symbols[s];
+        if (s == symbol_bounds[bound]) {
+            fprintf(out, "fx25_rs_corrected_symbols_bucket{le=\"%d\"} %llu\n", s, (unsigned long long)blocks);
+            bound++;
+        }
+    }
+    fprintf(out, "fx25_rs_corrected_symbols_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)blocks);
+    fprintf(out, "fx25_rs_corrected_symbols_sum %llu\nfx25_rs_corrected_symbols_count %llu\n",
+            (unsigned long long)corrected, (unsigned long long)blocks);
+
+    // Stage times and trace backlog from the trace rings
+    uint64_t stage_ns[TRACE_STAGES] = { 0 };
+    uint64_t backlog = 0;
+    int rings = atomic_load(&trace.ring_count);
+    for (int i = 0; i < rings && i < TRACE_MAX_THREADS; i++) {
+        trace_ring_t* ring = atomic_load_explicit(&trace.rings[i], memory_order_acquire);
+        if (!ring) {
+            continue;
+        }
+        for (int s = 0; s < TRACE_STAGES; s++) {
+            stage_ns[s] += atomic_load_explicit(&ring->stage_ns[s], memory_order_relaxed);
+        }
+        backlog += atomic_load(&ring->head) - atomic_load(&ring->tail);
+    }
+    fprintf(out, "# HELP fx25_stage_seconds_total Time spent in each pipeline stage\n"
+                 "# TYPE fx25_stage_seconds_total counter\n");
+    for (int s = 0; s < TRACE_STAGES; s++) {
+        fprintf(out, "fx25_stage_seconds_total{stage=\"%s\"} %.9f\n", TRACE_STAGE_NAMES[s], stage_ns[s] / 1e9);
+    }
+
+    fprintf(out, "# HELP fx25_thread_cpu_seconds_total CPU time of each thread that counts frames\n"
+                 "# TYPE fx25_thread_cpu_seconds_total counter\n");
+    for (int i = 0; i < shards && i < METRICS_MAX_THREADS; i++) {
+        metrics_shard_t* shard = atomic_load_explicit(&metrics.shards[i], memory_order_acquire);
+        double seconds = (shard && shard->has_cpu_clock) ? cpu_seconds(shard->cpu_clock) : -1;
+        if (seconds >= 0) {
+            fprintf(out, "fx25_thread_cpu_seconds_total{thread=\"%d\"} %.6f\n", i, seconds);
+        }
+    }
+    fprintf(out, "# HELP process_cpu_seconds_total Total user and system CPU time\n"
+                 "# TYPE process_cpu_seconds_total counter\nprocess_cpu_seconds_total %.6f\n",
+            cpu_seconds(CLOCK_PROCESS_CPUTIME_ID));
+
+    fprintf(out, "# HELP fx25_queue_depth Frames waiting in each queue\n# TYPE fx25_queue_depth gauge\n");
+    for (int g = 0; g < METRIC_GAUGES; g++) {
+        fprintf(out, "fx25_queue_depth{queue=\"%s\"} %lld\n", METRIC_QUEUE_NAMES[g], (long long)gauges[g]);
+    }
+    fprintf(out, "fx25_queue_depth{queue=\"trace\"} %llu\n", (unsigned long long)backlog);
+}
+
+static void metrics_respond(int fd) {
+    char request[METRICS_REQUEST_MAX];
+    size_t got = 0;
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    // The request line is all that matters; headers are read and ignored
+    request[0] = '\0';
+    while (got < sizeof(request) - 1 && !strstr(request, "\r\n\r\n") && poll(&pfd, 1, 1000) > 0) {
+        ssize_t n = read(fd, request + got, sizeof(request) - 1 - got);
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+        request[got] = '\0';
+    }
+
+    char* body = NULL;
+    size_t body_len = 0;
+    FILE* out = open_memstream(&body, &body_len);
+    if (!out) {
+        return;
+    }
+    const char* status = "200 OK";
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0) {
+        metrics_render(out);
+    } else {
+        status = "404 Not Found";
+        fprintf(out, "Metrics are served at /metrics\n");
+    }
+    fclose(out);
+
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %zu\r\nConnection: close\r\n\r\n", status, body_len);
+    if (write(fd, header, header_len) == header_len) {
+        for (size_t sent = 0; sent < body_len;) {
+            ssize_t n = write(fd, body + sent, body_len - sent);
+            if (n <= 0) {
+                break;
+            }
+            sent += n;
+        }
+    }
+    free(body);
+}
+
+static void* metrics_server(void* arg) {
+    struct pollfd pfd = { metrics.listen_fd, POLLIN, 0 };
+    (void)arg;
+    while (!atomic_load(&metrics.stop)) {
+        if (poll(&pfd, 1, METRICS_POLL_MS) <= 0) {
+            continue;
+        }
+        int fd = accept(metrics.listen_fd, NULL, NULL);
+        if (fd >= 0) {
+            metrics_respond(fd);
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+static int metrics_listen(const char* address) {
+    int fd;
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+        if (strlen(address + 5) >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(addr.sun_path, address + 5);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(addr.sun_path);  // Left behind by an earlier run
+        if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        strcpy(metrics.unix_path, addr.sun_path);
+    } else {
+        struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+        const char* colon = strrchr(address, ':');
+        char host[64];
+        if (colon) {
+            snprintf(host, sizeof(host), "%.*s", (int)(colon - address), address);
+            if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        int port = atoi(colon ? colon + 1 : address);
+        if (port <= 0 || port > 65535) {
+            errno = EINVAL;
+            return -1;
+        }
+        addr.sin_port = htons(port);
+        int one = 1;
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+            bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Serve the metrics on 'address' until metrics_stop(); returns 0 or -1
+int metrics_start(const char* address) {
+    metrics.listen_fd = metrics_listen(address);
+    if (metrics.listen_fd < 0) {
+        printf("Error: Cannot serve metrics on %s (%s)\n", address, strerror(errno));
+        return -1;
+    }
+    atomic_store(&metrics.stop, 0);
+    if (pthread_create(&metrics.server, NULL, metrics_server, NULL) != 0) {
+        printf("Error: Cannot start the metrics server\n");
+        close(metrics.listen_fd);
+        metrics.listen_fd = -1;
+        return -1;
+    }
+    metrics.running = 1;
+    printf("Serving metrics on %s\n", address);
+    return 0;
+}
+
+void metrics_stop(void) {
+    if (!metrics.running) {
+        return;
+    }
+    atomic_store(&metrics.stop, 1);
+    pthread_join(metrics.server, NULL);
+    close(metrics.listen_fd);
+    metrics.listen_fd = -1;
+    if (metrics.unix_path[0]) {
+        unlink(metrics.unix_path);
+        metrics.unix_path[0] = '\0';
+    }
+    metrics.running = 0;
+}
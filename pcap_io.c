@@ -0,0 +1,309 @@
+// pcap and pcapng capture files of link-layer frames (included by ax25_packet.c)
+//
+// Writers go through a large stdio buffer, one record per frame. Readers
+// map the whole capture and hand out pointers into the mapping, so a replay
+// touches each frame once and copies nothing. Classic pcap and pcapng are
+// both read in either byte order and at any timestamp resolution; both are
+// written in host byte order with nanosecond timestamps.
+//
+// AX.25 frames are stored as LINKTYPE_AX25_KISS: a KISS type byte followed
+// by the frame without flags and FCS, as a KISS TNC passes it to the host,
+// which is what Wireshark's AX.25 dissector expects.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LINKTYPE_AX25_KISS 202
+#define LINKTYPE_USER0 147
+#define LINKTYPE_USER1 148
+#define LINKTYPE_USER2 149
+
+#define PCAP_MAGIC_US 0xA1B2C3D4u
+#define PCAP_MAGIC_NS 0xA1B23C4Du
+#define PCAPNG_SHB 0x0A0D0D0Au         // Section header block
+#define PCAPNG_IDB 1u                  // Interface description block
+#define PCAPNG_SPB 3u                  // Simple packet block
+#define PCAPNG_EPB 6u                  // Enhanced packet block
+#define PCAPNG_BYTE_ORDER 0x1A2B3C4Du
+#define PCAPNG_OPT_TSRESOL 9
+
+#define PCAP_SNAPLEN 65535
+#define PCAP_WRITE_BUFFER (1 << 20)
+#define PCAP_MAX_INTERFACES 16
+
+typedef enum {
+    PCAP_CLASSIC = 0,
+    PCAP_NG,
+} pcap_format_t;
+
+static uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Create a capture holding frames of 'linktype'; returns NULL on error
+FILE* pcap_create(const char* filename, pcap_format_t format, uint32_t linktype) {
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        printf("Error: Cannot create %s\n", filename);
+        return NULL;
+    }
+    setvbuf(fp, NULL, _IOFBF, PCAP_WRITE_BUFFER);
+
+    int ok;
+    if (format == PCAP_CLASSIC) {
+        struct {
+            uint32_t magic;
+            uint16_t major, minor;
+            int32_t thiszone;
+            uint32_t sigfigs, snaplen, linktype;
+        } header = { PCAP_MAGIC_NS, 2, 4, 0, 0, PCAP_SNAPLEN, linktype };
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    } else {
+        struct {
+            uint32_t type, length, byte_order;
+            uint16_t major, minor;
+            int64_t section_length;
+            uint32_t length2;
+        } __attribute__((packed)) shb = { PCAPNG_SHB, 28, PCAPNG_BYTE_ORDER, 1, 0, -1, 28 };
+        // Interface 0, with if_tsresol = 9 for nanosecond timestamps
+        struct {
+            uint32_t type, length;
+            uint16_t linktype, reserved;
+            uint32_t snaplen;
+            uint16_t opt_code, opt_length;
+            uint8_t tsresol, pad[3];
+            uint32_t end_of_options, length2;
+        } idb = { PCAPNG_IDB, 32, linktype, 0, PCAP_SNAPLEN, PCAPNG_OPT_TSRESOL, 1, 9, { 0 }, 0, 32 };
+        ok = fwrite(&shb, sizeof(shb), 1, fp) == 1 && fwrite(&idb, sizeof(idb), 1, fp) == 1;
+    }
+    if (!ok) {
+        printf("Error: Cannot write %s\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+/*
+ * Append one record made of 'head' (may be empty) followed by 'data'.
+ * Returns 0 or -1 on a write error.
+ */
+int pcap_write_record(FILE* fp, pcap_format_t format, uint64_t ts_ns,
+                      const uint8_t* head, int head_len, const uint8_t* data, int length) {
+    static const uint8_t pad[4];
+    uint32_t caplen = head_len + length;
+    uint32_t padded = (format == PCAP_NG) ? (caplen + 3) & ~3u : caplen;
+    uint32_t total = 32 + padded;
+
+    if (format == PCAP_CLASSIC) {
+        uint32_t rec[4] = { ts_ns / 1000000000ull, ts_ns % 1000000000ull, caplen, caplen };
+        if (fwrite(rec, sizeof(rec), 1, fp) != 1) {
+            return -1;
+        }
+    } else {
+        uint32_t rec[7] = { PCAPNG_EPB, total, 0, ts_ns >> 32, ts_ns & 0xFFFFFFFFu, caplen, caplen };
+        if (fwrite(rec, sizeof(rec), 1, fp) != 1) {
+            return -1;
+        }
+    }
+    if ((head_len > 0 && fwrite(head, 1, head_len, fp) != (size_t)head_len) ||
+        (length > 0 && fwrite(data, 1, length, fp) != (size_t)length)) {
+        return -1;
+    }
+    if (format == PCAP_NG &&
+        (fwrite(pad, 1, padded - caplen, fp) != padded - caplen || fwrite(&total, 4, 1, fp) != 1)) {
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    const uint8_t* data;
+    uint32_t length;
+    uint32_t linktype;
+    uint64_t ts_ns;
+} pcap_record_t;
+
+typedef struct {
+    uint8_t* map;
+    size_t size;
+    size_t pos;
+    pcap_format_t format;
+    int swapped;
+    // Classic pcap: one link type and resolution for the file
+    // pcapng: per interface of the current section
+    int interfaces;
+    uint32_t linktype[PCAP_MAX_INTERFACES];
+    uint8_t tsresol[PCAP_MAX_INTERFACES]; // As if_tsresol: 10^-n, or 2^-n with the top bit set
+} pcap_reader_t;
+
+static uint32_t pcap_u32(const pcap_reader_t* r, const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return r->swapped ? __builtin_bswap32(v) : v;
+}
+
+static uint16_t pcap_u16(const pcap_reader_t* r, const uint8_t* p) {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return r->swapped ? __builtin_bswap16(v) : v;
+}
+
+static uint64_t pcap_ts_ns(uint64_t ts, uint8_t tsresol) {
+    int n = tsresol & 0x7F;
+    if (tsresol & 0x80) {
+        return (uint64_t)(((unsigned __int128)ts * 1000000000u) >> n);
+    }
+    for (; n > 9; n--) {
+        ts /= 10;
+    }
+    for (; n < 9; n++) {
+        ts *= 10;
+    }
+    return ts;
+}
+
+// Map a capture for reading; returns 0 or -1 if it is not a capture
+int pcap_open(pcap_reader_t* r, const char* filename) {
+    struct stat st;
+
+    memset(r, 0, sizeof(*r));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < 24) {
+        printf("Error: Cannot read capture %s\n", filename);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    r->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (r->map == MAP_FAILED) {
+        printf("Error: Cannot map capture %s (%s)\n", filename, strerror(errno));
+        r->map = NULL;
+        return -1;
+    }
+    r->size = st.st_size;
+    madvise(r->map, r->size, MADV_SEQUENTIAL);
+
+    uint32_t magic;
+    memcpy(&magic, r->map, 4);
+    if (magic == PCAPNG_SHB) {
+        r->format = PCAP_NG;        // Byte order comes with the section header
+        return 0;
+    }
+    r->format = PCAP_CLASSIC;
+    r->swapped = (magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS));
+    magic = pcap_u32(r, r->map);
+    if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+        printf("Error: %s is not a pcap or pcapng capture\n", filename);
+        munmap(r->map, r->size);
+        r->map = NULL;
+        return -1;
+    }
+    r->interfaces = 1;
+    r->linktype[0] = pcap_u32(r, r->map + 20);
+    r->tsresol[0] = (magic == PCAP_MAGIC_NS) ? 9 : 6;
+    r->pos = 24;
+    return 0;
+}
+
+static void pcapng_read_idb(pcap_reader_t* r, const uint8_t* block, uint32_t length) {
+    if (r->interfaces >= PCAP_MAX_INTERFACES || length < 20) {
+        return;
+    }
+    int i = r->interfaces++;
+    r->linktype[i] = pcap_u16(r, block + 8);
+    r->tsresol[i] = 6;
+    for (uint32_t at = 16; at + 4 <= length - 4;) {
+        uint16_t code = pcap_u16(r, block + at);
+        uint16_t len = pcap_u16(r, block + at + 2);
+        if (code == 0 || at + 4 + len > length - 4) {
+            break;
+        }
+        if (code == PCAPNG_OPT_TSRESOL && len >= 1) {
+            r->tsresol[i] = block[at + 4];
+        }
+        at += 4 + ((len + 3) & ~3u);
+    }
+}
+
+/*
+ * Next record of the capture. Returns 1 with 'rec' filled in (its data
+ * points into the mapping), 0 at the end, or -1 if the capture is damaged.
+ */
+int pcap_next(pcap_reader_t* r, pcap_record_t* rec) {
+    if (r->format == PCAP_CLASSIC) {
+        if (r->pos + 16 > r->size) {
+            return 0;
+        }
+        const uint8_t* p = r->map + r->pos;
+        uint32_t caplen = pcap_u32(r, p + 8);
+        if (caplen > r->size - r->pos - 16) {
+            return -1;
+        }
+        rec->ts_ns = pcap_u32(r, p) * 1000000000ull + pcap_ts_ns(pcap_u32(r, p + 4), r->tsresol[0]);
+        rec->data = p + 16;
+        rec->length = caplen;
+        rec->linktype = r->linktype[0];
+        r->pos += 16 + caplen;
+        return 1;
+    }
+
+    while (r->pos + 12 <= r->size) {
+        const uint8_t* block = r->map + r->pos;
+        uint32_t type;
+        memcpy(&type, block, 4);
+        if (type == PCAPNG_SHB) {
+            uint32_t order;
+            memcpy(&order, block + 8, 4);
+            if (order != PCAPNG_BYTE_ORDER && order != __builtin_bswap32(PCAPNG_BYTE_ORDER)) {
+                return -1;
+            }
+            r->swapped = (order != PCAPNG_BYTE_ORDER);
+            r->interfaces = 0;      // Interfaces are numbered per section
+        } else {
+            type = pcap_u32(r, block);
+        }
+        uint32_t length = pcap_u32(r, block + 4);
+        if (length < 12 || (length & 3) || length > r->size - r->pos) {
+            return -1;
+        }
+        r->pos += length;
+
+        if (type == PCAPNG_IDB) {
+            pcapng_read_idb(r, block, length);
+        } else if (type == PCAPNG_EPB && length >= 32) {
+            uint32_t iface = pcap_u32(r, block + 8);
+            uint32_t caplen = pcap_u32(r, block + 20);
+            if (iface >= (uint32_t)r->interfaces || caplen > length - 32) {
+                return -1;
+            }
+            uint64_t ts = ((uint64_t)pcap_u32(r, block + 12) << 32) | pcap_u32(r, block + 16);
+            rec->ts_ns = pcap_ts_ns(ts, r->tsresol[iface]);
+            rec->data = block + 28;
+            rec->length = caplen;
+            rec->linktype = r->linktype[iface];
+            return 1;
+        } else if (type == PCAPNG_SPB && length >= 16 && r->interfaces > 0) {
+            uint32_t caplen = pcap_u32(r, block + 8);
+            rec->ts_ns = 0;         // Simple packets carry no timestamp
+            rec->data = block + 12;
+            rec->length = caplen < length - 16 ? caplen : length - 16;
+            rec->linktype = r->linktype[0];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void pcap_close(pcap_reader_t* r) {
+    if (r->map) {
+        munmap(r->map, r->size);
+        r->map = NULL;
+    }
+}
@@ -0,0 +1,440 @@
+// End-to-end pipeline benchmark, built like fx25_packet.c:
+//   gcc -O2 pipeline_bench.c -lfec -o pipeline_bench
+//
+// Each stage of the AX.25 / FX.25 pipeline runs over a corpus of synthetic
+// traffic until it has taken at least BENCH_MIN_NS, and is reported as
+// frames/s, MB/s and ns per frame together with IPC, cache misses and
+// branch misses per frame from a perf_event_open counter group (user space
+// only, so perf_event_paranoid 2 is enough). Machines without a hardware
+// PMU, such as many VMs, get the timings alone.
+//
+// Traffic mixes:
+//   beacons   short numbered beacons
+//   messages  text messages of 10 to 150 characters
+//   bulk      file transfer frames, as many data bytes as fit one RS(255,223) codeblock
+//   mixed     half beacons, 30% messages, 20% bulk, interleaved
+
+#define FX25_NO_MAIN
+#include "fx25_packet.c"
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+#define BENCH_DEFAULT_FRAMES 4096
+#define BENCH_MIN_NS 200000000ull          // Shortest measurement per stage
+#define BENCH_DEFAULT_ERRORS 8             // Symbol errors per received codeblock (16 correctable)
+#define BENCH_BULK_PAYLOAD (K - 25)        // Flags, addresses, control, PID, header and FCS take 25
+#define BENCH_COUNTERS 4
+
+typedef enum {
+    MIX_BEACONS = 0,
+    MIX_MESSAGES,
+    MIX_BULK,
+    MIX_MIXED,
+    MIX_COUNT,
+} traffic_mix_t;
+
+static const char* MIX_NAMES[MIX_COUNT] = { "beacons", "messages", "bulk", "mixed" };
+
+// Hardware counters of one stage: cycles (group leader), instructions, cache and branch misses
+typedef struct {
+    int fd[BENCH_COUNTERS];
+    int available;
+} perf_group_t;
+
+static const uint64_t PERF_EVENTS[BENCH_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static int perf_group_open(perf_group_t* pg) {
+    memset(pg, 0, sizeof(*pg));
+    for (int i = 0; i < BENCH_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_EVENTS[i];
+        attr.disabled = (i == 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        pg->fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : pg->fd[0], 0);
+        if (pg->fd[i] < 0) {
+            int error = errno;
+            for (int j = 0; j < i; j++) {
+                close(pg->fd[j]);
+            }
+            errno = error;
+            return -1;
+        }
+    }
+    pg->available = 1;
+    return 0;
+}
+
+static void perf_group_start(perf_group_t* pg) {
+    if (pg->available) {
+        ioctl(pg->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(pg->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+static int perf_group_stop(perf_group_t* pg, uint64_t* values) {
+    uint64_t buf[1 + BENCH_COUNTERS];
+
+    if (!pg->available) {
+        return -1;
+    }
+    ioctl(pg->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(pg->fd[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[0] != BENCH_COUNTERS) {
+        return -1;
+    }
+    memcpy(values, buf + 1, sizeof(uint64_t) * BENCH_COUNTERS);
+    return 0;
+}
+
+// One synthetic frame: what frame_gen is asked to build
+typedef struct {
+    frame_type_t type;
+    uint32_t sequence;
+    uint32_t total;                        // Frames in the transfer, at most UINT16_MAX on the wire
+    const uint8_t* payload;
+    int payload_len;
+} frame_recipe_t;
+
+typedef struct {
+    fx25_config_t* config;
+    ax25_config_t ax25;
+    int count;
+    frame_recipe_t* recipes;
+    uint8_t* payloads;
+    uint8_t (*frames)[MAX_FRAME_SIZE];     // AX.25 frames, flag-delimited
+    int* lengths;
+    uint8_t (*encoded)[MAX_FRAME_SIZE];    // FX.25 frames
+    uint8_t (*received)[MAX_FRAME_SIZE];   // FX.25 frames with symbol errors
+    int* encoded_lengths;
+    uint8_t* bulk;                         // Data for packetization, empty without bulk traffic
+    int bulk_len;
+    char hex_file[32];                     // The corpus as packets.txt-style hex for read_ax25
+    frame_pool_t* pool;
+    frame_buf_t** bufs;
+    FILE* sink;
+    long undecodable;                      // Codeblocks the last RS decode pass could not correct
+    volatile uint32_t checksum;            // Keeps results alive
+} bench_t;
+
+typedef long (*stage_fn_t)(bench_t* b, long* bytes);
+
+static void write_frame_none(FILE* output, const uint8_t* frame, int length, int packet_num) {
+    (void)output;
+    (void)frame;
+    (void)length;
+    (void)packet_num;
+}
+
+static long stage_packetization(bench_t* b, long* bytes) {
+    // packetization announces itself on stdout; keep that out of the report
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(b->sink), STDOUT_FILENO);
+    int frames = packetization(&b->ax25, b->bulk, b->bulk_len, b->sink, write_frame_none, NULL);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    *bytes = b->bulk_len;
+    return frames;
+}
+
+static long stage_frame_gen(bench_t* b, long* bytes) {
+    uint8_t frame[MAX_FRAME_SIZE];
+    *bytes = 0;
+    for (int i = 0; i < b->count; i++) {
+        const frame_recipe_t* r = &b->recipes[i];
+        int length = frame_gen(&b->ax25, r->type, r->sequence, r->total, r->payload, r->payload_len, frame);
+        b->checksum += frame[length - 2];
+        *bytes += length;
+    }
+    return b->count;
+}
+
+static long stage_crc(bench_t* b, long* bytes) {
+    *bytes = 0;
+    for (int i = 0; i < b->count; i++) {
+        b->checksum += calculate_crc(b->frames[i] + 1, b->lengths[i] - 4);
+        *bytes += b->lengths[i] - 4;
+    }
+    return b->count;
+}
+
+static long stage_hex_output(bench_t* b, long* bytes) {
+    *bytes = 0;
+    for (int i = 0; i < b->count; i++) {
+        write_frame_hex(b->sink, b->frames[i], b->lengths[i], i);
+        *bytes += b->lengths[i];
+    }
+    return b->count;
+}
+
+static long stage_pcap_output(bench_t* b, long* bytes) {
+    *bytes = 0;
+    for (int i = 0; i < b->count; i++) {
+        write_frame_pcap(b->sink, b->frames[i], b->lengths[i], i);
+        *bytes += b->lengths[i];
+    }
+    return b->count;
+}
+
+static long stage_read_ax25(bench_t* b, long* bytes) {
+    int count = read_ax25(b->hex_file, b->pool, b->bufs, b->count);
+    *bytes = 0;
+    for (int i = 0; i < count; i++) {
+        *bytes += b->bufs[i]->length;
+        frame_buf_unref(b->bufs[i]);
+    }
+    return count;
+}
+
+static long stage_generate_fx25(bench_t* b, long* bytes) {
+    uint8_t frame[MAX_FRAME_SIZE];
+    *bytes = 0;
+    for (int i = 0; i < b->count; i++) {
+        int length = generate_fx25(b->config, b->frames[i], b->lengths[i], frame);
+        b->checksum += frame[length - 1];
+        *bytes += b->lengths[i];
+    }
+    return b->count;
+}
+
+static long stage_rs_decode(bench_t* b, long* bytes) {
+    uint8_t data[N];
+    long decoded = 0;
+    *bytes = 0;
+    for (int i = 0; i < b->count; i++) {
+        int corrected;
+        if (decode_fx25(b->config, b->received[i], b->encoded_lengths[i], data, &corrected) > 0) {
+            b->checksum += corrected;
+            decoded++;
+        }
+        *bytes += b->encoded_lengths[i];
+    }
+    b->undecodable = b->count - decoded;
+    return b->count;
+}
+
+// Run 'fn' until BENCH_MIN_NS has passed and print its line of the report
+static void bench_stage(bench_t* b, perf_group_t* pg, const char* name, stage_fn_t fn) {
+    long frames = 0, bytes = 0;
+    uint64_t counters[BENCH_COUNTERS];
+
+    perf_group_start(pg);
+    uint64_t start = monotonic_ns(), elapsed;
+    do {
+        long stage_bytes = 0;
+        frames += fn(b, &stage_bytes);
+        bytes += stage_bytes;
+        elapsed = monotonic_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    int counted = perf_group_stop(pg, counters) == 0;
+
+    printf("  %-16s %12.0f %9.1f %9.1f", name, frames / (elapsed / 1e9), bytes / (elapsed / 1e3),
+           (double)elapsed / frames);
+    if (counted && counters[0] > 0) {
+        printf(" %6.2f %13.3f %14.3f", (double)counters[1] / counters[0],
+               (double)counters[2] / frames, (double)counters[3] / frames);
+    } else {
+        printf(" %6s %13s %14s", "-", "-", "-");
+    }
+    printf("\n");
+}
+
+static int bench_random(int range) {
+    return rand() % range;
+}
+
+// Build the corpus of 'count' frames for one traffic mix
+static int bench_init(bench_t* b, fx25_config_t* config, traffic_mix_t mix, int count, int errors) {
+    static const char* words[] = { "CQ", "net", "tonight", "at", "2000", "local", "on", "145.825",
+                                   "wx", "rain", "QSL", "thanks", "73", "de", "N0CALL", "portable" };
+    memset(b, 0, sizeof(*b));
+    b->config = config;
+    b->ax25 = (ax25_config_t){ .source_call = "N0CALL", .dest_call = "CQ", .source = 0, .dest = 0 };
+    b->count = count;
+    b->recipes = calloc(count, sizeof(frame_recipe_t));
+    b->payloads = calloc(count, MAX_PAYLOAD);
+    b->frames = calloc(count, MAX_FRAME_SIZE);
+    b->lengths = calloc(count, sizeof(int));
+    b->encoded = calloc(count, MAX_FRAME_SIZE);
+    b->received = calloc(count, MAX_FRAME_SIZE);
+    b->encoded_lengths = calloc(count, sizeof(int));
+    b->bulk = malloc((size_t)count * BENCH_BULK_PAYLOAD);
+    b->pool = frame_pool_create(count);
+    b->bufs = calloc(count, sizeof(frame_buf_t*));
+    b->sink = fopen("/dev/null", "w");
+    if (!b->recipes || !b->payloads || !b->frames || !b->lengths || !b->encoded || !b->received ||
+        !b->encoded_lengths || !b->bulk || !b->pool || !b->bufs || !b->sink) {
+        printf("Error: Out of memory\n");
+        return -1;
+    }
+
+    srand(mix + 1);
+    for (int i = 0; i < count; i++) {
+        frame_recipe_t* r = &b->recipes[i];
+        uint8_t* payload = b->payloads + (size_t)i * MAX_PAYLOAD;
+        int kind = mix;
+        if (mix == MIX_MIXED) {
+            int pick = bench_random(10);
+            kind = (pick < 5) ? MIX_BEACONS : (pick < 8) ? MIX_MESSAGES : MIX_BULK;
+        }
+
+        r->payload = payload;
+        r->total = 1;
+        if (kind == MIX_BEACONS) {
+            r->type = BEACON_FRAME;
+            r->payload_len = snprintf((char*)payload, MAX_PAYLOAD, "!4903.50N/07201.75W- beacon %05d", i);
+        } else if (kind == MIX_MESSAGES) {
+            int target = 10 + bench_random(141);
+            r->type = FRAME_MESSAGE;
+            r->payload_len = 0;
+            while (r->payload_len < target) {
+                r->payload_len += snprintf((char*)payload + r->payload_len, MAX_PAYLOAD - r->payload_len,
+                                           "%s ", words[bench_random(16)]);
+            }
+            r->payload_len = target;
+        } else {
+            r->type = FRAME_DATA;
+            // The frame header counts 16 bits: a longer corpus is several transfers
+            r->sequence = i % UINT16_MAX;
+            r->total = count - (i - r->sequence) < UINT16_MAX ? count - (i - r->sequence) : UINT16_MAX;
+            r->payload_len = BENCH_BULK_PAYLOAD;
+            for (int j = 0; j < BENCH_BULK_PAYLOAD; j++) {
+                payload[j] = bench_random(256);
+            }
+            memcpy(b->bulk + b->bulk_len, payload, BENCH_BULK_PAYLOAD);
+            b->bulk_len += BENCH_BULK_PAYLOAD;
+        }
+
+        b->lengths[i] = frame_gen(&b->ax25, r->type, r->sequence, r->total, r->payload, r->payload_len,
+                                  b->frames[i]);
+        b->encoded_lengths[i] = generate_fx25(config, b->frames[i], b->lengths[i], b->encoded[i]);
+        memcpy(b->received[i], b->encoded[i], b->encoded_lengths[i]);
+        for (int e = 0; e < errors; e++) {
+            b->received[i][CORRELATION_TAG_SIZE + bench_random(N)] ^= 1 + bench_random(255);
+        }
+    }
+
+    strcpy(b->hex_file, "/tmp/pipeline_bench_XXXXXX");
+    int fd = mkstemp(b->hex_file);
+    FILE* hex = (fd >= 0) ? fdopen(fd, "w") : NULL;
+    if (!hex) {
+        printf("Error: Cannot create a temporary file for read_ax25\n");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        write_frame_hex(hex, b->frames[i], b->lengths[i], i);
+    }
+    fclose(hex);
+    return 0;
+}
+
+static void bench_free(bench_t* b) {
+    if (b->hex_file[0]) {
+        unlink(b->hex_file);
+    }
+    if (b->sink) {
+        fclose(b->sink);
+    }
+    frame_pool_destroy(b->pool);
+    free(b->recipes);
+    free(b->payloads);
+    free(b->frames);
+    free(b->lengths);
+    free(b->encoded);
+    free(b->received);
+    free(b->encoded_lengths);
+    free(b->bulk);
+    free(b->bufs);
+}
+
+int main(int argc, char* argv[]) {
+    int count = BENCH_DEFAULT_FRAMES;
+    int errors = BENCH_DEFAULT_ERRORS;
+    int only = -1;
+    perf_group_t pg;
+
+    // Usage: [--frames N] [--errors E] [--mix beacons|messages|bulk|mixed]
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--errors") == 0 && i + 1 < argc) {
+            errors = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+            i++;
+            for (int m = 0; m < MIX_COUNT; m++) {
+                if (strcmp(argv[i], MIX_NAMES[m]) == 0) {
+                    only = m;
+                }
+            }
+            if (only < 0) {
+                printf("Error: Unknown traffic mix '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+    if (count < 1) {
+        printf("Error: --frames must be at least 1\n");
+        return 1;
+    }
+
+    fx25_config_t* config = fx25_init();
+    if (!config) {
+        printf("Error: Failed to initialize FX.25 configuration\n");
+        return 1;
+    }
+    if (perf_group_open(&pg) < 0) {
+        printf("Note: hardware counters unavailable (%s), reporting timings only\n", strerror(errno));
+    }
+    printf("Pipeline benchmark: %d frames per mix, %d symbol errors per received codeblock\n", count, errors);
+
+    int result = 0;
+    for (int m = 0; m < MIX_COUNT && result == 0; m++) {
+        bench_t b;
+        if (only >= 0 && m != only) {
+            continue;
+        }
+        if (bench_init(&b, config, m, count, errors) < 0) {
+            result = 1;
+        } else {
+            long frame_bytes = 0;
+            for (int i = 0; i < count; i++) {
+                frame_bytes += b.lengths[i];
+            }
+            printf("\nTraffic mix: %s (average AX.25 frame %.0f bytes)\n", MIX_NAMES[m], (double)frame_bytes / count);
+            printf("  %-16s %12s %9s %9s %6s %13s %14s\n", "Stage", "frames/s", "MB/s", "ns/frame",
+                   "IPC", "cache-miss/fr", "branch-miss/fr");
+            if (b.bulk_len > 0) {
+                bench_stage(&b, &pg, "packetization", stage_packetization);
+            }
+            bench_stage(&b, &pg, "frame_gen", stage_frame_gen);
+            bench_stage(&b, &pg, "calculate_crc", stage_crc);
+            bench_stage(&b, &pg, "hex output", stage_hex_output);
+            bench_stage(&b, &pg, "pcap output", stage_pcap_output);
+            bench_stage(&b, &pg, "read_ax25", stage_read_ax25);
+            bench_stage(&b, &pg, "generate_fx25", stage_generate_fx25);
+            bench_stage(&b, &pg, "RS decode", stage_rs_decode);
+            if (b.undecodable > 0) {
+                printf("Warning: %ld of %d codeblocks did not decode\n", b.undecodable, count);
+            }
+        }
+        bench_free(&b);
+    }
+
+    if (pg.available) {
+        for (int i = 0; i < BENCH_COUNTERS; i++) {
+            close(pg.fd[i]);
+        }
+    }
+    fx25_cleanup(config);
+    return result;
+}
@@ -0,0 +1,163 @@
+/*
+ * FX.25 regression tests. Build like fx25_packet and run from this
+ * directory:
+ *   gcc test.c -lfec && ./a.out
+ * Exit status is the number of failed checks.
+ */
+#define FX25_NO_MAIN
+#include "fx25_packet.c"
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+static const ax25_config_t test_station = {
+    .source_call = "N0CALL",
+    .dest_call = "APRS",
+    .source = 1,
+    .dest = 0,
+};
+
+/*
+ * A lone frame waits in the aggregator until its latency budget runs out,
+ * then comes out on its own in a codeblock the receiver splits back into
+ * that frame.
+ */
+static void test_aggregate_budget(fx25_config_t* config) {
+    fx25_aggregator_t agg;
+    uint8_t ax25[AX25_MAX_FRAME], fx25[512];
+    uint8_t frames[AGGREGATE_MAX_FRAMES][MAX_FRAME_SIZE];
+    int lengths[AGGREGATE_MAX_FRAMES];
+    fx25_rx_stats_t rx = { 0 };
+    int corrected;
+
+    int length = create_message_frame(&test_station, "budget test", ax25);
+    fx25_aggregator_init(&agg, 100);
+    check(fx25_aggregator_add(config, &agg, ax25, length, 5000, fx25) == 0, "a lone frame is queued");
+    check(fx25_aggregator_poll(config, &agg, 5099, fx25) == 0, "it is held while the budget lasts");
+
+    int fx25_len = fx25_aggregator_poll(config, &agg, 5100, fx25);
+    check(fx25_len > 0, "it is flushed once the budget expires");
+    int count = decode_fx25_frames(config, fx25, fx25_len, frames, lengths, AGGREGATE_MAX_FRAMES, &corrected, &rx);
+    check(count == 1 && lengths[0] == length && memcmp(frames[0], ax25, length) == 0,
+          "the flushed codeblock carries just that frame");
+    check(fx25_aggregator_poll(config, &agg, 9999, fx25) == 0, "nothing is left queued");
+}
+
+/*
+ * Replay with aggregation: two frames 50 ms apart share a codeblock, which
+ * goes out when the first one's budget expires, before a third frame that
+ * arrives 300 ms in and is flushed at the end of the capture.
+ */
+static void test_replay_aggregate(fx25_config_t* config) {
+    static const uint8_t kiss = KISS_DATA_FRAME;
+    static const uint64_t arrival_ms[3] = { 0, 50, 300 };
+    const char* input = "test_aggregate_in.pcap";
+    const char* output = "test_aggregate_out.pcap";
+    const uint64_t start_ns = 1700000000ull * 1000000000ull;
+    uint8_t ax25[3][AX25_MAX_FRAME];
+    int lengths[3];
+    char text[32];
+
+    FILE* fp = pcap_create(input, PCAP_CLASSIC, LINKTYPE_AX25_KISS);
+    if (!fp) {
+        check(0, "create the replay capture");
+        return;
+    }
+    for (int f = 0; f < 3; f++) {
+        snprintf(text, sizeof(text), "replay frame %d", f);
+        lengths[f] = create_message_frame(&test_station, text, ax25[f]);
+        pcap_write_record(fp, PCAP_CLASSIC, start_ns + arrival_ms[f] * 1000000, &kiss, 1, ax25[f] + 1,
+                          lengths[f] - 4);
+    }
+    fclose(fp);
+
+    fx25_aggregator_t agg;
+    fx25_aggregator_init(&agg, 100);
+    int result = replay_capture(config, 0, input, 0, 1, NULL, NULL, &agg, -1, output, PCAP_CLASSIC);
+    check(result == 0, "replay with aggregation succeeds");
+
+    pcap_reader_t reader;
+    pcap_record_t rec;
+    uint8_t frames[AGGREGATE_MAX_FRAMES][MAX_FRAME_SIZE];
+    int frame_lengths[AGGREGATE_MAX_FRAMES];
+    fx25_rx_stats_t rx = { 0 };
+    int corrected, blocks = 0, next = 0, in_order = 1;
+    uint64_t first_block_ns = 0;
+    if (pcap_open(&reader, output) < 0) {
+        check(0, "open the replay output");
+        remove(input);
+        return;
+    }
+    while (pcap_next(&reader, &rec) > 0) {
+        int count = decode_fx25_frames(config, rec.data, rec.length, frames, frame_lengths,
+                                       AGGREGATE_MAX_FRAMES, &corrected, &rx);
+        if (blocks++ == 0) {
+            first_block_ns = rec.ts_ns;
+            in_order &= count == 2;
+        }
+        for (int f = 0; f < count; f++, next++) {
+            in_order &= next < 3 && frame_lengths[f] == lengths[next] &&
+                        memcmp(frames[f], ax25[next], lengths[next]) == 0;
+        }
+    }
+    pcap_close(&reader);
+    check(blocks == 2 && next == 3 && in_order, "two codeblocks: the first two frames, then the third");
+    check(first_block_ns == start_ns + 100 * 1000000ull, "the first block goes out when its budget expires");
+
+    remove(input);
+    remove(output);
+}
+
+/*
+ * --fcs-check: of a clean frame, one with a single bit error and one with
+ * five bytes overwritten, the clean frame passes, the bit error is repaired
+ * back to the original and the overwritten frame is dropped.
+ */
+static void test_fcs_check(fx25_config_t* config) {
+    frame_pool_t* pool = frame_pool_create(3);
+    frame_buf_t* packets[3];
+    uint8_t original[AX25_MAX_FRAME];
+    int repaired, dropped;
+
+    if (!pool) {
+        check(0, "create the frame pool");
+        return;
+    }
+    int length = create_message_frame(&test_station, "fcs check", original);
+    for (int i = 0; i < 3; i++) {
+        packets[i] = frame_buf_alloc(pool);
+        memcpy(frame_buf_put(packets[i], length), original, length);
+    }
+    frame_buf_data(packets[1])[10] ^= 0x04;
+    memset(frame_buf_data(packets[2]) + 3, 0x55, 5);
+
+    int kept = ax25_check_frames(config, packets, 3, &repaired, &dropped);
+    check(kept == 2 && repaired == 1 && dropped == 1, "one frame repaired and one dropped");
+    check(kept == 2 && packets[1]->length == length && memcmp(frame_buf_data(packets[1]), original, length) == 0,
+          "the repaired frame matches the original");
+
+    for (int i = 0; i < kept; i++) {
+        frame_buf_unref(packets[i]);
+    }
+    frame_pool_destroy(pool);
+}
+
+int main(void) {
+    fx25_config_t* config = fx25_init();
+    if (!config) {
+        printf("Error: Failed to initialize FX.25 configuration\n");
+        return 1;
+    }
+
+    test_aggregate_budget(config);
+    test_replay_aggregate(config);
+    test_fcs_check(config);
+
+    fx25_cleanup(config);
+    printf("\n%d check(s) failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,339 @@
+// Always-on binary tracing of the frame pipeline (included by ax25_packet.c)
+//
+// Every thread writes 16-byte events into a ring of its own: a timestamp,
+// the frame, the stage and whether the stage begins or ends. The owning
+// thread is the only writer, so an event costs a clock read, a store and
+// one release store of the head; nothing is locked and nothing blocks. A
+// thread that gets a full ring ahead of the reader counts the event as
+// dropped instead of waiting.
+//
+// A reader thread drains all rings every TRACE_DRAIN_MS, pairs each begin
+// with the matching end of the same thread into a per-stage latency
+// histogram and, when a trace file was given, appends the raw events to it.
+//
+// The histograms are HDR-style: a value is bucketed by its power of two and
+// then linearly into 2^(TRACE_SUB_BITS-1) steps, so any latency from 1 ns to
+// TRACE_MAX_BITS bits is kept to within about 3% in a fixed array, and the
+// percentiles come from one cumulative walk.
+//
+// The owning thread also adds up the time spent in each stage itself, so
+// the totals stay exact when events are dropped (metrics.c exports them).
+//
+// Trace file: a trace_file_header_t, then trace_event_t records in host
+// byte order, each ring's events in order (rings interleave per drain).
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define TRACE_MAGIC 0x45435254u         // "TRCE"
+#define TRACE_VERSION 1
+#define TRACE_MAX_THREADS 64
+#define TRACE_RING_EVENTS 65536         // Per thread, a power of two (1 MB)
+#define TRACE_DRAIN_MS 5
+#define TRACE_SUB_BITS 6
+#define TRACE_MAX_BITS 48               // Longer latencies (over 3 days) are clamped
+#define TRACE_HIST_BUCKETS ((TRACE_MAX_BITS - TRACE_SUB_BITS + 2) << (TRACE_SUB_BITS - 1))
+#define TRACE_NO_FRAME 0xFFFFFFFFu
+
+typedef enum {
+    TRACE_FRAME_BUILD = 0,  // frame_gen: addresses, header, payload and FCS
+    TRACE_FX25_ENCODE,      // FX.25 / IL2P encoding of one AX.25 frame
+    TRACE_MODULATE,         // Handing the encoded frame to the channel (writer or burst)
+    TRACE_DEMOD,            // Taking a received frame off the channel
+    TRACE_RS_DECODE,        // FX.25 / IL2P receive, Reed-Solomon included
+    TRACE_REASSEMBLY,       // Splitting a codeblock back into AX.25 frames
+    TRACE_FRAME,            // One frame through the whole pipeline
+    TRACE_STAGES,
+} trace_stage_t;
+
+static const char* TRACE_STAGE_NAMES[TRACE_STAGES] = {
+    "frame build", "FX.25 encode", "modulate", "demod", "RS decode", "reassembly", "frame total",
+};
+
+enum {
+    TRACE_BEGIN = 0,
+    TRACE_END = 1,
+};
+
+typedef struct {
+    uint64_t ts_ns;                     // CLOCK_MONOTONIC
+    uint32_t frame;
+    uint8_t stage;
+    uint8_t phase;                      // TRACE_BEGIN or TRACE_END
+    uint16_t thread;
+} trace_event_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t event_size;
+    uint64_t realtime_offset_ns;        // Add to ts_ns for CLOCK_REALTIME
+} trace_file_header_t;
+
+typedef struct {
+    // Owning thread
+    _Alignas(64) _Atomic uint64_t head;
+    uint64_t cached_tail;               // Last tail seen; the reader's line is only read when full
+    _Atomic uint64_t dropped;
+    uint64_t begin_ns[TRACE_STAGES];    // Begin time of each stage in progress, 0 if none
+    _Atomic uint64_t stage_ns[TRACE_STAGES];
+
+    // Reader thread
+    _Alignas(64) _Atomic uint64_t tail;
+    uint64_t open[TRACE_STAGES];        // Begin time of each stage in progress, 0 if none
+    uint16_t thread;
+
+    _Alignas(64) trace_event_t events[TRACE_RING_EVENTS];
+} trace_ring_t;
+
+typedef struct {
+    uint64_t counts[TRACE_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} trace_histogram_t;
+
+static struct {
+    _Atomic int enabled;
+    _Atomic int stop;
+    _Atomic int ring_count;
+    trace_ring_t* _Atomic rings[TRACE_MAX_THREADS];
+    pthread_t reader;
+    FILE* file;
+    uint64_t written;
+    trace_histogram_t hist[TRACE_STAGES];
+} trace;
+
+static _Thread_local trace_ring_t* trace_local;
+
+static int trace_bucket(uint64_t value) {
+    if (value >= (1ull << TRACE_MAX_BITS)) {
+        value = (1ull << TRACE_MAX_BITS) - 1;
+    }
+    if (value < (1u << TRACE_SUB_BITS)) {
+        return value;
+    }
+    int shift = 63 - __builtin_clzll(value) - TRACE_SUB_BITS + 1;
+    return (shift << (TRACE_SUB_BITS - 1)) + (int)(value >> shift);
+}
+
+// Highest value that falls in 'bucket'
+static uint64_t trace_bucket_value(int bucket) {
+    if (bucket < (1 << TRACE_SUB_BITS)) {
+        return bucket;
+    }
+    int shift = (bucket >> (TRACE_SUB_BITS - 1)) - 1;
+    uint64_t sub = bucket - ((uint64_t)shift << (TRACE_SUB_BITS - 1));
+    return (sub << shift) + (1ull << shift) - 1;
+}
+
+static void trace_histogram_record(trace_histogram_t* h, uint64_t value) {
+    h->counts[trace_bucket(value)]++;
+    h->total++;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+// Smallest recorded value at or above the 'quantile' fraction of all values
+static uint64_t trace_histogram_quantile(const trace_histogram_t* h, double quantile) {
+    uint64_t rank = (uint64_t)(quantile * h->total + 0.5);
+    uint64_t seen = 0;
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (int i = 0; i < TRACE_HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t value = trace_bucket_value(i);
+            return value < h->max ? value : h->max;
+        }
+    }
+    return h->max;
+}
+
+static trace_ring_t* trace_register(void) {
+    int index = atomic_fetch_add(&trace.ring_count, 1);
+    if (index >= TRACE_MAX_THREADS) {
+        atomic_store(&trace.ring_count, TRACE_MAX_THREADS);
+        return NULL;
+    }
+    trace_ring_t* ring = aligned_alloc(64, sizeof(trace_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+    memset(ring, 0, offsetof(trace_ring_t, events));
+    ring->thread = index;
+    atomic_store_explicit(&trace.rings[index], ring, memory_order_release);
+    trace_local = ring;
+    return ring;
+}
+
+static inline void trace_event(int stage, int phase, uint32_t frame) {
+    if (!atomic_load_explicit(&trace.enabled, memory_order_relaxed)) {
+        return;
+    }
+    trace_ring_t* ring = trace_local;
+    if (!ring && !(ring = trace_register())) {
+        return;
+    }
+
+    uint64_t now = monotonic_ns();
+    if (phase == TRACE_BEGIN) {
+        ring->begin_ns[stage] = now;
+    } else if (ring->begin_ns[stage]) {
+        uint64_t total = atomic_load_explicit(&ring->stage_ns[stage], memory_order_relaxed);
+        atomic_store_explicit(&ring->stage_ns[stage], total + now - ring->begin_ns[stage], memory_order_relaxed);
+        ring->begin_ns[stage] = 0;
+    }
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - ring->cached_tail >= TRACE_RING_EVENTS) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail >= TRACE_RING_EVENTS) {
+            atomic_store_explicit(&ring->dropped, atomic_load_explicit(&ring->dropped, memory_order_relaxed) + 1,
+                                  memory_order_relaxed);
+            return;
+        }
+    }
+    trace_event_t* ev = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+    ev->ts_ns = now;
+    ev->frame = frame;
+    ev->stage = stage;
+    ev->phase = phase;
+    ev->thread = ring->thread;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static inline void trace_begin(int stage, uint32_t frame) {
+    trace_event(stage, TRACE_BEGIN, frame);
+}
+
+static inline void trace_end(int stage, uint32_t frame) {
+    trace_event(stage, TRACE_END, frame);
+}
+
+static void trace_drain_ring(trace_ring_t* ring) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    for (uint64_t pos = tail; pos < head; pos++) {
+        const trace_event_t* ev = &ring->events[pos & (TRACE_RING_EVENTS - 1)];
+        if (ev->stage >= TRACE_STAGES) {
+            continue;
+        }
+        if (ev->phase == TRACE_BEGIN) {
+            ring->open[ev->stage] = ev->ts_ns;
+        } else if (ring->open[ev->stage]) {
+            trace_histogram_record(&trace.hist[ev->stage], ev->ts_ns - ring->open[ev->stage]);
+            ring->open[ev->stage] = 0;
+        }
+    }
+    if (trace.file && head > tail) {
+        // At most two pieces: up to the end of the ring, then from its start
+        uint64_t first = head - tail;
+        uint64_t offset = tail & (TRACE_RING_EVENTS - 1);
+        if (offset + first > TRACE_RING_EVENTS) {
+            first = TRACE_RING_EVENTS - offset;
+        }
+        trace.written += fwrite(&ring->events[offset], sizeof(trace_event_t), first, trace.file);
+        trace.written += fwrite(ring->events, sizeof(trace_event_t), head - tail - first, trace.file);
+    }
+    atomic_store_explicit(&ring->tail, head, memory_order_release);
+}
+
+static void trace_drain(void) {
+    int count = atomic_load(&trace.ring_count);
+    for (int i = 0; i < count && i < TRACE_MAX_THREADS; i++) {
+        trace_ring_t* ring = atomic_load_explicit(&trace.rings[i], memory_order_acquire);
+        if (ring) {
+            trace_drain_ring(ring);
+        }
+    }
+}
+
+static void* trace_reader(void* arg) {
+    struct timespec interval = { 0, TRACE_DRAIN_MS * 1000000L };
+    (void)arg;
+    while (!atomic_load(&trace.stop)) {
+        nanosleep(&interval, NULL);
+        trace_drain();
+    }
+    trace_drain();
+    return NULL;
+}
+
+/*
+ * Start tracing, with the raw events also written to 'filename' if it is
+ * not NULL. Returns 0, or -1 if the file or the reader thread cannot be
+ * created (tracing stays off).
+ */
+int trace_start(const char* filename) {
+    if (filename) {
+        trace.file = fopen(filename, "wb");
+        trace_file_header_t header = { TRACE_MAGIC, TRACE_VERSION, sizeof(trace_event_t),
+                                       realtime_ns() - monotonic_ns() };
+        if (!trace.file || fwrite(&header, sizeof(header), 1, trace.file) != 1) {
+            printf("Error: Cannot create trace file %s\n", filename);
+            if (trace.file) {
+                fclose(trace.file);
+                trace.file = NULL;
+            }
+            return -1;
+        }
+    }
+    atomic_store(&trace.stop, 0);
+    atomic_store(&trace.enabled, 1);
+    if (pthread_create(&trace.reader, NULL, trace_reader, NULL) != 0) {
+        atomic_store(&trace.enabled, 0);
+        printf("Error: Cannot start the trace reader\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Stop tracing, drain what is left and print the latency table if 'report'
+void trace_stop(int report) {
+    if (!atomic_load(&trace.enabled)) {
+        return;
+    }
+    atomic_store(&trace.enabled, 0);
+    atomic_store(&trace.stop, 1);
+    pthread_join(trace.reader, NULL);
+
+    uint64_t dropped = 0;
+    int count = atomic_load(&trace.ring_count);
+    for (int i = 0; i < count && i < TRACE_MAX_THREADS; i++) {
+        trace_ring_t* ring = atomic_load(&trace.rings[i]);
+        if (ring) {
+            dropped += atomic_load(&ring->dropped);
+        }
+    }
+    if (trace.file) {
+        if (fclose(trace.file) != 0) {
+            printf("Error: Cannot write trace file\n");
+        }
+        trace.file = NULL;
+    }
+
+    if (!report) {
+        return;
+    }
+    printf("Latency (us)        count       p50       p90       p99     p99.9       max\n");
+    for (int s = 0; s < TRACE_STAGES; s++) {
+        const trace_histogram_t* h = &trace.hist[s];
+        if (h->total == 0) {
+            continue;
+        }
+        printf("  %-14s %9llu %9.2f %9.2f %9.2f %9.2f %9.2f\n", TRACE_STAGE_NAMES[s],
+               (unsigned long long)h->total, trace_histogram_quantile(h, 0.50) / 1e3,
+               trace_histogram_quantile(h, 0.90) / 1e3, trace_histogram_quantile(h, 0.99) / 1e3,
+               trace_histogram_quantile(h, 0.999) / 1e3, h->max / 1e3);
+    }
+    if (dropped > 0) {
+        printf("Trace: %llu events dropped (reader fell behind)\n", (unsigned long long)dropped);
+    }
+    if (trace.written > 0) {
+        printf("Trace: %llu events written\n", (unsigned long long)trace.written);
+    }
+}